@@ -12,18 +12,44 @@
 #define __METEO_CTRL_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <glib-2.0/glib.h>
 
 #include <utils/utils.h>
 
 #define METEO_SENSOR_TRIES  5
+#define METEO_SWEEP_SEC     10
+#define METEO_RETRY_SEC     2
 #define METEO_BAD_VAL       -127
+#define METEO_DIR           "meteo/"
+#define METEO_RAW_SIZE      360
+#define METEO_MINUTES_SIZE  1440
+#define METEO_HOURS_SIZE    336
+#define METEO_DAYS_SIZE     366
+#define METEO_FLUSH_SEC     300
 
 typedef enum {
     METEO_SENSOR_DS18B20
 } MeteoSensorType;
 
+typedef enum {
+    METEO_LEVEL_RAW,
+    METEO_LEVEL_MINUTE,
+    METEO_LEVEL_HOUR,
+    METEO_LEVEL_DAY,
+    METEO_LEVEL_MAX
+} MeteoLevel;
+
+typedef struct {
+    int64_t time;
+    float   min;
+    float   max;
+    float   avg;
+} MeteoPoint;
+
+typedef struct _MeteoHistory MeteoHistory;
+
 typedef struct {
     char    id[SHORT_STR_LEN];
     float   temp;
@@ -34,8 +60,20 @@ typedef struct {
     MeteoSensorType type;
     MeteoDs18b20    ds18b20;
     bool            error;
+    unsigned        fails;
+    uint64_t        retry;
+    MeteoHistory    *history;
 } MeteoSensor;
 
+/**
+ * @brief Set path for meteo history files
+ *
+ * History is stored in METEO_DIR folder of path.
+ *
+ * @param path Path to DB files
+ */
+void MeteoPathSet(const char *path);
+
 /**
  * @brief Alloc mem for new sensor
  * 
@@ -46,9 +84,30 @@ typedef struct {
  */
 MeteoSensor *MeteoSensorNew(const char *name, MeteoSensorType type);
 
+/**
+ * @brief Get temperature history of meteo sensor
+ *
+ * History is kept in fixed rings: METEO_RAW_SIZE last samples and
+ * min/max/avg rollups of METEO_MINUTES_SIZE minutes, METEO_HOURS_SIZE
+ * hours and METEO_DAYS_SIZE local days, about 60 KB per sensor.
+ * Points are allocated and must be freed by caller.
+ *
+ * @param sensor Meteo sensor
+ * @param level History level
+ * @param from Range start as ClockSecondsGet() local time
+ * @param to Range end as ClockSecondsGet() local time, inclusive
+ * @param points Output list of points, oldest first
+ *
+ * @return True/False as result of getting history
+ */
+bool MeteoHistoryGet(MeteoSensor *sensor, MeteoLevel level, int64_t from, int64_t to, GList **points);
+
 /**
  * @brief Starting meteo controller
  *
+ * Rollups are loaded from disk on start and flushed every
+ * METEO_FLUSH_SEC.
+ *
  * @return Result of starting
  */
 bool MeteoControllerStart();
@@ -12,16 +12,23 @@
 #define __SECURITY_CTRL_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <glib-2.0/glib.h>
 
 #include <utils/utils.h>
 #include <core/gpio.h>
 
-#define SECURITY_DB_FILE    "security.db"
+#define SECURITY_DB_FILE            "security.db"
+#define SECURITY_DB_ZONE_PREFIX     "zone:"
 
-#define SECURITY_DETECTED_TIME_MAX_SEC  3
-#define SECURITY_SENSOR_TIME_MAX_SEC    60
+#define SECURITY_DETECT_SAMPLES         3
+#define SECURITY_DETECT_WINDOW          60
+#define SECURITY_DETECT_WINDOW_MAX      64
+#define SECURITY_SENSOR_CHECK_SEC       1
+#define SECURITY_ZONES_MAX              32
+#define SECURITY_ZONES_ALL              UINT32_MAX
+#define SECURITY_ZONE_DEFAULT           "main"
 
 typedef enum {
     SECURITY_SAVE_TYPE_STATUS,
@@ -52,15 +59,26 @@ typedef struct {
     char    id[SHORT_STR_LEN];
 } SecurityKey;
 
+typedef struct {
+    char        name[SHORT_STR_LEN];
+    unsigned    id;
+    uint64_t    *sensors;
+} SecurityZone;
+
 typedef struct {
     char                name[SHORT_STR_LEN];
+    unsigned            id;
+    uint32_t            zones;
     SecuritySensorType  type;
     GpioPin             *gpio;
     bool                telegram;
     bool                sms;
     bool                alarm;
     bool                detected;
-    unsigned            counter;
+    uint64_t            history;
+    unsigned            samples;
+    unsigned            window;
+    uint64_t            pulses;
 } SecuritySensor;
 
 /**
@@ -91,6 +109,20 @@ void SecurityEnabledSet(bool state);
  */
 SecuritySensor *SecuritySensorNew(const char *name, SecuritySensorType type, GpioPin *gpio, bool telegram, bool sms, bool alarm);
 
+/**
+ * @brief Set motion detection threshold of security sensor
+ *
+ * Sensor is detected when it was active in samples of last window
+ * checks, so detection takes from samples to window checks.
+ *
+ * @param sensor Security sensor
+ * @param samples Active samples count to detect
+ * @param window Checks count up to SECURITY_DETECT_WINDOW_MAX
+ *
+ * @return True/False as result of setting threshold
+ */
+bool SecuritySensorDetectSet(SecuritySensor *sensor, unsigned samples, unsigned window);
+
 /**
  * @brief Make new security key object
  * 
@@ -134,7 +166,7 @@ void SecurityGpioSet(SecurityGpio id, GpioPin *gpio);
 bool SecurityControllerStart();
 
 /**
- * @brief Switch status for security controller
+ * @brief Switch status for all zones of security controller
  * 
  * @param status New security status
  * @param save Save status to DB
@@ -153,6 +185,63 @@ bool SecurityStatusSet(bool status, bool save);
  */
 bool SecurityAlarmSet(bool status, bool save);
 
+/**
+ * @brief Arm or disarm security zones
+ *
+ * Sensors of changed zones are reset. Alarm is cleared when no zone
+ * which raised it stays armed.
+ *
+ * @param zones Zones bitmask, SECURITY_ZONES_ALL for all zones
+ * @param status New zones status
+ * @param save Save zones status to DB
+ *
+ * @return true/false as result of status switching
+ */
+bool SecurityZonesStatusSet(uint32_t zones, bool status, bool save);
+
+/**
+ * @brief Get armed security zones
+ *
+ * @return Armed zones bitmask
+ */
+uint32_t SecurityZonesStatusGet();
+
+/**
+ * @brief Make new security zone object
+ *
+ * @param name Name of zone
+ *
+ * @return Zone object
+ */
+SecurityZone *SecurityZoneNew(const char *name);
+
+/**
+ * @brief Add new security zone for controller
+ *
+ * Zones must be added before sensors, zone id is set on adding.
+ *
+ * @param zone New security zone
+ *
+ * @return True/False as result of adding zone
+ */
+bool SecurityZoneAdd(SecurityZone *zone);
+
+/**
+ * @brief Get security zone from controller by name
+ *
+ * @param name Security zone name
+ *
+ * @return Found security zone or NULL if not found
+ */
+SecurityZone *SecurityZoneGet(const char *name);
+
+/**
+ * @brief Get all security controller's zones
+ *
+ * @return List of zones for current security controller
+ */
+GList **SecurityZonesGet();
+
 /**
  * @brief Get security Alarm status
  */
@@ -161,7 +250,7 @@ bool SecurityAlarmGet();
 /**
  * @brief Get current security status from security controller
  * 
- * @return Current security status for current controller
+ * @return True if any zone is armed
  */
 bool SecurityStatusGet();
 
@@ -175,9 +264,14 @@ void SecurityKeyAdd(const SecurityKey *key);
 /**
  * @brief Add new security sensor for controller
  * 
+ * Sensor id is set on adding and sensor is compiled into masks
+ * of its zones, masks grow by 64 sensors words.
+ * 
  * @param sensor New security sensor 
+ * 
+ * @return True/False as result of adding sensor
  */
-void SecuritySensorAdd(const SecuritySensor *sensor);
+bool SecuritySensorAdd(SecuritySensor *sensor);
 
 /**
  * @brief Get security sensor from controller by name
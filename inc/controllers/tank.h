@@ -12,6 +12,7 @@
 #define __TANK_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <glib-2.0/glib.h>
 
@@ -23,6 +24,7 @@
 #define TANK_LEVEL_PERCENT_MIN      0
 
 #define TANK_DB_FILE    "tank.db"
+#define TANK_CHECK_SEC  1
 
 typedef enum {
     TANK_GPIO_VALVE,
@@ -58,6 +60,13 @@ typedef struct {
     bool            state;
 } TankLevel;
 
+typedef struct {
+    GpioPin         *gpio;
+    unsigned        pulses;
+    uint64_t        count;
+    float           volume;
+} TankFlow;
+
 typedef struct {
     char        name[SHORT_STR_LEN];
     GpioPin     *gpio[TANK_GPIO_MAX];
@@ -67,6 +76,7 @@ typedef struct {
     bool        pump;
     bool        valve;
     TankState   *state[TANK_STATE_MAX];
+    TankFlow    *flow;
 } Tank;
 
 /**
@@ -89,6 +99,25 @@ TankState *TankStateNew(unsigned on, unsigned off);
  */
 TankLevel *TankLevelNew(unsigned percent, GpioPin *gpio, bool notify);
 
+/**
+ * @brief Make new water flow meter object
+ *
+ * @param gpio Flow meter counter pin
+ * @param pulses Flow meter pulses per liter
+ *
+ * @return TankFlow object
+ */
+TankFlow *TankFlowNew(GpioPin *gpio, unsigned pulses);
+
+/**
+ * @brief Account water volume passed flow meter since last update
+ *
+ * @param flow Flow meter
+ *
+ * @return True/False as result of reading flow meter counter
+ */
+bool TankFlowUpdate(TankFlow *flow);
+
 /**
  * @brief Make new Tank controller
  * 
@@ -138,6 +167,14 @@ void TankLevelAdd(Tank *tank, TankLevel *level);
  */
 void TankGpioSet(Tank *tank, TankGpio id, GpioPin *gpio);
 
+/**
+ * @brief Set water flow meter for Tank controller
+ *
+ * @param tank Tank controller
+ * @param flow Flow meter object
+ */
+void TankFlowSet(Tank *tank, TankFlow *flow);
+
 /**
  * @brief Set Tank state
  * 
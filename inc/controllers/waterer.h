@@ -12,6 +12,7 @@
 #define __WATERER_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <glib-2.0/glib.h>
 
@@ -20,7 +21,11 @@
 #include <plc/plc.h>
 #include <controllers/tank.h>
 
-#define WATERER_DB_FILE    "watering.db"
+#define WATERER_DB_FILE         "watering.db"
+#define WATERER_CHECK_SEC       1
+#define WATERER_WEEK_MIN        (7 * 24 * 60)
+#define WATERER_SLEEP_MAX_SEC   3600
+#define WATERER_UPCOMING_MAX    32
 
 typedef enum {
     WATERER_GPIO_VALVE,
@@ -36,14 +41,33 @@ typedef struct {
 } WateringTime;
 
 typedef struct {
-    char    name[SHORT_STR_LEN];
-    Tank    *tank;
-    GpioPin *gpio[WATERER_GPIO_MAX];
-    GList   *times;
-    bool    status;
-    bool    valve;
+    unsigned    minute;
+    bool        state;
+    bool        notify;
+} WateringEvent;
+
+typedef struct {
+    char            name[SHORT_STR_LEN];
+    Tank            *tank;
+    GpioPin         *gpio[WATERER_GPIO_MAX];
+    GList           *times;
+    WateringEvent   *schedule;
+    unsigned        schedule_len;
+    int64_t         checked;
+    bool            status;
+    bool            valve;
+    TankFlow        *flow;
 } Waterer;
 
+typedef struct {
+    Waterer     *wtr;
+    unsigned    delay;
+    unsigned    dow;
+    unsigned    hour;
+    unsigned    min;
+    bool        state;
+} WateringAction;
+
 /**
  * @brief Make new Waterer object
  * 
@@ -81,6 +105,14 @@ WateringTime *WateringTimeNew(PlcTime time, bool state, bool notify);
  */
 void WatererGpioSet(Waterer *wtr, WatererGpioType type, GpioPin *gpio);
 
+/**
+ * @brief Set water flow meter for Waterer
+ *
+ * @param wtr Waterer object
+ * @param flow Flow meter object
+ */
+void WatererFlowSet(Waterer *wtr, TankFlow *flow);
+
 /**
  * @brief Add new tank to list
  * 
@@ -133,8 +165,24 @@ bool WatererStatusGet(Waterer *wtr, bool *status);
  */
 bool WatererValveSet(Waterer *wtr, bool status);
 
+/**
+ * @brief Get upcoming watering actions of enabled Waterers
+ *
+ * Actions are taken from compiled weekly schedules and sorted by time.
+ *
+ * @param actions Output actions array
+ * @param count Max actions count
+ *
+ * @return Count of actions
+ */
+unsigned WatererUpcomingGet(WateringAction *actions, unsigned count);
+
 /**
  * @brief Start all Waterer controllers
+ *
+ * Watering times are compiled to sorted weekly schedules, controller
+ * sleeps until next event and catches up event missed by clock step
+ * or stall.
  * 
  * @return True/False as result of starting
  */
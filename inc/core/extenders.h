@@ -12,8 +12,35 @@
 #define __EXTENDERS_H__
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <threads.h>
 
 #include <utils/utils.h>
+#include <core/i2c.h>
+
+#define EXT_PCF_8574_PINS       8
+#define EXT_MCP_23017_PINS      16
+#define EXT_ADS_1115_PINS       4
+
+#define EXT_INT_RESYNC_SEC      60
+
+#define EXT_MCP_23017_IODIRA    0x00
+#define EXT_MCP_23017_GPINTENA  0x04
+#define EXT_MCP_23017_INTCONA   0x08
+#define EXT_MCP_23017_IOCON     0x0A
+#define EXT_MCP_23017_GPPUA     0x0C
+#define EXT_MCP_23017_GPIOA     0x12
+#define EXT_MCP_23017_OLATA     0x14
+
+#define EXT_MCP_23017_IOCON_MIRROR  0x40
+
+#define EXT_ADS_1115_CONV       0x00
+#define EXT_ADS_1115_CONFIG     0x01
+#define EXT_ADS_1115_OS         0x8000
+#define EXT_ADS_1115_SINGLE     0x8383  /* +-4.096V, single shot, 128 SPS, no comparator */
+#define EXT_ADS_1115_CONTINUOUS 0x02E3  /* +-4.096V, continuous, 860 SPS, no comparator */
+#define EXT_ADS_1115_CONV_MSEC  8
+#define EXT_ADS_1115_CONV_TRIES 4
 
 typedef enum {
     EXT_TYPE_PCF_8574,
@@ -27,6 +54,17 @@ typedef struct {
     unsigned        bus;
     unsigned        addr;
     unsigned        base;
+    I2cDevice       dev;
+    bool            online;
+    uint16_t        in;
+    uint16_t        out;
+    uint16_t        inputs;
+    uint16_t        pullups;
+    bool            dirty;
+    char            int_pin[SHORT_STR_LEN];
+    bool            pending;
+    uint64_t        synced;
+    mtx_t           mtx;
 } Extender;
 
 /**
@@ -50,6 +88,144 @@ Extender *ExtenderNew(const char *name, ExtenderType type, unsigned bus, unsigne
  * 
  * @return Result of extender addition
  */
-bool ExtenderAdd(const Extender *ext, char *err);
+bool ExtenderAdd(Extender *ext, char *err);
+
+/**
+ * @brief Get all extenders list
+ *
+ * @return Extenders list
+ */
+GList **ExtendersGet();
+
+/**
+ * @brief Set interrupt GPIO of extender
+ *
+ * Ports of extenders with interrupt are read by ExtendersRead() only
+ * after ExtenderIntRaise() and every EXT_INT_RESYNC_SEC.
+ *
+ * @param ext Extender
+ * @param pin Name of native GPIO connected to INT output
+ */
+void ExtenderIntSet(Extender *ext, const char *pin);
+
+/**
+ * @brief Mark extender port as changed by interrupt
+ *
+ * @param ext Extender
+ */
+void ExtenderIntRaise(Extender *ext);
+
+/**
+ * @brief Get extender which owns GPIO pin number
+ *
+ * @param pin GPIO pin number
+ *
+ * @return Extender object or NULL for native pins
+ */
+Extender *ExtenderPinGet(unsigned pin);
+
+/**
+ * @brief Set direction of extender pin
+ *
+ * @param ext Extender
+ * @param pin GPIO pin number
+ * @param input Input or output direction
+ * @param pullup Enable internal pull-up if supported
+ *
+ * @return True/False as result of configuring pin
+ */
+bool ExtenderPinModeSet(Extender *ext, unsigned pin, bool input, bool pullup);
+
+/**
+ * @brief Read extender pin from port image
+ *
+ * When writes are not deferred the port is read from device first.
+ *
+ * @param ext Extender
+ * @param pin GPIO pin number
+ * @param state Pin state
+ *
+ * @return True/False as result of reading
+ */
+bool ExtenderPinRead(Extender *ext, unsigned pin, bool *state);
+
+/**
+ * @brief Read ADS1115 extender channel by single shot conversion
+ *
+ * @param ext Extender
+ * @param pin GPIO pin number
+ * @param value Conversion result
+ *
+ * @return True/False as result of reading
+ */
+bool ExtenderPinReadA(Extender *ext, unsigned pin, int *value);
+
+/**
+ * @brief Start ADS1115 extender continuous conversion of channel
+ *
+ * @param ext Extender
+ * @param pin GPIO pin number of channel
+ *
+ * @return True/False as result of starting conversion
+ */
+bool ExtenderAdcStart(Extender *ext, unsigned pin);
+
+/**
+ * @brief Read last ADS1115 extender continuous conversion result
+ *
+ * @param ext Extender
+ * @param value Conversion result
+ *
+ * @return True/False as result of reading
+ */
+bool ExtenderAdcRead(Extender *ext, int *value);
+
+/**
+ * @brief Write extender pin to output shadow register
+ *
+ * When writes are deferred the port is committed by ExtendersWrite().
+ *
+ * @param ext Extender
+ * @param pin GPIO pin number
+ * @param state Pin state
+ *
+ * @return True/False as result of writing
+ */
+bool ExtenderPinWrite(Extender *ext, unsigned pin, bool state);
+
+/**
+ * @brief Write byte stream to PCF8574 extender port in one transaction
+ *
+ * Each byte is latched to port in turn, so devices wired to whole port
+ * like HD44780 backpack are clocked by a single I2C write.
+ *
+ * @param ext Extender
+ * @param buf Port values
+ * @param len Values count
+ *
+ * @return True/False as result of writing
+ */
+bool ExtenderStreamWrite(Extender *ext, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Defer extender writes until ExtendersWrite()
+ *
+ * @param defer Defer flag
+ */
+void ExtendersDeferSet(bool defer);
+
+/**
+ * @brief Read input ports of all extenders, one transaction per port
+ *
+ * @return True/False as result of reading
+ */
+bool ExtendersRead();
+
+/**
+ * @brief Commit changed output shadow registers, one write per port
+ *
+ * @return True/False as result of writing
+ */
+bool ExtendersWrite();
 
 #endif /* __EXTENDERS_H__ */
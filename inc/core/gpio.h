@@ -16,6 +16,9 @@
 #include <glib-2.0/glib.h>
 
 #include <utils/utils.h>
+#include <core/extenders.h>
+
+#define GPIO_LINE_NONE  -1
 
 typedef enum {
     GPIO_TYPE_DIGITAL,
@@ -39,6 +42,13 @@ typedef struct {
     unsigned    pin;
     GpioMode    mode;
     GpioPull    pull;
+    unsigned    id;
+    unsigned    filter;
+    bool        counter;
+    unsigned    chip;
+    int         line;
+    int         fd;
+    Extender    *ext;
 } GpioPin;
 
 /**
@@ -69,7 +79,35 @@ bool GpioInit();
  * 
  * @return true/false as result of addition new GPIO
  */
-bool GpioPinAdd(const GpioPin *pin, char *err);
+bool GpioPinAdd(GpioPin *pin, char *err);
+
+/**
+ * @brief Set GPIO debounce filter window
+ *
+ * @param pin GPIO pin
+ * @param msec Time in milliseconds input must be stable, 0 for default
+ */
+void GpioPinFilterSet(GpioPin *pin, unsigned msec);
+
+/**
+ * @brief Count pulses of digital input
+ *
+ * Rising edges are counted before debounce filter, so pulses shorter
+ * than filter window are not lost.
+ *
+ * @param pin GPIO pin
+ * @param counter Count pulses of pin
+ */
+void GpioPinCounterSet(GpioPin *pin, bool counter);
+
+/**
+ * @brief Bind GPIO to the kernel GPIO character device line
+ *
+ * @param pin GPIO pin
+ * @param chip GPIO chip number of /dev/gpiochipN
+ * @param line Line offset of the chip
+ */
+void GpioPinLineSet(GpioPin *pin, unsigned chip, int line);
 
 /**
  * @brief Get GPIO by name
@@ -80,6 +118,25 @@ bool GpioPinAdd(const GpioPin *pin, char *err);
  */
 GpioPin *GpioPinGet(const char *name);
 
+/**
+ * @brief Resolve GPIO name to stable id
+ *
+ * @param name GPIO name
+ * @param id Output GPIO id
+ *
+ * @return True/False as result of resolving
+ */
+bool GpioPinIdGet(const char *name, unsigned *id);
+
+/**
+ * @brief Get GPIO by id
+ *
+ * @param id GPIO id
+ *
+ * @return GPIO struct or NULL if not found
+ */
+GpioPin *GpioPinByIdGet(unsigned id);
+
 /**
  * @brief Get All GPIOs list
  * 
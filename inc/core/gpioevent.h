@@ -0,0 +1,91 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __GPIO_EVENT_H__
+#define __GPIO_EVENT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <core/gpio.h>
+
+#define GPIO_EVENT_CHIP_PATH    "/dev/gpiochip"
+#define GPIO_EVENT_POLL_MSEC    20
+#define GPIO_EVENT_SETTLE_MSEC  20
+#define GPIO_EVENTS_MAX         16
+
+typedef enum {
+    GPIO_EDGE_RISING = 0x1,
+    GPIO_EDGE_FALLING = 0x2,
+    GPIO_EDGE_BOTH = 0x3
+} GpioEdge;
+
+typedef struct {
+    GpioPin     *pin;
+    bool        state;
+    uint64_t    ts;
+} GpioEvent;
+
+typedef void (*GpioEventHandler)(const GpioEvent *event, void *data);
+
+/**
+ * @brief Subscribe to GPIO edges
+ *
+ * Pins bound to a GPIO character device line are watched by kernel
+ * line events, other pins are sampled by software every
+ * GPIO_EVENT_POLL_MSEC. Edges are delivered after the line was stable
+ * for the pin filter window (GPIO_EVENT_SETTLE_MSEC by default) with
+ * timestamp of the first edge.
+ *
+ * @param pin GPIO pin
+ * @param edge Edges to deliver
+ * @param handler Edge handler called from events thread
+ * @param data Handler user data
+ *
+ * @return True/False as result of subscription
+ */
+bool GpioEventAdd(GpioPin *pin, GpioEdge edge, GpioEventHandler handler, void *data);
+
+/**
+ * @brief Get count of kernel rising edges of counter GPIO
+ *
+ * Only pins watched by kernel line events are counted here.
+ *
+ * @param pin Counter GPIO pin
+ * @param pulses Rising edges since subscription
+ *
+ * @return True/False as result of getting count
+ */
+bool GpioEventPulsesGet(const GpioPin *pin, uint64_t *pulses);
+
+/**
+ * @brief Inject fake GPIO edge
+ *
+ * Once injected the pin is driven only by fake edges and is no longer
+ * sampled, so event consumers can be tested on boards without lines.
+ *
+ * @param pin GPIO pin
+ * @param state New pin state
+ *
+ * @return True/False as result of injection
+ */
+bool GpioEventInject(GpioPin *pin, bool state);
+
+/**
+ * @brief Start GPIO events processing
+ *
+ * Line events are read on event loop, settle deadlines and polling
+ * of lines without kernel events are served by timer.
+ *
+ * @return True/False as result of starting processing
+ */
+bool GpioEventStart();
+
+#endif /* __GPIO_EVENT_H__ */
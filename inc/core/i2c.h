@@ -0,0 +1,94 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __I2C_H__
+#define __I2C_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define I2C_DEV_PATH    "/dev/i2c-"
+#define I2C_BUF_MAX     256
+
+typedef struct {
+    int         fd;
+    unsigned    bus;
+    unsigned    addr;
+    bool        sim;
+} I2cDevice;
+
+/**
+ * @brief Open I2C slave device
+ *
+ * With simulated hardware the device is bound to virtual device.
+ *
+ * @param dev Device struct to fill
+ * @param bus I2C bus number
+ * @param addr Slave address
+ *
+ * @return True/False as result of opening device
+ */
+bool I2cOpen(I2cDevice *dev, unsigned bus, unsigned addr);
+
+/**
+ * @brief Close I2C slave device
+ *
+ * @param dev I2C device
+ */
+void I2cClose(I2cDevice *dev);
+
+/**
+ * @brief Write bytes to device in one transaction
+ *
+ * @param dev I2C device
+ * @param buf Bytes to write
+ * @param len Bytes count
+ *
+ * @return True/False as result of writing
+ */
+bool I2cWrite(I2cDevice *dev, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Read bytes from device in one transaction
+ *
+ * @param dev I2C device
+ * @param buf Output bytes
+ * @param len Bytes count
+ *
+ * @return True/False as result of reading
+ */
+bool I2cRead(I2cDevice *dev, uint8_t *buf, size_t len);
+
+/**
+ * @brief Write device registers starting from reg in one transaction
+ *
+ * @param dev I2C device
+ * @param reg First register address
+ * @param buf Register values
+ * @param len Registers count
+ *
+ * @return True/False as result of writing
+ */
+bool I2cRegWrite(I2cDevice *dev, uint8_t reg, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Read device registers starting from reg with repeated start
+ *
+ * @param dev I2C device
+ * @param reg First register address
+ * @param buf Register values
+ * @param len Registers count
+ *
+ * @return True/False as result of reading
+ */
+bool I2cRegRead(I2cDevice *dev, uint8_t reg, uint8_t *buf, size_t len);
+
+#endif /* __I2C_H__ */
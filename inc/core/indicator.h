@@ -0,0 +1,92 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __INDICATOR_H__
+#define __INDICATOR_H__
+
+#include <stdbool.h>
+
+#include <core/gpio.h>
+
+#define INDICATOR_STEPS_MAX     8
+#define INDICATOR_HOLD          0
+
+typedef enum {
+    INDICATOR_PRIO_STATUS,
+    INDICATOR_PRIO_ALARM,
+    INDICATOR_PRIO_NOTICE,
+    INDICATOR_PRIO_MAX
+} IndicatorPrio;
+
+typedef struct {
+    bool        state;
+    unsigned    msec;
+} IndicatorStep;
+
+typedef struct {
+    unsigned        count;
+    unsigned        repeat;
+    IndicatorStep   steps[INDICATOR_STEPS_MAX];
+} IndicatorPattern;
+
+/**
+ * @brief Play on/off pattern on indicator pin
+ *
+ * Steps are played in order, each one holds pin state for step msec.
+ * Step with INDICATOR_HOLD msec holds state until pattern is stopped.
+ * Pattern is played repeat times, 0 repeats it until it is stopped.
+ *
+ * Each priority has own pattern slot, pin plays pattern of highest
+ * used slot. When pattern is finished or stopped, preempted pattern
+ * is played again from the beginning. Playing the same pattern again
+ * does not restart it.
+ *
+ * Call does not wait for pin writes.
+ *
+ * @param pin Indicator GPIO pin
+ * @param pattern Pattern to play, it is copied
+ * @param prio Pattern priority
+ *
+ * @return True/False as result of queuing pattern
+ */
+bool IndicatorPlay(GpioPin *pin, const IndicatorPattern *pattern, IndicatorPrio prio);
+
+/**
+ * @brief Stop pattern of priority on indicator pin
+ *
+ * @param pin Indicator GPIO pin
+ * @param prio Pattern priority
+ *
+ * @return True/False as result of stopping pattern
+ */
+bool IndicatorStop(GpioPin *pin, IndicatorPrio prio);
+
+/**
+ * @brief Set steady indicator pin state
+ *
+ * State is held in INDICATOR_PRIO_STATUS slot.
+ *
+ * @param pin Indicator GPIO pin
+ * @param state Pin state
+ *
+ * @return True/False as result of setting state
+ */
+bool IndicatorSet(GpioPin *pin, bool state);
+
+/**
+ * @brief Start indicators sequencer
+ *
+ * Patterns queued before start are played after it.
+ *
+ * @return True/False as result of starting sequencer
+ */
+bool IndicatorStart();
+
+#endif /* __INDICATOR_H__ */
@@ -12,15 +12,26 @@
 #define __LCD_H__
 
 #include <stdbool.h>
+#include <threads.h>
 
 #include <glib-2.0/glib.h>
 
 #include <utils/utils.h>
+#include <core/extenders.h>
 
 #define LCD_INIT_RETRIES    3
 #define LCD_ROWS            2
 #define LCD_COLS            16
 #define LCD_BITS            4
+#define LCD_TX_MAX          I2C_BUF_MAX
+#define LCD_BENCH_FRAMES    20
+
+#define LCD_CMD_CLEAR       0x01
+#define LCD_CMD_ENTRY       0x06
+#define LCD_CMD_DISPLAY     0x0C
+#define LCD_CMD_FUNCTION    0x28
+#define LCD_CMD_DDRAM       0x80
+#define LCD_ROW_ADDR        0x40
 
 #define LCD_DEFAULT_TEXT_UP     "  FUTURE  CITY  "
 #define LCD_DEFAULT_TEXT_DOWN   "       PLC      "
@@ -35,6 +46,18 @@ typedef struct {
     unsigned    d5;
     unsigned    d6;
     unsigned    d7;
+    int         fd;
+    char        frame[LCD_ROWS][LCD_COLS];
+    char        shadow[LCD_ROWS][LCD_COLS];
+    unsigned    row;
+    unsigned    col;
+    unsigned    hw_row;
+    unsigned    hw_col;
+    Extender    *ext;
+    uint8_t     tx[LCD_TX_MAX];
+    unsigned    tx_len;
+    unsigned    writes;
+    mtx_t       mtx;
 } LCD;
 
 /**
@@ -71,34 +94,69 @@ LCD *LcdGet(const char *name);
 /**
  * @brief Add new I2C LCD module
  * 
+ * When all LCD pins belong to one PCF8574 extender display is driven
+ * by own transport: each character is packed as 4 port values with
+ * enable strobes and whole flush is sent in one I2C write.
+ * 
  * @param lcd LCD module struct
  * 
  * @return true/false as result of initialization of module
  */
-bool LcdAdd(const LCD *lcd);
+bool LcdAdd(LCD *lcd);
 
 /**
- * @brief Print text on LCD
+ * @brief Print text to LCD frame buffer
+ * 
+ * Text past the end of row is dropped. Display is updated by
+ * LcdFlush().
  * 
  * @param lcd LCD module struct
  * @param text Text message
  */
-void LcdPrint(const LCD *lcd, char *text);
+void LcdPrint(LCD *lcd, const char *text);
 
 /**
- * @brief Changing position of LCD text
+ * @brief Changing position of LCD frame buffer text
  * 
  * @param lcd LCD module struct
  * @param row Display row
  * @param col Display column
  */
-void LcdPosSet(const LCD *lcd, unsigned row, unsigned col);
+void LcdPosSet(LCD *lcd, unsigned row, unsigned col);
+
+/**
+ * @brief Clear LCD frame buffer
+ * 
+ * Display itself is not cleared, so redrawn frame does not flicker.
+ * 
+ * @param lcd LCD module struct
+ */
+void LcdClear(LCD *lcd);
 
 /**
- * @brief Clear text on LCD
+ * @brief Send changed cells of frame buffer to display
+ * 
+ * Frame buffer is compared with display shadow buffer and only
+ * changed runs of cells are written, cursor is moved only between
+ * runs.
  * 
  * @param lcd LCD module struct
+ * 
+ * @return true/false as result of updating display
+ */
+bool LcdFlush(LCD *lcd);
+
+/**
+ * @brief Measure LCD throughput by full frame redraws
+ * 
+ * Frame buffer is cleared after measurement.
+ * 
+ * @param lcd LCD module struct
+ * @param cps Characters per second
+ * @param writes Bus transactions per frame
+ * 
+ * @return true/false as result of measurement
  */
-void LcdClear(const LCD *lcd);
+bool LcdBenchmark(LCD *lcd, unsigned *cps, unsigned *writes);
 
 #endif /* __LCD_H__ */
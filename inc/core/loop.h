@@ -0,0 +1,77 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __LOOP_H__
+#define __LOOP_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LOOP_EVENTS_MAX     16
+#define LOOP_WORKERS        4
+#define LOOP_QUEUE_LEN      128
+#define LOOP_STACK_SIZE     (256 * 1024)
+
+typedef struct {
+    unsigned    depth;
+    unsigned    depth_max;
+    uint64_t    queued;
+    uint64_t    dropped;
+} LoopStats;
+
+typedef void (*LoopHandler)(void *data);
+
+typedef void (*LoopFdHandler)(int fd, uint32_t events, void *data);
+
+/**
+ * @brief Watch file descriptor readiness in event loop
+ *
+ * Handler is called on loop thread and must not block, blocking
+ * calls are passed to workers by LoopWorkAdd().
+ *
+ * @param fd File descriptor
+ * @param events Epoll events mask
+ * @param handler Readiness handler
+ * @param data User data for handler
+ *
+ * @return True/False as result of adding watcher
+ */
+bool LoopFdAdd(int fd, uint32_t events, LoopFdHandler handler, void *data);
+
+/**
+ * @brief Queue blocking work to worker pool
+ *
+ * Queue is bounded by LOOP_QUEUE_LEN, work is dropped when it is full
+ * and counted in loop metrics.
+ *
+ * @param handler Work handler
+ * @param data User data for handler
+ *
+ * @return True/False as result of queuing work
+ */
+bool LoopWorkAdd(LoopHandler handler, void *data);
+
+/**
+ * @brief Get worker queue metrics
+ *
+ * @param stats Worker queue metrics
+ */
+void LoopStatsGet(LoopStats *stats);
+
+/**
+ * @brief Start event loop and worker pool
+ *
+ * Default stack of threads created after start is LOOP_STACK_SIZE.
+ *
+ * @return True/False as result of starting loop
+ */
+bool LoopStart();
+
+#endif /* __LOOP_H__ */
@@ -17,8 +17,15 @@
 
 #include <utils/utils.h>
 
-#define ONE_WIRE_PATH               "/sys/bus/w1/devices"
-#define ONE_WIRE_SLAVES_PATH        "/sys/bus/w1/drivers/w1_master_driver/w1_bus_master1/w1_master_slaves"
+#define ONE_WIRE_ROOT_PATH          "/sys/bus/w1"
+#define ONE_WIRE_PATH               "devices"
+#define ONE_WIRE_SLAVES_PATH        "drivers/w1_master_driver/w1_bus_master1/w1_master_slaves"
+#define ONE_WIRE_BULK_PATH          "drivers/w1_master_driver/w1_bus_master1/therm_bulk_read"
+
+#define ONE_WIRE_CONVERT_MSEC       750
+#define ONE_WIRE_POLL_MSEC          50
+#define ONE_WIRE_SCAN_MSEC          1000
+#define ONE_WIRE_SLAVES_LEN         4096
 
 #define ONE_WIRE_DS18B20_PREFIX     "28"
 #define ONE_WIRE_IBUTTON_PREFIX     "01"
@@ -29,9 +36,21 @@ typedef struct {
     char    value[SHORT_STR_LEN];
 } OneWireData;
 
+typedef void (*OneWireHandler)(const char *id, bool present, void *data);
+
+/**
+ * @brief Set 1-Wire sysfs root path
+ * 
+ * @param path Root path, ONE_WIRE_ROOT_PATH by default
+ */
+void OneWireRootSet(const char *path);
+
 /**
  * @brief Read all detected 1-Wire bus devices
  * 
+ * Devices are taken from table cached from w1 master slaves list,
+ * which is reparsed only when the list changes.
+ * 
  * @param keys Readed devices list
  * 
  * @return true/false as result of reading devices
@@ -39,17 +58,45 @@ typedef struct {
 bool OneWireDevicesList(GList **devices);
 
 /**
- * @brief Read all detected iButton keys on 1-Wire bus
+ * @brief Subscribe to 1-Wire devices presence changes
+ * 
+ * Handler is called from 1-Wire scan thread with device id without
+ * family prefix when device appears on bus or disappears from it.
  * 
- * @param keys Readed keys list
+ * @param prefix Device family prefix
+ * @param handler Presence handler
+ * @param data Handler user data
  * 
- * @return true/false as result of reading keys
+ * @return true/false as result of subscription
  */
-bool OneWireKeysRead(GList **keys);
+bool OneWireSubscribe(const char *prefix, OneWireHandler handler, void *data);
+
+/**
+ * @brief Start 1-Wire scan thread
+ * 
+ * Slaves list is rescanned every ONE_WIRE_SCAN_MSEC.
+ * 
+ * @return true/false as result of starting thread
+ */
+bool OneWireStart();
+
+/**
+ * @brief Convert temperature on all DS18B20 sensors simultaneously
+ * 
+ * Triggers w1 master bulk conversion and waits until it completes.
+ * Following OneWireTempRead() calls return converted values without
+ * starting conversion per sensor.
+ * 
+ * @return true/false as result of conversion, false if bulk read is
+ * not supported by w1 master
+ */
+bool OneWireTempConvert();
 
 /**
  * @brief Read DS18B20 sensor temperature by ID on 1-Wire bus
  * 
+ * Temperature file is kept open between reads.
+ * 
  * @param id DS18B20 sensor id
  * @param temp Output temperature
  * 
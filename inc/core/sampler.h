@@ -0,0 +1,94 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+#include <stdbool.h>
+
+#include <core/gpio.h>
+
+#define SAMPLER_RING_LEN        64
+#define SAMPLER_WINDOW          8
+#define SAMPLER_WINDOW_MAX      (SAMPLER_RING_LEN / 2)
+#define SAMPLER_OVERSAMPLE      4
+#define SAMPLER_CYCLE_MSEC      10
+#define SAMPLER_SETTLE_MSEC     3
+#define SAMPLER_CONV_MSEC       2
+#define SAMPLER_READ_TRIES      4
+
+/**
+ * @brief Check if analog pin is sampled continuously
+ *
+ * @param pin Analog GPIO pin
+ *
+ * @return True/False as sampling state
+ */
+bool SamplerHas(const GpioPin *pin);
+
+/**
+ * @brief Get last samples of analog pin
+ *
+ * Samples are copied from ring buffer without locking and I2C access.
+ *
+ * @param pin Analog GPIO pin
+ * @param buf Samples buffer, oldest first
+ * @param count Samples count, up to SAMPLER_WINDOW_MAX
+ *
+ * @return Count of copied samples
+ */
+unsigned SamplerWindowGet(const GpioPin *pin, int *buf, unsigned count);
+
+/**
+ * @brief Get moving average of last samples of analog pin
+ *
+ * @param pin Analog GPIO pin
+ * @param window Samples count, up to SAMPLER_WINDOW_MAX
+ * @param value Average value
+ *
+ * @return True/False as result of getting value
+ */
+bool SamplerMeanGet(const GpioPin *pin, unsigned window, int *value);
+
+/**
+ * @brief Get median of last samples of analog pin
+ *
+ * @param pin Analog GPIO pin
+ * @param window Samples count, up to SAMPLER_WINDOW_MAX
+ * @param value Median value
+ *
+ * @return True/False as result of getting value
+ */
+bool SamplerMedianGet(const GpioPin *pin, unsigned window, int *value);
+
+/**
+ * @brief Get filtered value of analog pin
+ *
+ * Moving average of last SAMPLER_WINDOW samples.
+ *
+ * @param pin Analog GPIO pin
+ * @param value Filtered value
+ *
+ * @return True/False as result of getting value
+ */
+bool SamplerValueGet(const GpioPin *pin, int *value);
+
+/**
+ * @brief Start continuous sampling of ADS1115 extenders analog pins
+ *
+ * Each extender is sampled by own thread. Every cycle each channel is
+ * read SAMPLER_OVERSAMPLE times in continuous conversion mode and the
+ * mean is stored to channel ring buffer.
+ *
+ * @return True/False as result of starting sampling
+ */
+bool SamplerStart();
+
+#endif /* __SAMPLER_H__ */
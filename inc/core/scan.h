@@ -0,0 +1,141 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __SCAN_H__
+#define __SCAN_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <core/gpio.h>
+#include <core/gpioevent.h>
+
+#define SCAN_CYCLE_MSEC     20
+#define SCAN_FILTER_MSEC    50
+#define SCAN_VOTE_SAMPLES   3
+#define SCAN_PRIORITY_MAX   99
+#define SCAN_EDGES_LEN      256
+
+#define SCAN_COUNTER_WINDOW_MSEC    1000
+
+typedef struct {
+    uint64_t    cycles;
+    uint64_t    overruns;
+    uint64_t    trips;
+    uint64_t    dropped;
+    unsigned    period;
+    unsigned    exec_last;
+    unsigned    exec_avg;
+    unsigned    exec_max;
+    unsigned    jitter_last;
+    unsigned    jitter_avg;
+    unsigned    jitter_max;
+} ScanStats;
+
+typedef struct {
+    uint64_t    pulses;
+    float       rate;
+} ScanCounter;
+
+/**
+ * @brief Set input scan cycle period
+ *
+ * @param msec Cycle period in milliseconds
+ */
+void ScanCycleSet(unsigned msec);
+
+/**
+ * @brief Set real-time priority of scan thread
+ *
+ * Non zero priority runs scan thread with SCHED_FIFO policy and locks
+ * process memory on start.
+ *
+ * @param priority SCHED_FIFO priority 1..SCAN_PRIORITY_MAX or 0 to disable
+ */
+void ScanPrioritySet(unsigned priority);
+
+/**
+ * @brief Set scan cycle watchdog
+ *
+ * After given count of overrun cycles in a row digital outputs are
+ * set low as safe state.
+ *
+ * @param overruns Overruns in a row to trip or 0 to disable
+ */
+void ScanWatchdogSet(unsigned overruns);
+
+/**
+ * @brief Get scan cycle metrics
+ *
+ * Times are in microseconds. Jitter is delay of cycle start after its
+ * deadline, overrun is cycle finished after next deadline. Dropped
+ * are input edges lost by full delivery queue.
+ *
+ * @param stats Scan metrics
+ *
+ * @return True/False as result of getting metrics
+ */
+bool ScanStatsGet(ScanStats *stats);
+
+/**
+ * @brief Subscribe to debounced input changes
+ *
+ * Edges are queued by scan cycle and GPIO events thread and handlers
+ * are called in edge order on loop worker, out of input image lock.
+ * Queue is bounded by SCAN_EDGES_LEN.
+ *
+ * @param pin Input GPIO pin
+ * @param edge Edges to deliver
+ * @param handler Change handler
+ * @param data Handler user data
+ *
+ * @return True/False as result of subscription
+ */
+bool ScanSubscribe(GpioPin *pin, GpioEdge edge, GpioEventHandler handler, void *data);
+
+/**
+ * @brief Get debounced input state from input image
+ *
+ * @param pin Input GPIO pin
+ * @param state Input state
+ *
+ * @return True/False as result of getting state
+ */
+bool ScanInputGet(const GpioPin *pin, bool *state);
+
+/**
+ * @brief Get pulse counter of counter input
+ *
+ * Inputs bound to a gpiochip line count every kernel rising edge,
+ * sampled inputs count rising edges seen by scan cycle, so their
+ * pulse rate is limited by half of scan cycle frequency. Rate is
+ * updated when at least SCAN_COUNTER_WINDOW_MSEC passed since last
+ * update.
+ *
+ * @param pin Counter GPIO pin
+ * @param counter Total pulses and pulses per second of last window
+ *
+ * @return True/False as result of getting counter
+ */
+bool ScanCounterGet(const GpioPin *pin, ScanCounter *counter);
+
+/**
+ * @brief Start input scan thread
+ *
+ * Each cycle reads extender ports once, samples inputs and commits
+ * extender outputs changed during the cycle in one write per port.
+ * Cycles start at absolute deadlines, interrupt raised ports are
+ * read on next deadline.
+ *
+ * @return True/False as result of starting scan
+ */
+bool ScanStart();
+
+#endif /* __SCAN_H__ */
@@ -0,0 +1,169 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIM_PINS_MAX        1024
+#define SIM_REGS_MAX        32
+#define SIM_TREE_TEMPLATE   "/tmp/plc-sim-XXXXXX"
+
+#define SIM_ADS_1115_CONV   0x00
+#define SIM_ADS_1115_CONFIG 0x01
+#define SIM_ADS_1115_OS     0x8000
+#define SIM_ADS_1115_SINGLE 0x0100
+
+#define SIM_DS_3231_TIME    0x00
+#define SIM_DS_3231_REGS    0x13
+
+typedef enum {
+    SIM_DEV_PCF_8574,
+    SIM_DEV_MCP_23017,
+    SIM_DEV_ADS_1115,
+    SIM_DEV_DS_3231
+} SimDeviceType;
+
+/**
+ * @brief Enable simulated hardware backend
+ *
+ * Must be called before GPIO init. Creates fake 1-Wire sysfs tree
+ * and switches GPIO, I2C and 1-Wire access to virtual devices.
+ *
+ * Script is a text file of "<msec> <command> <args>" lines, where
+ * msec is offset from script start:
+ *   <msec> gpio <name> <0|1>       drive digital input
+ *   <msec> analog <name> <value>   set analog input value
+ *   <msec> temp <id> <celsius>     attach DS18B20 and set temperature
+ *   <msec> key <id> <on|off>       attach/detach iButton key
+ *   <msec> loop                    restart script from beginning
+ * Lines starting with '#' are comments.
+ *
+ * @param script Path to script file or NULL
+ *
+ * @return True/False as result of init
+ */
+bool SimInit(const char *script);
+
+/**
+ * @brief Check if simulated hardware backend is enabled
+ *
+ * @return True/False as simulation state
+ */
+bool SimEnabled();
+
+/**
+ * @brief Read virtual digital pin
+ *
+ * @param pin Pin number
+ * @param state Pin level
+ *
+ * @return True/False as result of reading pin
+ */
+bool SimPinRead(unsigned pin, bool *state);
+
+/**
+ * @brief Write virtual digital pin
+ *
+ * Pins driven by script keep script level.
+ *
+ * @param pin Pin number
+ * @param state Pin level
+ *
+ * @return True/False as result of writing pin
+ */
+bool SimPinWrite(unsigned pin, bool state);
+
+/**
+ * @brief Read virtual analog pin
+ *
+ * @param pin Pin number
+ * @param value Pin value
+ *
+ * @return True/False as result of reading pin
+ */
+bool SimPinReadA(unsigned pin, int *value);
+
+/**
+ * @brief Write virtual analog pin
+ *
+ * @param pin Pin number
+ * @param value Pin value
+ */
+void SimPinWriteA(unsigned pin, int value);
+
+/**
+ * @brief Attach virtual I2C device
+ *
+ * Device pins are mapped to virtual pin bank starting from base.
+ * Virtual RTC starts from current local time and runs by monotonic
+ * clock, it can be set by writing time registers.
+ *
+ * @param type Device type
+ * @param bus I2C bus number
+ * @param addr Slave address
+ * @param base First pin number
+ *
+ * @return True/False as result of attaching device
+ */
+bool SimDeviceAdd(SimDeviceType type, unsigned bus, unsigned addr, unsigned base);
+
+/**
+ * @brief Check if virtual I2C device is attached
+ *
+ * @param bus I2C bus number
+ * @param addr Slave address
+ *
+ * @return True/False as device presence
+ */
+bool SimDeviceFound(unsigned bus, unsigned addr);
+
+/**
+ * @brief Attach interrupt output of virtual I2C device to pin
+ *
+ * Pin goes low on input changes and is released by port read.
+ *
+ * @param bus I2C bus number
+ * @param addr Slave address
+ * @param pin Pin number
+ *
+ * @return True/False as result of attaching interrupt
+ */
+bool SimDeviceIntSet(unsigned bus, unsigned addr, unsigned pin);
+
+/**
+ * @brief Transfer data with virtual I2C device
+ *
+ * Write part is done first, then read part as after repeated start.
+ *
+ * @param bus I2C bus number
+ * @param addr Slave address
+ * @param wbuf Data to write
+ * @param wlen Write data length
+ * @param rbuf Buffer for read data
+ * @param rlen Read data length
+ *
+ * @return True/False as result of transfer
+ */
+bool SimI2cTransfer(unsigned bus, unsigned addr, const uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen);
+
+/**
+ * @brief Start script player thread
+ *
+ * GPIO names are resolved on start, so configs must be loaded.
+ *
+ * @return True/False as result of starting player
+ */
+bool SimStart();
+
+#endif /* __SIM_H__ */
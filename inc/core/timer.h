@@ -0,0 +1,119 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_TICK_MSEC     10
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK    (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS  4
+
+typedef void (*TimerHandler)(void *data);
+
+typedef struct _Timer Timer;
+
+/**
+ * @brief Create new disarmed timer
+ *
+ * Handler is called on event loop thread in expiration order and must
+ * not block. Same timer handler is never called concurrently,
+ * expiration during handler call is coalesced to one more call after it.
+ *
+ * @param handler Expiration handler
+ * @param data User data for handler
+ *
+ * @return Timer or NULL
+ */
+Timer *TimerNew(TimerHandler handler, void *data);
+
+/**
+ * @brief Create new disarmed timer for blocking handler
+ *
+ * Handler is called on event loop worker, so it may do bus, file or
+ * network I/O. Calls are coalesced as for TimerNew().
+ *
+ * @param handler Expiration handler
+ * @param data User data for handler
+ *
+ * @return Timer or NULL
+ */
+Timer *TimerBlockingNew(TimerHandler handler, void *data);
+
+/**
+ * @brief Arm periodic timer
+ *
+ * Deadlines are absolute: n-th expiration is at arm time + n * msec,
+ * so handler run time does not shift period. Periods missed by stall
+ * are skipped.
+ *
+ * @param timer Timer
+ * @param msec Period
+ *
+ * @return True/False as result of arming timer
+ */
+bool TimerPeriodicSet(Timer *timer, unsigned msec);
+
+/**
+ * @brief Arm one-shot timer after delay
+ *
+ * @param timer Timer
+ * @param msec Delay
+ *
+ * @return True/False as result of arming timer
+ */
+bool TimerOnceSet(Timer *timer, unsigned msec);
+
+/**
+ * @brief Arm one-shot timer at absolute monotonic time
+ *
+ * Deadline in the past expires on next tick.
+ *
+ * @param timer Timer
+ * @param msec Deadline as UtilsMonoMsecGet() time
+ *
+ * @return True/False as result of arming timer
+ */
+bool TimerAtSet(Timer *timer, uint64_t msec);
+
+/**
+ * @brief Call timer handler as soon as possible
+ *
+ * Timer deadline is not changed.
+ *
+ * @param timer Timer
+ *
+ * @return True/False as result of queuing handler call
+ */
+bool TimerTrigger(Timer *timer);
+
+/**
+ * @brief Disarm timer
+ *
+ * Running handler call is not waited.
+ *
+ * @param timer Timer
+ */
+void TimerCancel(Timer *timer);
+
+/**
+ * @brief Attach timer wheel to event loop
+ *
+ * Timers armed before start expire after it.
+ *
+ * @return True/False as result of starting timers
+ */
+bool TimerStart();
+
+#endif /* __TIMER_H__ */
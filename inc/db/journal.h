@@ -0,0 +1,108 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <glib-2.0/glib.h>
+
+#define JOURNAL_DIR                 "journal/"
+#define JOURNAL_SEGMENT_RECORDS     16384
+#define JOURNAL_SEGMENTS_MAX        32
+#define JOURNAL_BLOCK_RECORDS       256
+#define JOURNAL_BLOCKS              (JOURNAL_SEGMENT_RECORDS / JOURNAL_BLOCK_RECORDS)
+#define JOURNAL_NAME_LEN            40
+#define JOURNAL_CHECK_SEC           1
+#define JOURNAL_SYNC_SEC            30
+#define JOURNAL_QUERY_MAX           1000
+#define JOURNAL_CTRLS_ALL           UINT32_MAX
+
+typedef enum {
+    JOURNAL_CTRL_SECURITY,
+    JOURNAL_CTRL_SOCKET,
+    JOURNAL_CTRL_TANK,
+    JOURNAL_CTRL_WATERER,
+    JOURNAL_CTRL_MAX
+} JournalCtrl;
+
+typedef enum {
+    JOURNAL_EVENT_STATUS,
+    JOURNAL_EVENT_DETECTED,
+    JOURNAL_EVENT_ALARM,
+    JOURNAL_EVENT_PUMP,
+    JOURNAL_EVENT_VALVE,
+    JOURNAL_EVENT_MAX
+} JournalEvent;
+
+typedef struct {
+    uint64_t        time;
+    JournalCtrl     ctrl;
+    JournalEvent    event;
+    int             value;
+    char            name[JOURNAL_NAME_LEN];
+} JournalRecord;
+
+/**
+ * @brief Set path for journal segments
+ *
+ * Segments are stored in JOURNAL_DIR folder of path.
+ *
+ * @param path Path to DB files
+ */
+void JournalPathSet(const char *path);
+
+/**
+ * @brief Append event to journal
+ *
+ * Append is lock-free and does not wait for disk. Event is dropped
+ * when journal is not started or next segment is not mapped yet.
+ *
+ * @param ctrl Source controller
+ * @param event Event type
+ * @param name Object name, truncated to JOURNAL_NAME_LEN
+ * @param value Event value
+ */
+void JournalAdd(JournalCtrl ctrl, JournalEvent event, const char *name, int value);
+
+/**
+ * @brief Find journal events by time range
+ *
+ * Records are allocated and must be freed by caller.
+ *
+ * @param from Range start as unix time in msec
+ * @param to Range end as unix time in msec, inclusive
+ * @param ctrls Controllers mask by JournalCtrl bits
+ * @param limit Max records count
+ * @param records Output list of records, newest first
+ *
+ * @return True/False as result of query
+ */
+bool JournalQuery(uint64_t from, uint64_t to, uint32_t ctrls, unsigned limit, GList **records);
+
+/**
+ * @brief Get count of events dropped by journal
+ *
+ * @return Dropped events count
+ */
+uint64_t JournalDroppedGet();
+
+/**
+ * @brief Open journal segments and start maintenance
+ *
+ * Time index is rebuilt from segments kept on disk.
+ *
+ * @return True/False as result of starting journal
+ */
+bool JournalStart();
+
+#endif /* __JOURNAL_H__ */
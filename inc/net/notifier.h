@@ -12,6 +12,26 @@
 #define __NOTIFIER_H__
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#define NOTIFIER_QUEUE_LEN  32
+
+typedef enum {
+    NOTIFIER_TELEGRAM   = 0x1,
+    NOTIFIER_SMS        = 0x2
+} NotifierChannel;
+
+typedef struct {
+    unsigned    depth;
+    unsigned    depth_max;
+    uint64_t    queued;
+    uint64_t    sent;
+    uint64_t    failed;
+    uint64_t    dropped;
+    unsigned    latency_last;
+    unsigned    latency_avg;
+    unsigned    latency_max;
+} NotifierStats;
 
 /**
  * @brief Set telegram bot credentials
@@ -47,4 +67,36 @@ bool NotifierTelegramSend(const char *msg);
  */
 bool NotifierSmsSend(const char *msg);
 
+/**
+ * @brief Queue message for sending by notifier thread
+ *
+ * Never blocks on network. Queue is bounded by NOTIFIER_QUEUE_LEN,
+ * message is dropped when it is full.
+ *
+ * @param channels Mask of NotifierChannel to send message to
+ * @param msg Message
+ *
+ * @return True/False as result of queuing message
+ */
+bool NotifierPost(unsigned channels, const char *msg);
+
+/**
+ * @brief Get notifier queue metrics
+ *
+ * Latency is time in milliseconds from queuing message to end of its
+ * sending to all channels.
+ *
+ * @param stats Notifier metrics
+ */
+void NotifierStatsGet(NotifierStats *stats);
+
+/**
+ * @brief Start notifier sending thread
+ *
+ * Messages queued before start are sent after it.
+ *
+ * @return True/False as result of starting thread
+ */
+bool NotifierStart();
+
 #endif /* __NOTIFIER_H__ */
@@ -16,6 +16,7 @@
 #include <utils/utils.h>
 
 #define TG_BOT_GET_UPDATES_URL  ""
+#define TG_BOT_POLL_SEC         1
 
 typedef struct {
     char        name[SHORT_STR_LEN];
@@ -0,0 +1,97 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <plc/plc.h>
+
+#define CLOCK_RTC_ADDR      0x68
+#define CLOCK_RTC_SYNC_SEC  3600
+#define CLOCK_SUBSCRIBERS   8
+
+typedef void (*ClockHandler)(void *data);
+
+/**
+ * @brief Set wall time source
+ *
+ * Must be called before clock start.
+ *
+ * @param type Time source
+ */
+void ClockTypeSet(PlcTimeType type);
+
+/**
+ * @brief Set DS3231 RTC parameters
+ *
+ * RTC is read once on start, then time is counted by monotonic clock
+ * and synced with RTC every sync period, so time reads never touch
+ * I2C bus.
+ *
+ * @param bus I2C bus number
+ * @param addr RTC slave address
+ * @param sync Sync period in seconds, 0 for CLOCK_RTC_SYNC_SEC
+ */
+void ClockRtcSet(unsigned bus, unsigned addr, unsigned sync);
+
+/**
+ * @brief Get cached local wall time
+ *
+ * Lock free and safe to call from any thread. Until clock is started
+ * time is read from system on every call. Intervals must be measured
+ * by UtilsMonoMsecGet(), wall time may jump.
+ *
+ * @param time Current local time
+ *
+ * @return True/False as result of getting time
+ */
+bool ClockGet(PlcTime *time);
+
+/**
+ * @brief Convert local wall time to seconds
+ *
+ * Local time fields are counted as seconds since 1970-01-01 00:00 of
+ * the same local clock, no time zone is applied.
+ *
+ * @param time Local time
+ *
+ * @return Seconds of local clock
+ */
+int64_t ClockSecondsGet(const PlcTime *time);
+
+/**
+ * @brief Subscribe to wall time steps
+ *
+ * Handler is called on event loop when system realtime clock is set
+ * or time is synced with DS3231. It must not block and must not wait
+ * for clock functions.
+ *
+ * @param handler Time step handler
+ * @param data User data for handler
+ *
+ * @return True/False as result of subscribing
+ */
+bool ClockSubscribe(ClockHandler handler, void *data);
+
+/**
+ * @brief Start wall clock cache refresh
+ *
+ * Cached time is refreshed on event loop at each second boundary and
+ * when system realtime clock is set. When DS3231 can not be read time
+ * source falls back to system time.
+ *
+ * @return True/False as result of starting clock
+ */
+bool ClockStart();
+
+#endif /* __CLOCK_H__ */
@@ -22,6 +22,8 @@
 #include <controllers/tank.h>
 #include <controllers/socket.h>
 
+#define MENU_REDRAW_SEC 5
+
 typedef enum {
     MENU_GPIO_UP,
     MENU_GPIO_MIDDLE,
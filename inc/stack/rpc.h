@@ -43,8 +43,14 @@ typedef struct {
     bool                    detected;
 } RpcSecuritySensor;
 
-bool RpcSecurityStatusSet(unsigned unit, bool status);
-bool RpcSecurityStatusGet(unsigned unit, bool *status);
+typedef struct {
+    char                    name[SHORT_STR_LEN];
+    bool                    status;
+} RpcSecurityZone;
+
+bool RpcSecurityStatusSet(unsigned unit, const char *zone, bool status);
+bool RpcSecurityStatusGet(unsigned unit, const char *zone, bool *status);
+bool RpcSecurityZonesGet(unsigned unit, GList **zones);
 bool RpcSecurityAlarmSet(unsigned unit, bool alarm);
 bool RpcSecurityAlarmGet(unsigned unit, bool *alarm);
 bool RpcSecuritySensorsGet(unsigned unit, GList **sensors);
@@ -105,6 +111,7 @@ typedef struct {
     unsigned    level;
     bool        pump;
     bool        valve;
+    float       volume;
 } RpcTank;
 
 bool RpcTankStatusSet(unsigned unit, const char *name, bool status);
@@ -143,12 +150,23 @@ typedef struct {
     char    name[SHORT_STR_LEN];
     bool    status;
     bool    valve;
+    float   volume;
     GList   *times;
 } RpcWaterer;
 
+typedef struct {
+    char        name[SHORT_STR_LEN];
+    unsigned    delay;
+    unsigned    day;
+    unsigned    hour;
+    unsigned    min;
+    bool        state;
+} RpcWatererAction;
+
 bool RpcWatererStatusSet(unsigned unit, const char *name, bool status);
 bool RpcWatererPumpSet(unsigned unit, const char *name, bool status);
 bool RpcWatererValveSet(unsigned unit, const char *name, bool status);
 bool RpcWaterersGet(unsigned unit, GList **waterers);
+bool RpcWatererUpcomingGet(unsigned unit, unsigned count, GList **actions);
 
 #endif /* __RPC_H__ */
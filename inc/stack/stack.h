@@ -15,6 +15,8 @@
 
 #include <stdbool.h>
 
+#define STACK_CHECK_SEC 3
+
 typedef struct {
     unsigned    id;
     char        name[SHORT_STR_LEN];
@@ -0,0 +1,81 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#ifndef __REGISTRY_H__
+#define __REGISTRY_H__
+
+#include <stdbool.h>
+
+#include <glib-2.0/glib.h>
+
+#define REGISTRY_SIZE_DEFAULT   16
+
+typedef struct {
+    GHashTable  *index;
+    void        **objects;
+    unsigned    count;
+    unsigned    size;
+} Registry;
+
+/**
+ * @brief Add named object to registry
+ *
+ * Name must stay valid while registry exists. If the name is already
+ * registered the first object keeps the name.
+ *
+ * @param reg Registry, zero initialized before first addition
+ * @param name Object name
+ * @param obj Object pointer
+ *
+ * @return Stable object handle
+ */
+unsigned RegistryAdd(Registry *reg, const char *name, void *obj);
+
+/**
+ * @brief Get object by name
+ *
+ * @param reg Registry
+ * @param name Object name
+ *
+ * @return Object pointer or NULL if not found
+ */
+void *RegistryGet(const Registry *reg, const char *name);
+
+/**
+ * @brief Resolve object name to handle
+ *
+ * @param reg Registry
+ * @param name Object name
+ * @param handle Output object handle
+ *
+ * @return True/False as result of resolving
+ */
+bool RegistryHandleGet(const Registry *reg, const char *name, unsigned *handle);
+
+/**
+ * @brief Get object by handle
+ *
+ * @param reg Registry
+ * @param handle Object handle
+ *
+ * @return Object pointer or NULL if handle is invalid
+ */
+void *RegistryAt(const Registry *reg, unsigned handle);
+
+/**
+ * @brief Get registered objects count
+ *
+ * @param reg Registry
+ *
+ * @return Objects count
+ */
+unsigned RegistryCount(const Registry *reg);
+
+#endif /* __REGISTRY_H__ */
@@ -12,6 +12,8 @@
 #define __UTILS_H__
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 
 #include <glib-2.0/glib.h>
 
@@ -52,10 +54,28 @@ void UtilsSecSleep(unsigned sec);
 void UtilsMsecSleep(unsigned msec);
 
 /**
- * @brief Get current Linux time
- * 
- * @return Linux time
+ * @brief Get monotonic time
+ *
+ * @return Nanoseconds since unspecified starting point
+ */
+uint64_t UtilsMonoNsecGet();
+
+/**
+ * @brief Get monotonic time
+ *
+ * @return Milliseconds since unspecified starting point
+ */
+uint64_t UtilsMonoMsecGet();
+
+/**
+ * @brief Get current Linux local time
+ *
+ * Reentrant, fields are as returned by localtime_r().
+ *
+ * @param tm Local time
+ *
+ * @return True/False as result of getting time
  */
-struct tm *UtilsLinuxTimeGet();
+bool UtilsLinuxTimeGet(struct tm *tm);
 
 #endif /* __UTILS_H__ */
@@ -9,6 +9,7 @@
 /*********************************************************************/
 
 #include <cam/camera.h>
+#include <utils/registry.h>
 
 #include <stdio.h>
 
@@ -19,8 +20,9 @@
 /*********************************************************************/
 
 static struct _Cameras {
-    GList   *cameras;
-    char    path[STR_LEN];
+    GList       *cameras;
+    Registry    index;
+    char        path[STR_LEN];
 } Cameras = {
     .cameras = NULL,
 };
@@ -43,13 +45,7 @@ char *CameraPathGet()
 
 Camera *CameraGet(const char *name)
 {
-    for (GList *s = Cameras.cameras; s != NULL; s = s->next) {
-        Camera *cam = (Camera *)s->data;
-        if (!strcmp(cam->name, name)) {
-            return cam;
-        }
-    }
-    return NULL;
+    return (Camera *)RegistryGet(&Cameras.index, name);
 }
 
 bool CameraPhotoSave(Camera *cam, const char *filename)
@@ -93,5 +89,6 @@ GList **CamerasGet()
 
 void CameraAdd(const Camera *cam)
 {
+    RegistryAdd(&Cameras.index, cam->name, (void *)cam);
     Cameras.cameras = g_list_append(Cameras.cameras, (void *)cam);
 }
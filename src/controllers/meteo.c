@@ -8,12 +8,67 @@
 /*                                                                   */
 /*********************************************************************/
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <threads.h>
+#include <sys/stat.h>
 
 #include <controllers/meteo.h>
 #include <utils/log.h>
 #include <net/notifier.h>
 #include <core/onewire.h>
+#include <core/timer.h>
+#include <plc/clock.h>
+#include <utils/registry.h>
+
+#define METEO_FILE_EXT      ".hist"
+#define METEO_FILE_TMP_EXT  ".tmp"
+#define METEO_FILE_MAGIC    0x5248544DU
+#define METEO_FILE_VERSION  1
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+typedef struct {
+    uint32_t    time;
+    uint32_t    count;
+    float       min;
+    float       max;
+    double      sum;
+} MeteoRollup;
+
+typedef struct {
+    MeteoRollup *buckets;
+    unsigned    size;
+    unsigned    len;
+    unsigned    head;
+    unsigned    count;
+} MeteoRing;
+
+struct _MeteoHistory {
+    MeteoRing   rings[METEO_LEVEL_MAX];
+    bool        dirty;
+    MeteoRollup raw[METEO_RAW_SIZE];
+    MeteoRollup minutes[METEO_MINUTES_SIZE];
+    MeteoRollup hours[METEO_HOURS_SIZE];
+    MeteoRollup days[METEO_DAYS_SIZE];
+};
+
+/* Raw samples are not stored, only rollup rings follow header */
+typedef struct {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    sizes[METEO_LEVEL_MAX];
+    uint32_t    heads[METEO_LEVEL_MAX];
+    uint32_t    counts[METEO_LEVEL_MAX];
+} MeteoFileHeader;
 
 /*********************************************************************/
 /*                                                                   */
@@ -22,58 +77,340 @@
 /*********************************************************************/
 
 static struct _Meteo {
-    GList   *sensors;
+    GList       *sensors;
+    Registry    index;
+    uint64_t    sweep;
+    Timer       *timer;
+    Timer       *flush_timer;
+    char        path[STR_LEN];
+    mtx_t       hist_mtx;
 } Meteo = {
-    .sensors = NULL
+    .sensors = NULL,
+    .sweep = 0,
+    .timer = NULL,
+    .flush_timer = NULL,
+    .path = {0}
 };
 
+static once_flag meteo_once = ONCE_FLAG_INIT;
+
 /*********************************************************************/
 /*                                                                   */
 /*                         PRIVATE FUNCTIONS                         */
 /*                                                                   */
 /*********************************************************************/
 
-static int SensorsThread(void *data)
+static void MeteoInit()
+{
+    if (mtx_init(&Meteo.hist_mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "METEO", "Failed to init history mutex");
+    }
+}
+
+static void RingInit(MeteoRing *ring, MeteoRollup *buckets, unsigned size, unsigned len)
 {
-    bool    ret = false;
-    float   temp = 0;
+    ring->buckets = buckets;
+    ring->size = size;
+    ring->len = len;
+    ring->head = 0;
+    ring->count = 0;
+}
+
+static MeteoHistory *HistoryNew()
+{
+    MeteoHistory *history = (MeteoHistory *)calloc(1, sizeof(MeteoHistory));
+    if (history == NULL) {
+        return NULL;
+    }
+
+    RingInit(&history->rings[METEO_LEVEL_RAW], history->raw, METEO_RAW_SIZE, 0);
+    RingInit(&history->rings[METEO_LEVEL_MINUTE], history->minutes, METEO_MINUTES_SIZE, 60);
+    RingInit(&history->rings[METEO_LEVEL_HOUR], history->hours, METEO_HOURS_SIZE, 60 * 60);
+    RingInit(&history->rings[METEO_LEVEL_DAY], history->days, METEO_DAYS_SIZE, 24 * 60 * 60);
+
+    return history;
+}
+
+static void RingAdd(MeteoRing *ring, int64_t time, float value)
+{
+    /* Clock time is local, so buckets start at local minutes, hours and days */
+    uint32_t    start = (ring->len == 0) ? (uint32_t)time : (uint32_t)(time / ring->len * ring->len);
+    MeteoRollup *b = &ring->buckets[ring->head];
+
+    /* Clock stepped back, sample is counted in current bucket */
+    if (ring->count == 0 || ring->len == 0 || start > b->time) {
+        if (ring->count != 0) {
+            ring->head = (ring->head + 1) % ring->size;
+        }
+        if (ring->count < ring->size) {
+            ring->count++;
+        }
+
+        b = &ring->buckets[ring->head];
+        b->time = start;
+        b->count = 0;
+        b->min = value;
+        b->max = value;
+        b->sum = 0;
+    }
+
+    if (value < b->min) {
+        b->min = value;
+    }
+    if (value > b->max) {
+        b->max = value;
+    }
+    b->sum += value;
+    b->count++;
+}
+
+static void HistoryAdd(MeteoSensor *sensor, float value)
+{
+    PlcTime now;
+
+    if (sensor->history == NULL || !ClockGet(&now)) {
+        return;
+    }
+
+    int64_t sec = ClockSecondsGet(&now);
+
+    mtx_lock(&Meteo.hist_mtx);
+
+    for (unsigned level = 0; level < METEO_LEVEL_MAX; level++) {
+        RingAdd(&sensor->history->rings[level], sec, value);
+    }
+    sensor->history->dirty = true;
+
+    mtx_unlock(&Meteo.hist_mtx);
+}
+
+static void HistoryPathGet(const MeteoSensor *sensor, const char *ext, char *path)
+{
+    snprintf(path, EXT_STR_LEN, "%s%s%s%s", Meteo.path, METEO_DIR, sensor->name, ext);
+}
+
+static bool HistoryWrite(int fd, const MeteoHistory *history)
+{
+    MeteoFileHeader header;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = METEO_FILE_MAGIC;
+    header.version = METEO_FILE_VERSION;
+
+    for (unsigned level = METEO_LEVEL_MINUTE; level < METEO_LEVEL_MAX; level++) {
+        header.sizes[level] = history->rings[level].size;
+        header.heads[level] = history->rings[level].head;
+        header.counts[level] = history->rings[level].count;
+    }
+
+    /* Snapshot ring pointers refer to sensor history, arrays are written */
+    return write(fd, &header, sizeof(header)) == sizeof(header) &&
+        write(fd, history->minutes, sizeof(history->minutes)) == sizeof(history->minutes) &&
+        write(fd, history->hours, sizeof(history->hours)) == sizeof(history->hours) &&
+        write(fd, history->days, sizeof(history->days)) == sizeof(history->days);
+}
+
+static bool HistorySave(MeteoSensor *sensor, MeteoHistory *snapshot)
+{
+    char path[EXT_STR_LEN];
+    char tmp_path[EXT_STR_LEN];
+
+    mtx_lock(&Meteo.hist_mtx);
+
+    if (!sensor->history->dirty) {
+        mtx_unlock(&Meteo.hist_mtx);
+        return true;
+    }
+    sensor->history->dirty = false;
+
+    /* Rings are written from snapshot, sensor reads are not held by disk */
+    memcpy(snapshot, sensor->history, sizeof(MeteoHistory));
+
+    mtx_unlock(&Meteo.hist_mtx);
+
+    HistoryPathGet(sensor, METEO_FILE_EXT, path);
+    HistoryPathGet(sensor, METEO_FILE_TMP_EXT, tmp_path);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    /* Rename of synced file keeps previous history on power loss */
+    if (!HistoryWrite(fd, snapshot) || fsync(fd) < 0) {
+        close(fd);
+        unlink(tmp_path);
+        return false;
+    }
+    close(fd);
+
+    return rename(tmp_path, path) == 0;
+}
+
+static bool HistoryLoad(MeteoSensor *sensor)
+{
+    MeteoFileHeader header;
+    char            path[EXT_STR_LEN];
+    MeteoHistory    *history = sensor->history;
+
+    HistoryPathGet(sensor, METEO_FILE_EXT, path);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+
+    if (read(fd, &header, sizeof(header)) != sizeof(header) ||
+        header.magic != METEO_FILE_MAGIC || header.version != METEO_FILE_VERSION) {
+        close(fd);
+        return false;
+    }
+
+    /* Ring sizes are compile time, file of other build is dropped */
+    for (unsigned level = METEO_LEVEL_MINUTE; level < METEO_LEVEL_MAX; level++) {
+        if (header.sizes[level] != history->rings[level].size ||
+            header.heads[level] >= header.sizes[level] || header.counts[level] > header.sizes[level]) {
+            close(fd);
+            return false;
+        }
+    }
+
+    if (read(fd, history->minutes, sizeof(history->minutes)) != sizeof(history->minutes) ||
+        read(fd, history->hours, sizeof(history->hours)) != sizeof(history->hours) ||
+        read(fd, history->days, sizeof(history->days)) != sizeof(history->days)) {
+        close(fd);
+        memset(history->minutes, 0, sizeof(history->minutes));
+        memset(history->hours, 0, sizeof(history->hours));
+        memset(history->days, 0, sizeof(history->days));
+        return false;
+    }
+    close(fd);
+
+    for (unsigned level = METEO_LEVEL_MINUTE; level < METEO_LEVEL_MAX; level++) {
+        history->rings[level].head = header.heads[level];
+        history->rings[level].count = header.counts[level];
+    }
+    return true;
+}
+
+static void FlushTimerHandler(void *data)
+{
+    MeteoHistory *snapshot = (MeteoHistory *)malloc(sizeof(MeteoHistory));
+
+    if (snapshot == NULL) {
+        Log(LOG_TYPE_ERROR, "METEO", "Failed to alloc history snapshot");
+        return;
+    }
+
+    for (GList *s = Meteo.sensors; s != NULL; s = s->next) {
+        MeteoSensor *sensor = (MeteoSensor *)s->data;
+
+        if (sensor->history != NULL && !HistorySave(sensor, snapshot)) {
+            LogF(LOG_TYPE_ERROR, "METEO", "Failed to save history of sensor \"%s\"", sensor->name);
+
+            mtx_lock(&Meteo.hist_mtx);
+            sensor->history->dirty = true;
+            mtx_unlock(&Meteo.hist_mtx);
+        }
+    }
+
+    free(snapshot);
+}
+
+static bool SensorRead(MeteoSensor *sensor)
+{
+    float temp = 0;
+
+    switch (sensor->type) {
+        case METEO_SENSOR_DS18B20:
+            if (!OneWireTempRead(sensor->ds18b20.id, &temp)) {
+                return false;
+            }
+            sensor->ds18b20.temp = temp;
+            HistoryAdd(sensor, temp);
+            return true;
+    }
+    return false;
+}
+
+static void SensorUpdate(MeteoSensor *sensor, uint64_t now)
+{
+    if (SensorRead(sensor)) {
+        sensor->fails = 0;
+        sensor->retry = 0;
+
+        if (sensor->error) {
+            sensor->error = false;
+            LogF(LOG_TYPE_ERROR, "METEO", "Successfully read temp sensor \"%s\"", sensor->name);
+        }
+        return;
+    }
+
+    /* Failed sensor is retried alone without holding up the sweep */
+    sensor->fails++;
+
+    if (sensor->fails < METEO_SENSOR_TRIES) {
+        sensor->retry = now + METEO_RETRY_SEC * 1000;
+        return;
+    }
+
+    sensor->retry = 0;
+
+    if (!sensor->error) {
+        sensor->error = true;
+        sensor->ds18b20.temp = METEO_BAD_VAL;
+        LogF(LOG_TYPE_ERROR, "METEO", "Failed to read temp sensor \"%s\"", sensor->name);
+    }
+}
+
+static uint64_t WakeGet(uint64_t sweep)
+{
+    uint64_t wake = sweep;
+
+    for (GList *s = Meteo.sensors; s != NULL; s = s->next) {
+        MeteoSensor *sensor = (MeteoSensor *)s->data;
+
+        if (sensor->retry != 0 && sensor->retry < wake) {
+            wake = sensor->retry;
+        }
+    }
+    return wake;
+}
+
+static void SensorsTimerHandler(void *data)
+{
+    uint64_t    now = UtilsMonoMsecGet();
+    bool        full = (now >= Meteo.sweep);
+    bool        due = full;
+
+    for (GList *s = Meteo.sensors; s != NULL && !due; s = s->next) {
+        MeteoSensor *sensor = (MeteoSensor *)s->data;
+        due = (sensor->retry != 0 && sensor->retry <= now);
+    }
+
+    if (due) {
+        /* One conversion for all sensors, w/o bulk read each read converts */
+        OneWireTempConvert();
+        now = UtilsMonoMsecGet();
 
-    for (;;) {
         for (GList *s = Meteo.sensors; s != NULL; s = s->next) {
             MeteoSensor *sensor = (MeteoSensor *)s->data;
 
-            for (unsigned i = 0; i < METEO_SENSOR_TRIES; i++) {
-                switch (sensor->type) {
-                    case METEO_SENSOR_DS18B20:
-                        ret = OneWireTempRead(sensor->ds18b20.id, &temp);
-                        if (ret) {
-                            sensor->ds18b20.temp = temp;
-                        }
-                        break;
-                }
-
-                if (ret) {
-                    break;
-                } else {
-                    UtilsSecSleep(2);
-                }
+            if (full || (sensor->retry != 0 && sensor->retry <= now)) {
+                SensorUpdate(sensor, now);
             }
+        }
+    }
 
-            if (!ret) {
-                if (!sensor->error) {
-                    sensor->error = true;
-                    sensor->ds18b20.temp = METEO_BAD_VAL;
-                    LogF(LOG_TYPE_ERROR, "METEO", "Failed to read temp sensor \"%s\"", sensor->name);
-                }
-            } else {
-                if (sensor->error) {
-                    sensor->error = false;
-                    LogF(LOG_TYPE_ERROR, "METEO", "Successfully read temp sensor \"%s\"", sensor->name);
-                }
-            }
+    /* Sweeps are aligned to previous deadline, not to conversion end */
+    if (full) {
+        Meteo.sweep = (Meteo.sweep == 0) ? now : Meteo.sweep;
+        while (Meteo.sweep <= now) {
+            Meteo.sweep += METEO_SWEEP_SEC * 1000;
         }
-        UtilsSecSleep(10);
     }
+
+    TimerAtSet(Meteo.timer, WakeGet(Meteo.sweep));
 }
 
 /*********************************************************************/
@@ -89,21 +426,93 @@ MeteoSensor *MeteoSensorNew(const char *name, MeteoSensorType type)
     strncpy(sensor->name, name, SHORT_STR_LEN);
     sensor->type = type;
     sensor->error = false;
+    sensor->fails = 0;
+    sensor->retry = 0;
     sensor->ds18b20.temp = 0;
+    sensor->history = HistoryNew();
+
+    if (sensor->history == NULL) {
+        LogF(LOG_TYPE_ERROR, "METEO", "Failed to alloc history of sensor \"%s\"", name);
+    }
 
     return sensor;
 }
 
+void MeteoPathSet(const char *path)
+{
+    strncpy(Meteo.path, path, STR_LEN - 1);
+}
+
+bool MeteoHistoryGet(MeteoSensor *sensor, MeteoLevel level, int64_t from, int64_t to, GList **points)
+{
+    if (sensor == NULL || sensor->history == NULL || level >= METEO_LEVEL_MAX || points == NULL) {
+        return false;
+    }
+
+    call_once(&meteo_once, MeteoInit);
+
+    mtx_lock(&Meteo.hist_mtx);
+
+    const MeteoRing *ring = &sensor->history->rings[level];
+
+    /* Walked from newest, prepend keeps oldest first */
+    for (unsigned i = 0; i < ring->count; i++) {
+        const MeteoRollup *b = &ring->buckets[(ring->head + ring->size - i) % ring->size];
+
+        if (b->time > to) {
+            continue;
+        }
+        if (b->time < from) {
+            break;
+        }
+
+        MeteoPoint *point = (MeteoPoint *)malloc(sizeof(MeteoPoint));
+        if (point == NULL) {
+            break;
+        }
+
+        point->time = b->time;
+        point->min = b->min;
+        point->max = b->max;
+        point->avg = (b->count != 0) ? (float)(b->sum / b->count) : 0;
+
+        *points = g_list_prepend(*points, (void *)point);
+    }
+
+    mtx_unlock(&Meteo.hist_mtx);
+    return true;
+}
+
 bool MeteoControllerStart()
 {
-    thrd_t  sens_th;
+    char path[EXT_STR_LEN];
+
+    call_once(&meteo_once, MeteoInit);
 
     Log(LOG_TYPE_INFO, "METEO", "Starting Meteo controller");
 
-    if (thrd_create(&sens_th, &SensorsThread, NULL) != thrd_success) {
+    snprintf(path, EXT_STR_LEN, "%s%s", Meteo.path, METEO_DIR);
+
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+        LogF(LOG_TYPE_ERROR, "METEO", "Failed to create history folder \"%s\"", path);
         return false;
     }
-    if (thrd_detach(sens_th) != thrd_success) {
+
+    for (GList *s = Meteo.sensors; s != NULL; s = s->next) {
+        MeteoSensor *sensor = (MeteoSensor *)s->data;
+
+        if (sensor->history != NULL && !HistoryLoad(sensor)) {
+            LogF(LOG_TYPE_ERROR, "METEO", "Failed to load history of sensor \"%s\", start empty", sensor->name);
+        }
+    }
+
+    Meteo.timer = TimerBlockingNew(SensorsTimerHandler, NULL);
+    if (!TimerTrigger(Meteo.timer)) {
+        return false;
+    }
+
+    Meteo.flush_timer = TimerBlockingNew(FlushTimerHandler, NULL);
+    if (!TimerPeriodicSet(Meteo.flush_timer, METEO_FLUSH_SEC * 1000)) {
         return false;
     }
 
@@ -112,13 +521,7 @@ bool MeteoControllerStart()
 
 MeteoSensor *MeteoSensorGet(const char *name)
 {
-    for (GList *v = Meteo.sensors; v != NULL; v = v->next) {
-        MeteoSensor *sensor = (MeteoSensor *)v->data;
-        if (!strcmp(sensor->name, name)) {
-            return sensor;
-        }
-    }
-    return NULL;
+    return (MeteoSensor *)RegistryGet(&Meteo.index, name);
 }
 
 GList **MeteoSensorsGet()
@@ -128,5 +531,6 @@ GList **MeteoSensorsGet()
 
 void MeteoSensorAdd(MeteoSensor *sensor)
 {
+    RegistryAdd(&Meteo.index, sensor->name, sensor);
     Meteo.sensors = g_list_append(Meteo.sensors, (void *)sensor);
 }
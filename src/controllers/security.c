@@ -13,13 +13,22 @@
 #include <controllers/security.h>
 #include <utils/log.h>
 #include <core/onewire.h>
+#include <core/scan.h>
+#include <core/indicator.h>
+#include <core/timer.h>
+#include <utils/registry.h>
 #include <net/notifier.h>
 #include <db/database.h>
+#include <db/journal.h>
 #include <controllers/socket.h>
 #include <stack/stack.h>
 #include <stack/rpc.h>
 #include <scenario/scenario.h>
 #include <plc/plc.h>
+#include <core/loop.h>
+
+#define SECURITY_WORD_BITS      64
+#define SECURITY_WORDS(count)   (((count) + SECURITY_WORD_BITS - 1) / SECURITY_WORD_BITS)
 
 /*********************************************************************/
 /*                                                                   */
@@ -29,33 +38,68 @@
 
 static struct _Security {
     GList           *sensors;
+    Registry        index;
+    GList           *zones;
+    Registry        zones_index;
     GList           *keys;
     GpioPin         *gpio[SECURITY_GPIO_MAX];
     mtx_t           sts_mtx;
-    bool            status;
+    mtx_t           db_mtx;
+    uint32_t        armed_zones;
+    uint32_t        alarm_zones;
+    unsigned        words;
+    uint64_t        *armed;
+    uint64_t        *alarms;
+    uint64_t        *detected;
+    uint64_t        *reported;
+    uint64_t        *mask;
     bool            alarm;
     bool            last_alarm;
     bool            sound[SECURITY_SOUND_MAX];
     bool            enabled;
+    Timer           *timer;
 } Security = {
     .sensors = NULL,
+    .zones = NULL,
     .keys = NULL,
-    .status = false,
+    .armed_zones = 0,
+    .alarm_zones = 0,
+    .words = 0,
+    .armed = NULL,
+    .alarms = NULL,
+    .detected = NULL,
+    .reported = NULL,
+    .mask = NULL,
     .alarm = false,
     .last_alarm = false,
-    .enabled = false
+    .enabled = false,
+    .timer = NULL
 };
 
+static once_flag security_once = ONCE_FLAG_INIT;
+
 /*********************************************************************/
 /*                                                                   */
 /*                         PRIVATE FUNCTIONS                         */
 /*                                                                   */
 /*********************************************************************/
 
-static bool StatusSave(SecurityStatusType type, bool status)
+static void SecurityInit()
+{
+    if (mtx_init(&Security.sts_mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "SECURITY", "Failed to init status mutex");
+    }
+    if (mtx_init(&Security.db_mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "SECURITY", "Failed to init database mutex");
+    }
+}
+
+static bool StatusSave(uint32_t armed, bool alarm)
 {
     Database    db;
     char        sql[STR_LEN];
+    char        where[STR_LEN];
+    bool        ret = true;
 
     if (!DatabaseOpen(&db, SECURITY_DB_FILE)) {
         DatabaseClose(&db);
@@ -63,187 +107,322 @@ static bool StatusSave(SecurityStatusType type, bool status)
         return false;
     }
 
-    if (type == SECURITY_SAVE_TYPE_STATUS) {
-        snprintf(sql, STR_LEN, "status=%d", (int)status);
-    } else {
-        snprintf(sql, STR_LEN, "alarm=%d", (int)status);
+    for (GList *z = Security.zones; z != NULL; z = z->next) {
+        SecurityZone *zone = (SecurityZone *)z->data;
+
+        snprintf(sql, STR_LEN, "status=%d", (int)((armed >> zone->id) & 1));
+        snprintf(where, STR_LEN, "name=\"%s%s\"", SECURITY_DB_ZONE_PREFIX, zone->name);
+
+        if (!DatabaseUpdate(&db, "security", sql, where)) {
+            LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to update Security zone \"%s\" in database", zone->name);
+            ret = false;
+        }
     }
 
+    /* Controller row keeps summary status of all zones */
+    snprintf(sql, STR_LEN, "status=%d,alarm=%d", (int)(armed != 0), (int)alarm);
+
     if (!DatabaseUpdate(&db, "security", sql, "name=\"controller\"")) {
-        DatabaseClose(&db);
         Log(LOG_TYPE_ERROR, "SECURITY", "Failed to update Security database");
-        return false;
+        ret = false;
     }
 
     DatabaseClose(&db);
+    return ret;
+}
+
+static void StatusSaveWork(void *data)
+{
+    /* Snapshot is taken by worker, so latest state wins over queued saves */
+    mtx_lock(&Security.sts_mtx);
+    uint32_t armed = Security.armed_zones;
+    bool alarm = Security.alarm;
+    mtx_unlock(&Security.sts_mtx);
+
+    mtx_lock(&Security.db_mtx);
+    StatusSave(armed, alarm);
+    mtx_unlock(&Security.db_mtx);
+}
+
+static bool StatusSaveQueue()
+{
+    if (!LoopWorkAdd(StatusSaveWork, NULL)) {
+        Log(LOG_TYPE_ERROR, "SECURITY", "Failed to queue Security status save");
+        return false;
+    }
     return true;
 }
 
-static int SensorsThread(void *data)
+static bool MaskResize(uint64_t **mask, unsigned words)
 {
-    char        msg[STR_LEN];
-    unsigned    timer = 0;
-    bool        state = false;
+    uint64_t *buf = (uint64_t *)realloc(*mask, words * sizeof(uint64_t));
+    if (buf == NULL) {
+        return false;
+    }
 
-    for (;;) {
-        timer++;
+    memset(buf + Security.words, 0, (words - Security.words) * sizeof(uint64_t));
+    *mask = buf;
+    return true;
+}
 
-        if (timer > SECURITY_SENSOR_TIME_MAX_SEC) {
-            timer = 0;
-        }
+static bool MasksGrow(unsigned count)
+{
+    unsigned words = SECURITY_WORDS(count);
 
-        for (GList *s = Security.sensors; s != NULL; s = s->next) {
-            SecuritySensor *sensor = (SecuritySensor *)s->data;
+    if (words <= Security.words) {
+        return true;
+    }
 
-            if (sensor->detected) {
-                continue;
-            }
+    if (!MaskResize(&Security.armed, words) || !MaskResize(&Security.alarms, words) ||
+        !MaskResize(&Security.detected, words) || !MaskResize(&Security.reported, words) ||
+        !MaskResize(&Security.mask, words)) {
+        return false;
+    }
 
-            switch (sensor->type) {
-                case SECURITY_SENSOR_MICRO_WAVE:
-                    if (!GpioPinRead(sensor->gpio, &state)) {
-                        LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to read GPIO \"%s\"", sensor->gpio->name);
-                        break;
-                    }
+    for (GList *z = Security.zones; z != NULL; z = z->next) {
+        SecurityZone *zone = (SecurityZone *)z->data;
 
-                    if (!state) {
-                        sensor->counter++;
-                    }
-                    break;
+        if (!MaskResize(&zone->sensors, words)) {
+            return false;
+        }
+    }
 
-                case SECURITY_SENSOR_PIR:
-                    if (!GpioPinRead(sensor->gpio, &state)) {
-                        LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to read GPIO \"%s\"", sensor->gpio->name);
-                        break;
-                    }
+    Security.words = words;
+    return true;
+}
 
-                    if (state) {
-                        sensor->counter++;
-                    }
-                    break;
+static void MaskBitSet(uint64_t *mask, unsigned id)
+{
+    mask[id / SECURITY_WORD_BITS] |= (uint64_t)1 << (id % SECURITY_WORD_BITS);
+}
 
-                case SECURITY_SENSOR_REED:
-                    if (!GpioPinRead(sensor->gpio, &state)) {
-                        LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to read GPIO \"%s\"", sensor->gpio->name);
-                        break;
-                    }
+static uint32_t ZonesMaskGet()
+{
+    unsigned count = RegistryCount(&Security.zones_index);
 
-                    if (!state) {
-                         sensor->detected = true;
-                    }
-                    break;
-            }
+    if (count >= SECURITY_ZONES_MAX) {
+        return SECURITY_ZONES_ALL;
+    }
+    return (1U << count) - 1;
+}
 
-            if (timer == SECURITY_SENSOR_TIME_MAX_SEC) {
-                if (sensor->counter >= SECURITY_DETECTED_TIME_MAX_SEC) {
-                    sensor->counter = 0;
-                    sensor->detected = true;
-                } else {
-                    sensor->counter = 0;
-                }
-            }
+static void SensorsReset(const uint64_t *sensors)
+{
+    for (unsigned w = 0; w < Security.words; w++) {
+        for (uint64_t bits = sensors[w]; bits != 0; bits &= bits - 1) {
+            SecuritySensor *sensor = (SecuritySensor *)RegistryAt(&Security.index,
+                w * SECURITY_WORD_BITS + __builtin_ctzll(bits));
 
-            mtx_lock(&Security.sts_mtx);
-            if (sensor->detected && Security.status) {
-                LogF(LOG_TYPE_INFO, "SECURITY", "Security sensor \"%s\" detected!", sensor->name);
+            sensor->detected = false;
+            sensor->history = 0;
+        }
 
-                if (sensor->alarm && !Security.alarm) {
-                    SecurityAlarmSet(true, true);
-                }
+        Security.detected[w] &= ~sensors[w];
+        Security.reported[w] &= ~sensors[w];
+    }
+}
 
-                StackUnit *unit = StackUnitGet(RPC_DEFAULT_UNIT);
-                snprintf(msg, STR_LEN, "ОХРАНА:%s+Обнаружено+проникновение+%s", unit->name, sensor->name);
+static void ArmedUpdate()
+{
+    memset(Security.armed, 0, Security.words * sizeof(uint64_t));
 
-                if (sensor->sms) {
-                    if (!NotifierSmsSend(msg)) {
-                        Log(LOG_TYPE_ERROR, "SECURITY", "Failed to send sms message");
-                    } else {
-                        Log(LOG_TYPE_INFO, "SECURITY", "Alarm sms was sended to phone");
-                    }
-                }
+    for (uint32_t bits = Security.armed_zones; bits != 0; bits &= bits - 1) {
+        SecurityZone *zone = (SecurityZone *)RegistryAt(&Security.zones_index, __builtin_ctz(bits));
 
-                if (sensor->telegram) {
-                    if (!NotifierTelegramSend(msg)) {
-                        Log(LOG_TYPE_ERROR, "SECURITY", "Failed to send telegram message");
-                    } else {
-                        Log(LOG_TYPE_INFO, "SECURITY", "Alarm message was sended to telegram");
-                    }
-                }
-            }
-            mtx_unlock(&Security.sts_mtx);
+        for (unsigned w = 0; w < Security.words; w++) {
+            Security.armed[w] |= zone->sensors[w];
         }
+    }
+}
 
-        UtilsSecSleep(1);
+static bool MicroWaveActive(SecuritySensor *sensor, bool state)
+{
+    ScanCounter cnt;
+    bool        active = !state;
+
+    /* Short motion pulses between checks are caught by counter input */
+    if (sensor->gpio->counter && ScanCounterGet(sensor->gpio, &cnt) && cnt.pulses != sensor->pulses) {
+        sensor->pulses = cnt.pulses;
+        active = true;
     }
+    return active;
+}
 
-    return 0;
+static uint64_t WindowMask(unsigned window)
+{
+    if (window >= SECURITY_DETECT_WINDOW_MAX) {
+        return UINT64_MAX;
+    }
+    return (1ULL << window) - 1;
 }
 
-static int KeysThread(void *data)
+static void AlarmSet(bool status)
 {
-    GList   *cur_keys = NULL;
-    bool    ow_error = false;
+    if (status != Security.alarm) {
+        JournalAdd(JOURNAL_CTRL_SECURITY, JOURNAL_EVENT_ALARM, "", status);
+    }
 
-    for (;;) {
-        if (!OneWireKeysRead(&cur_keys)) {
-            if (!ow_error) {
-                ow_error = true;
-                Log(LOG_TYPE_ERROR, "SECURITY", "Failed to read iButton codes");
-            }
+    Security.alarm = status;
 
-            g_list_free(cur_keys);
-            cur_keys = NULL;
+    if (!status) {
+        Security.alarm_zones = 0;
+    }
 
-            UtilsSecSleep(1);
-            continue;
-        } else {
-            if (ow_error) {
-                ow_error = false;
-                Log(LOG_TYPE_INFO, "SECURITY", "Successfully readed iButton codes");
-            }
+    if (status) {
+        PlcAlarmSet(PLC_ALARM_SECURITY, true);
+        if (Security.sound[SECURITY_SOUND_ALARM]) {
+            PlcBuzzerRun(PLC_BUZZER_LOOP, true);
         }
+        GpioPinWrite(Security.gpio[SECURITY_GPIO_ALARM_RELAY], true);
+        LogF(LOG_TYPE_INFO, "SECURITY", "Security controller alarm enabled");
+    } else {
+        PlcAlarmSet(PLC_ALARM_SECURITY, false);
+        if (Security.sound[SECURITY_SOUND_ALARM]) {
+            PlcBuzzerRun(PLC_BUZZER_LOOP, false);
+        }
+        GpioPinWrite(Security.gpio[SECURITY_GPIO_ALARM_RELAY], false);
+        LogF(LOG_TYPE_INFO, "SECURITY", "Security controller alarm disabled");
+    }
+}
+
+static void SensorsTimerHandler(void *data)
+{
+    char        msg[STR_LEN];
+    bool        state = false;
+    bool        save = false;
+
+    mtx_lock(&Security.sts_mtx);
 
-        if (cur_keys == NULL) {
-            UtilsSecSleep(1);
+    for (GList *s = Security.sensors; s != NULL; s = s->next) {
+        SecuritySensor *sensor = (SecuritySensor *)s->data;
+        bool active = false;
+
+        if (sensor->detected) {
             continue;
         }
 
-        for (GList *k = cur_keys; k != NULL; k = k->next) {
-            OneWireData *data = (OneWireData *)k->data;
-
-            if (SecurityKeyCheck(data->value)) {
-                if (!SecurityStatusSet(!SecurityStatusGet(), true)) {
-                    LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to switch security status by iButton");
+        switch (sensor->type) {
+            case SECURITY_SENSOR_MICRO_WAVE:
+                if (!ScanInputGet(sensor->gpio, &state)) {
+                    LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to read GPIO \"%s\"", sensor->gpio->name);
+                    break;
                 }
 
-                if (SecurityStatusGet()) {
-                    if (!ScenarioStart(SCENARIO_OUT_HOME)) {
-                        Log(LOG_TYPE_ERROR, "SECURITY", "Failed to start scenario OUT_HOME");
-                    }
-                } else {
-                    if (!ScenarioStart(SCENARIO_IN_HOME)) {
-                        Log(LOG_TYPE_ERROR, "SECURITY", "Failed to start scenario IN_HOME");
-                    }
+                active = MicroWaveActive(sensor, state);
+                break;
+
+            case SECURITY_SENSOR_PIR:
+                if (!ScanInputGet(sensor->gpio, &state)) {
+                    LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to read GPIO \"%s\"", sensor->gpio->name);
+                    break;
                 }
 
-                LogF(LOG_TYPE_INFO, "SECURITY", "Detected valid key: \"%s\"", data->value);
-                UtilsSecSleep(5);
+                active = state;
+                break;
+
+            case SECURITY_SENSOR_REED:
+                if (!ScanInputGet(sensor->gpio, &state)) {
+                    LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to read GPIO \"%s\"", sensor->gpio->name);
+                    break;
+                }
 
+                if (!state) {
+                     sensor->detected = true;
+                }
                 break;
-            } else {
-                LogF(LOG_TYPE_ERROR, "SECURITY", "Invalid security key: \"%s\"", data->value);
+        }
+
+        if (sensor->type != SECURITY_SENSOR_REED) {
+            sensor->history = ((sensor->history << 1) | active) & WindowMask(sensor->window);
+
+            /* Window slides every check, so burst is never split by bucket bounds */
+            if ((unsigned)__builtin_popcountll(sensor->history) >= sensor->samples) {
+                sensor->history = 0;
+                sensor->detected = true;
             }
+        }
 
-            free(data);
+        if (sensor->detected) {
+            MaskBitSet(Security.detected, sensor->id);
         }
+    }
 
-         g_list_free(cur_keys);
-        cur_keys = NULL;
+    /* Detections of sensors out of armed zones are kept until zone is armed */
+    uint64_t *fresh = Security.mask;
+    uint32_t alarm_zones = 0;
 
-        UtilsSecSleep(1);
+    for (unsigned w = 0; w < Security.words; w++) {
+        fresh[w] = Security.detected[w] & Security.armed[w] & ~Security.reported[w];
+        Security.reported[w] |= fresh[w];
+
+        for (uint64_t bits = fresh[w] & Security.alarms[w]; bits != 0; bits &= bits - 1) {
+            SecuritySensor *sensor = (SecuritySensor *)RegistryAt(&Security.index,
+                w * SECURITY_WORD_BITS + __builtin_ctzll(bits));
+            alarm_zones |= sensor->zones & Security.armed_zones;
+        }
+    }
+
+    if (alarm_zones != 0) {
+        Security.alarm_zones |= alarm_zones;
+
+        if (!Security.alarm) {
+            AlarmSet(true);
+            save = true;
+        }
     }
 
-    return 0;
+    for (unsigned w = 0; w < Security.words; w++) {
+        for (uint64_t bits = fresh[w]; bits != 0; bits &= bits - 1) {
+            SecuritySensor *sensor = (SecuritySensor *)RegistryAt(&Security.index,
+                w * SECURITY_WORD_BITS + __builtin_ctzll(bits));
+
+            LogF(LOG_TYPE_INFO, "SECURITY", "Security sensor \"%s\" detected!", sensor->name);
+            JournalAdd(JOURNAL_CTRL_SECURITY, JOURNAL_EVENT_DETECTED, sensor->name, 1);
+
+            StackUnit *unit = StackUnitGet(RPC_DEFAULT_UNIT);
+            snprintf(msg, STR_LEN, "ОХРАНА:%s+Обнаружено+проникновение+%s", unit->name, sensor->name);
+
+            unsigned channels = (sensor->sms ? NOTIFIER_SMS : 0) | (sensor->telegram ? NOTIFIER_TELEGRAM : 0);
+
+            if (!NotifierPost(channels, msg)) {
+                Log(LOG_TYPE_ERROR, "SECURITY", "Failed to queue alarm message");
+            }
+        }
+    }
+
+    mtx_unlock(&Security.sts_mtx);
+
+    if (save) {
+        StatusSaveQueue();
+    }
+}
+
+static void KeyHandler(const char *id, bool present, void *data)
+{
+    if (!present) {
+        return;
+    }
+
+    if (!SecurityKeyCheck(id)) {
+        LogF(LOG_TYPE_ERROR, "SECURITY", "Invalid security key: \"%s\"", id);
+        return;
+    }
+
+    if (!SecurityStatusSet(!SecurityStatusGet(), true)) {
+        LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to switch security status by iButton");
+    }
+
+    if (SecurityStatusGet()) {
+        if (!ScenarioStart(SCENARIO_OUT_HOME)) {
+            Log(LOG_TYPE_ERROR, "SECURITY", "Failed to start scenario OUT_HOME");
+        }
+    } else {
+        if (!ScenarioStart(SCENARIO_IN_HOME)) {
+            Log(LOG_TYPE_ERROR, "SECURITY", "Failed to start scenario IN_HOME");
+        }
+    }
+
+    LogF(LOG_TYPE_INFO, "SECURITY", "Detected valid key: \"%s\"", id);
 }
 
 /*********************************************************************/
@@ -272,12 +451,30 @@ SecuritySensor *SecuritySensorNew(const char *name, SecuritySensorType type, Gpi
     sensor->telegram = telegram;
     sensor->sms = sms;
     sensor->alarm = alarm;
-    sensor->counter = 0;
+    sensor->id = 0;
+    sensor->zones = SECURITY_ZONES_ALL;
+    sensor->history = 0;
+    sensor->samples = SECURITY_DETECT_SAMPLES;
+    sensor->window = SECURITY_DETECT_WINDOW;
+    sensor->pulses = 0;
     sensor->detected = false;
 
     return sensor;
 }
 
+bool SecuritySensorDetectSet(SecuritySensor *sensor, unsigned samples, unsigned window)
+{
+    if (window == 0 || window > SECURITY_DETECT_WINDOW_MAX || samples == 0 || samples > window) {
+        return false;
+    }
+
+    sensor->samples = samples;
+    sensor->window = window;
+    sensor->history &= WindowMask(window);
+
+    return true;
+}
+
 SecurityKey *SecurityKeyNew(const char *name, const char *value)
 {
     SecurityKey *key = (SecurityKey *)malloc(sizeof(SecurityKey));
@@ -313,24 +510,21 @@ bool SecurityKeyCheck(const char *key)
 
 bool SecurityControllerStart()
 {
-    thrd_t  sens_th, keys_th;
-
     if (!SecurityEnabledGet()) {
         return true;
     }
 
     Log(LOG_TYPE_INFO, "SECURITY", "Starting Security controller");
 
-    if (thrd_create(&sens_th, &SensorsThread, NULL) != thrd_success) {
-        return false;
-    }
-    if (thrd_detach(sens_th) != thrd_success) {
-        return false;
-    }
-    if (thrd_create(&keys_th, &KeysThread, NULL) != thrd_success) {
+    call_once(&security_once, SecurityInit);
+
+    Security.timer = TimerNew(SensorsTimerHandler, NULL);
+    if (!TimerPeriodicSet(Security.timer, SECURITY_SENSOR_CHECK_SEC * 1000)) {
         return false;
     }
-    if (thrd_detach(keys_th)) {
+
+    /* Key toggles status once per touch as only attach is handled */
+    if (!OneWireSubscribe(ONE_WIRE_IBUTTON_PREFIX, KeyHandler, NULL)) {
         return false;
     }
 
@@ -339,100 +533,125 @@ bool SecurityControllerStart()
 
 bool SecurityStatusSet(bool status, bool save)
 {
-    char    msg[STR_LEN];
+    return SecurityZonesStatusSet(SECURITY_ZONES_ALL, status, save);
+}
 
-    if (status != Security.status) {
-        mtx_lock(&Security.sts_mtx);
+bool SecurityZonesStatusSet(uint32_t zones, bool status, bool save)
+{
+    char        msg[STR_LEN];
+    uint32_t    all = ZonesMaskGet();
 
-        Security.status = status;
+    if (zones != SECURITY_ZONES_ALL && (zones & ~all) != 0) {
+        return false;
+    }
 
-        if (!status) {
-            LogF(LOG_TYPE_INFO, "SECURITY", "Security controller disabled");
-            SecurityAlarmSet(false, true);
-        } else {
-            LogF(LOG_TYPE_INFO, "SECURITY", "Security controller enabled");
-        }
+    call_once(&security_once, SecurityInit);
 
-        for (GList *s = Security.sensors; s != NULL; s = s->next) {
-            SecuritySensor *sensor = (SecuritySensor *)s->data;
-            sensor->detected = false;
-            sensor->counter = 0;
-        }
+    mtx_lock(&Security.sts_mtx);
 
-        GpioPinWrite(Security.gpio[SECURITY_GPIO_STATUS_LED], status);
+    uint32_t armed = status ? (Security.armed_zones | zones) : (Security.armed_zones & ~zones);
+    uint32_t changed = (armed ^ Security.armed_zones) & all;
 
-        /**
-         * Buzzer on/off
-         */
+    if (changed == 0) {
+        mtx_unlock(&Security.sts_mtx);
+        return true;
+    }
 
-        if (status && Security.sound[SECURITY_SOUND_EXIT]) {
-            PlcBuzzerRun(PLC_BUZZER_SECURITY_EXIT, true);
-        } else if (!status && Security.sound[SECURITY_SOUND_ENTER]) {
-            PlcBuzzerRun(PLC_BUZZER_SECURITY_ENTER, true);
-        }
+    Security.armed_zones &= ~changed;
+    if (status) {
+        Security.armed_zones |= changed;
+    }
+
+    uint64_t *sensors = Security.mask;
+
+    memset(sensors, 0, Security.words * sizeof(uint64_t));
 
-        /**
-         * Save status to DB
-         */
+    for (uint32_t bits = changed; bits != 0; bits &= bits - 1) {
+        SecurityZone *zone = (SecurityZone *)RegistryAt(&Security.zones_index, __builtin_ctz(bits));
 
-        if (save) {
-            StatusSave(SECURITY_SAVE_TYPE_STATUS, status);
+        for (unsigned w = 0; w < Security.words; w++) {
+            sensors[w] |= zone->sensors[w];
         }
+        LogF(LOG_TYPE_INFO, "SECURITY", "Security zone \"%s\" %s", zone->name, status ? "enabled" : "disabled");
+        JournalAdd(JOURNAL_CTRL_SECURITY, JOURNAL_EVENT_STATUS, zone->name, status);
+    }
 
-        /**
-         * Send notify
-         */
+    SensorsReset(sensors);
+    ArmedUpdate();
 
-        StackUnit *unit = StackUnitGet(RPC_DEFAULT_UNIT);
+    /* Alarm stays on while any zone which raised it is armed */
+    if (!status) {
+        Security.alarm_zones &= Security.armed_zones;
 
-        if (status) {
-            snprintf(msg, STR_LEN, "ОХРАНА:%s+сигнализация+включена", unit->name);
-        } else {
-            snprintf(msg, STR_LEN, "ОХРАНА:%s+сигнализация+отключена", unit->name);
+        if (Security.alarm && Security.alarm_zones == 0) {
+            AlarmSet(false);
         }
+    }
+
+    IndicatorSet(Security.gpio[SECURITY_GPIO_STATUS_LED], Security.armed_zones != 0);
+
+    /**
+     * Buzzer on/off
+     */
+
+    if (status && Security.sound[SECURITY_SOUND_EXIT]) {
+        PlcBuzzerRun(PLC_BUZZER_SECURITY_EXIT, true);
+    } else if (!status && Security.sound[SECURITY_SOUND_ENTER]) {
+        PlcBuzzerRun(PLC_BUZZER_SECURITY_ENTER, true);
+    }
+
+    /**
+     * Send notify
+     */
+
+    StackUnit *unit = StackUnitGet(RPC_DEFAULT_UNIT);
 
-        if (!NotifierTelegramSend(msg)) {
-            Log(LOG_TYPE_ERROR, "SECURITY", "Failed to send status telegram message");
-        } else {
-            Log(LOG_TYPE_INFO, "SECURITY", "Status message was sended to telegram");
+    if (changed == all) {
+        snprintf(msg, STR_LEN, "ОХРАНА:%s+сигнализация+%s", unit->name, status ? "включена" : "отключена");
+
+        if (!NotifierPost(NOTIFIER_TELEGRAM | NOTIFIER_SMS, msg)) {
+            Log(LOG_TYPE_ERROR, "SECURITY", "Failed to queue status message");
         }
+    } else {
+        for (uint32_t bits = changed; bits != 0; bits &= bits - 1) {
+            SecurityZone *zone = (SecurityZone *)RegistryAt(&Security.zones_index, __builtin_ctz(bits));
 
-        if (!NotifierSmsSend(msg)) {
-            Log(LOG_TYPE_ERROR, "SECURITY", "Failed to send security status sms message");
-        } else {
-            Log(LOG_TYPE_INFO, "SECURITY", "Status sms was sended to phone");
+            snprintf(msg, STR_LEN, "ОХРАНА:%s+зона+%s+%s", unit->name, zone->name, status ? "включена" : "отключена");
+
+            if (!NotifierPost(NOTIFIER_TELEGRAM | NOTIFIER_SMS, msg)) {
+                Log(LOG_TYPE_ERROR, "SECURITY", "Failed to queue status message");
+            }
         }
+    }
 
-        mtx_unlock(&Security.sts_mtx);
+    mtx_unlock(&Security.sts_mtx);
+
+    /**
+     * Save status to DB
+     */
+
+    if (save) {
+        return StatusSaveQueue();
     }
 
     return true;
 }
 
+uint32_t SecurityZonesStatusGet()
+{
+    return Security.armed_zones;
+}
+
 bool SecurityAlarmSet(bool status, bool save)
 {
-    Security.alarm = status;
+    call_once(&security_once, SecurityInit);
 
-    if (status) {
-        PlcAlarmSet(PLC_ALARM_SECURITY, true);
-        if (Security.sound[SECURITY_SOUND_ALARM]) {
-            PlcBuzzerRun(PLC_BUZZER_LOOP, true);
-        }
-        GpioPinWrite(Security.gpio[SECURITY_GPIO_ALARM_RELAY], true);
-        LogF(LOG_TYPE_INFO, "SECURITY", "Security controller alarm enabled");
-    } else {
-        PlcAlarmSet(PLC_ALARM_SECURITY, false);
-        if (Security.sound[SECURITY_SOUND_ALARM]) {
-            PlcBuzzerRun(PLC_BUZZER_LOOP, false);
-        }
-        GpioPinWrite(Security.gpio[SECURITY_GPIO_ALARM_RELAY], false);
-        LogF(LOG_TYPE_INFO, "SECURITY", "Security controller alarm disabled");
-    }
+    mtx_lock(&Security.sts_mtx);
+    AlarmSet(status);
+    mtx_unlock(&Security.sts_mtx);
 
     if (save) {
-        if (!StatusSave(SECURITY_SAVE_TYPE_ALARM, status)) {
-            return false;
-        }
+        return StatusSaveQueue();
     }
 
     return true;
@@ -445,23 +664,87 @@ bool SecurityAlarmGet()
 
 bool SecurityStatusGet()
 {
-    return Security.status;
+    return Security.armed_zones != 0;
 }
 
-void SecuritySensorAdd(const SecuritySensor *sensor)
+SecurityZone *SecurityZoneNew(const char *name)
 {
-    Security.sensors = g_list_append(Security.sensors, (void *)sensor);
+    SecurityZone *zone = (SecurityZone *)malloc(sizeof(SecurityZone));
+
+    strncpy(zone->name, name, SHORT_STR_LEN);
+    zone->id = 0;
+    zone->sensors = NULL;
+
+    return zone;
 }
 
-SecuritySensor *SecuritySensorGet(const char *name)
+bool SecurityZoneAdd(SecurityZone *zone)
 {
-    for (GList *c = Security.sensors; c != NULL; c = c->next) {
-        SecuritySensor *sensor = (SecuritySensor *)c->data;
-        if (!strcmp(sensor->name, name)) {
-            return sensor;
+    if (RegistryCount(&Security.zones_index) >= SECURITY_ZONES_MAX) {
+        LogF(LOG_TYPE_ERROR, "SECURITY", "Too many security zones, max is %d", SECURITY_ZONES_MAX);
+        return false;
+    }
+
+    if (Security.words != 0) {
+        zone->sensors = (uint64_t *)calloc(Security.words, sizeof(uint64_t));
+        if (zone->sensors == NULL) {
+            return false;
         }
     }
-    return NULL;
+
+    zone->id = RegistryAdd(&Security.zones_index, zone->name, (void *)zone);
+    Security.zones = g_list_append(Security.zones, (void *)zone);
+
+    return true;
+}
+
+SecurityZone *SecurityZoneGet(const char *name)
+{
+    return (SecurityZone *)RegistryGet(&Security.zones_index, name);
+}
+
+GList **SecurityZonesGet()
+{
+    return &Security.zones;
+}
+
+bool SecuritySensorAdd(SecuritySensor *sensor)
+{
+    call_once(&security_once, SecurityInit);
+
+    mtx_lock(&Security.sts_mtx);
+
+    if (!MasksGrow(RegistryCount(&Security.index) + 1)) {
+        mtx_unlock(&Security.sts_mtx);
+        LogF(LOG_TYPE_ERROR, "SECURITY", "Failed to alloc masks for security sensor \"%s\"", sensor->name);
+        return false;
+    }
+
+    sensor->id = RegistryAdd(&Security.index, sensor->name, (void *)sensor);
+    sensor->zones &= ZonesMaskGet();
+
+    /* Zone membership is compiled once, scans only combine masks */
+    for (uint32_t bits = sensor->zones; bits != 0; bits &= bits - 1) {
+        SecurityZone *zone = (SecurityZone *)RegistryAt(&Security.zones_index, __builtin_ctz(bits));
+        MaskBitSet(zone->sensors, sensor->id);
+    }
+
+    if (sensor->alarm) {
+        MaskBitSet(Security.alarms, sensor->id);
+    }
+
+    /* Sensor of already armed zone is watched at once */
+    ArmedUpdate();
+
+    mtx_unlock(&Security.sts_mtx);
+
+    Security.sensors = g_list_append(Security.sensors, (void *)sensor);
+    return true;
+}
+
+SecuritySensor *SecuritySensorGet(const char *name)
+{
+    return (SecuritySensor *)RegistryGet(&Security.index, name);
 }
 
 GList **SecuritySensorsGet()
@@ -9,8 +9,12 @@
 /*********************************************************************/
 
 #include <controllers/socket.h>
+#include <core/scan.h>
+#include <core/loop.h>
 #include <utils/log.h>
+#include <utils/registry.h>
 #include <db/database.h>
+#include <db/journal.h>
 
 #include <stdlib.h>
 #include <threads.h>
@@ -22,8 +26,9 @@
 /*********************************************************************/
 
 static struct _Sockets {
-    GList   *sockets;
-    mtx_t   db_mtx;
+    GList       *sockets;
+    Registry    index;
+    mtx_t       db_mtx;
 } Sockets = {
     .sockets = NULL
 };
@@ -59,47 +64,20 @@ static bool StatusSave(const char *name, bool status)
     return true;
 }
 
-static int StatusSaveThread(void *data)
+static void StatusSaveWork(void *data)
 {
     Socket *sock = (Socket *)data;
 
     mtx_lock(&Sockets.db_mtx);
-
-    if (!StatusSave(sock->name, sock->status)) {
-        mtx_unlock(&Sockets.db_mtx);
-        return -1;
-    }
-
+    StatusSave(sock->name, sock->status);
     mtx_unlock(&Sockets.db_mtx);
-    return 0;
 }
 
-static int SocketThread(void *data)
+static void ButtonHandler(const GpioEvent *event, void *data)
 {
-    bool state = false;
-
-     for (;;) {
-        bool pressed = false;
-
-        for (GList *s = Sockets.sockets; s != NULL; s = s->next) {
-            Socket *socket = (Socket *)s->data;
-
-            if (GpioPinRead(socket->gpio[SOCKET_PIN_BUTTON], &state)) {
-                if (state) {
-                    pressed = true;
-                    SocketStatusSet(socket, !SocketStatusGet(socket), true);
-                }
-            } else {
-                LogF(LOG_TYPE_ERROR, "SOCKET", "Failed to read GPIO \"%s\"", socket->gpio[SOCKET_PIN_BUTTON]->name);
-            }
-        }
+    Socket *socket = (Socket *)data;
 
-        if (pressed) {
-            UtilsMsecSleep(800);
-        }
-
-        UtilsMsecSleep(200);
-     }
+    SocketStatusSet(socket, !SocketStatusGet(socket), true);
 }
 
 /*********************************************************************/
@@ -122,15 +100,15 @@ Socket *SocketNew(const char *name, GpioPin *button, GpioPin *relay, SocketGroup
 
 bool SocketControllerStart()
 {
-    thrd_t  sock_th;
-
     Log(LOG_TYPE_INFO, "SOCKET", "Starting Socket controller");
 
-    if (thrd_create(&sock_th, &SocketThread, NULL) != thrd_success) {
-        return false;
-    }
-    if (thrd_detach(sock_th) != thrd_success) {
-        return false;
+    for (GList *s = Sockets.sockets; s != NULL; s = s->next) {
+        Socket *socket = (Socket *)s->data;
+
+        if (!ScanSubscribe(socket->gpio[SOCKET_PIN_BUTTON], GPIO_EDGE_RISING, ButtonHandler, socket)) {
+            LogF(LOG_TYPE_ERROR, "SOCKET", "Failed to watch GPIO \"%s\"", socket->gpio[SOCKET_PIN_BUTTON]->name);
+            return false;
+        }
     }
 
     return true;
@@ -138,6 +116,7 @@ bool SocketControllerStart()
 
 void SocketAdd(Socket *sock)
 {
+    RegistryAdd(&Sockets.index, sock->name, sock);
     Sockets.sockets = g_list_append(Sockets.sockets, sock);
 }
 
@@ -148,18 +127,14 @@ GList **SocketsGet()
 
 Socket *SocketGet(const char *name)
 {
-    for (GList *s = Sockets.sockets; s != NULL; s = s->next) {
-        Socket *socket = (Socket *)s->data;
-        if (!strcmp(socket->name, name)) {
-            return socket;
-        }
-    }
-    return NULL;
+    return (Socket *)RegistryGet(&Sockets.index, name);
 }
 
 bool SocketStatusSet(Socket *sock, bool status, bool save)
 {
-    thrd_t  save_th;
+    if (status != sock->status) {
+        JournalAdd(JOURNAL_CTRL_SOCKET, JOURNAL_EVENT_STATUS, sock->name, status);
+    }
 
     sock->status = status;
 
@@ -171,15 +146,10 @@ bool SocketStatusSet(Socket *sock, bool status, bool save)
         LogF(LOG_TYPE_INFO, "SOCKET", "Socket \"%s\" off", sock->name);
     }
 
-    if (save) {
-        if (thrd_create(&save_th, &StatusSaveThread, (void *)sock) != thrd_success) {
-            LogF(LOG_TYPE_INFO, "SOCKET", "Failed to create StatusSave thread for socket \"%s\"", sock->name);
-            return false;
-        }
-        if (thrd_detach(save_th) != thrd_success) {
-            LogF(LOG_TYPE_INFO, "SOCKET", "Failed to detach StatusSave thread for socket \"%s\"", sock->name);
-            return false;
-        }
+    /* Database is written by worker, caller is not blocked by sqlite */
+    if (save && !LoopWorkAdd(StatusSaveWork, (void *)sock)) {
+        LogF(LOG_TYPE_ERROR, "SOCKET", "Failed to queue status save for socket \"%s\"", sock->name);
+        return false;
     }
 
     return true;
@@ -9,9 +9,14 @@
 /*********************************************************************/
 
 #include <controllers/tank.h>
+#include <core/scan.h>
+#include <core/indicator.h>
+#include <core/timer.h>
 #include <utils/log.h>
+#include <utils/registry.h>
 #include <net/notifier.h>
 #include <db/database.h>
+#include <db/journal.h>
 #include <plc/plc.h>
 
 #include <stdlib.h>
@@ -24,10 +29,13 @@
 /*********************************************************************/
 
 static struct _Tanks {
-    GList   *tanks;
-    mtx_t   sts_mtx;
+    GList       *tanks;
+    Registry    index;
+    mtx_t       sts_mtx;
+    Timer       *timer;
 } Tanks = {
-    .tanks = NULL
+    .tanks = NULL,
+    .timer = NULL
 };
 
 /*********************************************************************/
@@ -75,6 +83,9 @@ static bool NotifyLevelCheck(Tank *tank, unsigned num)
 
 static void TankLevelProcess(Tank *tank)
 {
+    bool    pump = tank->pump;
+    bool    valve = tank->valve;
+
     if (!tank->status || tank->level == TANK_LEVEL_PERCENT_DEFAULT) {
         return;
     }
@@ -115,81 +126,68 @@ static void TankLevelProcess(Tank *tank)
     LogF(LOG_TYPE_INFO, "TANK", "Tank \"%s\" valve %s", tank->name, (tank->valve == true) ? "openned" : "closed");
     LogF(LOG_TYPE_INFO, "TANK", "Tank \"%s\" pump %s", tank->name, (tank->pump == true) ? "enabled" : "disabled");
 
+    if (tank->pump != pump) {
+        JournalAdd(JOURNAL_CTRL_TANK, JOURNAL_EVENT_PUMP, tank->name, tank->pump);
+    }
+    if (tank->valve != valve) {
+        JournalAdd(JOURNAL_CTRL_TANK, JOURNAL_EVENT_VALVE, tank->name, tank->valve);
+    }
+
     if (NotifyLevelCheck(tank, tank->level)) {
         char    msg[STR_LEN];
 
         snprintf(msg, STR_LEN, "БАК+\"%s\":+уровень+воды+%u%%", tank->name,  tank->level);
 
-        if (!NotifierTelegramSend(msg)) {
+        if (!NotifierPost(NOTIFIER_TELEGRAM, msg)) {
             Log(LOG_TYPE_ERROR, "TANK", "Failed to send level notify");
         }
     }
 }
 
-static int TankLevelsThread(void *data)
+static void LevelsTimerHandler(void *data)
 {
     bool state;
 
-     for (;;) {
-        for (GList *t = Tanks.tanks; t != NULL; t = t->next) {
-            Tank *tank = (Tank *)t->data;
-            unsigned level_num = 0;
+    for (GList *t = Tanks.tanks; t != NULL; t = t->next) {
+        Tank *tank = (Tank *)t->data;
+        unsigned level_num = 0;
 
-            for (GList *l = tank->levels; l != NULL; l = l->next) {
-                TankLevel *level = (TankLevel *)l->data;
+        for (GList *l = tank->levels; l != NULL; l = l->next) {
+            TankLevel *level = (TankLevel *)l->data;
 
-                if (!GpioPinRead(level->gpio, &state)) {
-                    LogF(LOG_TYPE_ERROR, "TANK", "Failed to read GPIO \"%s\"", level->gpio->name);
-                    continue;
-                }
+            if (!ScanInputGet(level->gpio, &state)) {
+                LogF(LOG_TYPE_ERROR, "TANK", "Failed to read GPIO \"%s\"", level->gpio->name);
+                continue;
+            }
 
-                if (state) {
-                    if (level->percent > level_num) {
-                        level_num = level->percent;
-                    }
+            if (state) {
+                if (level->percent > level_num) {
+                    level_num = level->percent;
                 }
-
-                level->state = state;
             }
 
-            if (tank->level != level_num) {
-                tank->level = level_num;
-
-                TankLevelProcess(tank);
-            }
+            level->state = state;
         }
-        UtilsSecSleep(1);
-    }
-}
-
-static int TankStatusThread(void *data)
-{
-    bool state;
 
-     for (;;) {
-        bool pressed = false;
+        if (tank->flow != NULL && !TankFlowUpdate(tank->flow)) {
+            LogF(LOG_TYPE_ERROR, "TANK", "Failed to read flow meter GPIO \"%s\"", tank->flow->gpio->name);
+        }
 
-        for (GList *t = Tanks.tanks; t != NULL; t = t->next) {
-            Tank *tank = (Tank *)t->data;
+        if (tank->level != level_num) {
+            tank->level = level_num;
 
-            if (!GpioPinRead(tank->gpio[TANK_GPIO_STATUS_BUTTON], &state)) {
-                LogF(LOG_TYPE_ERROR, "TANK", "Failed to read GPIO \"%s\"", tank->gpio[TANK_GPIO_STATUS_BUTTON]->name);
-            } else {
-                if (state) {
-                    pressed = true;
-                    if (!TankStatusSet(tank, !TankStatusGet(tank), true)) {
-                        LogF(LOG_TYPE_ERROR, "TANK", "Failed to switch tank \"%s\" status", tank->name);
-                    }
-                }
-            }
+            TankLevelProcess(tank);
         }
+    }
+}
 
-        if (pressed) {
-            UtilsMsecSleep(800);
-        }
+static void StatusButtonHandler(const GpioEvent *event, void *data)
+{
+    Tank *tank = (Tank *)data;
 
-        UtilsMsecSleep(200);
-     }
+    if (!TankStatusSet(tank, !TankStatusGet(tank), true)) {
+        LogF(LOG_TYPE_ERROR, "TANK", "Failed to switch tank \"%s\" status", tank->name);
+    }
 }
 
 /*********************************************************************/
@@ -219,6 +217,32 @@ TankLevel *TankLevelNew(unsigned percent, GpioPin *gpio, bool notify)
     return level;
 }
 
+TankFlow *TankFlowNew(GpioPin *gpio, unsigned pulses)
+{
+    TankFlow *flow = (TankFlow *)malloc(sizeof(TankFlow));
+
+    flow->gpio = gpio;
+    flow->pulses = (pulses != 0) ? pulses : 1;
+    flow->count = 0;
+    flow->volume = 0.0f;
+
+    return flow;
+}
+
+bool TankFlowUpdate(TankFlow *flow)
+{
+    ScanCounter cnt;
+
+    if (!ScanCounterGet(flow->gpio, &cnt)) {
+        return false;
+    }
+
+    flow->volume += (float)(cnt.pulses - flow->count) / (float)flow->pulses;
+    flow->count = cnt.pulses;
+
+    return true;
+}
+
 Tank *TankNew(const char *name)
 {
     Tank *tank = (Tank *)malloc(sizeof(Tank));
@@ -229,6 +253,7 @@ Tank *TankNew(const char *name)
     tank->status = false;
     tank->pump = false;
     tank->valve = false;
+    tank->flow = NULL;
 
     return tank;
 }
@@ -243,6 +268,11 @@ void TankGpioSet(Tank *tank, TankGpio id, GpioPin *gpio)
     tank->gpio[id] = gpio;
 }
 
+void TankFlowSet(Tank *tank, TankFlow *flow)
+{
+    tank->flow = flow;
+}
+
 void TankLevelAdd(Tank *tank, TankLevel *level)
 {
     tank->levels = g_list_append(tank->levels, (void *)level);
@@ -250,6 +280,7 @@ void TankLevelAdd(Tank *tank, TankLevel *level)
 
 void TankAdd(Tank *tank)
 {
+    RegistryAdd(&Tanks.index, tank->name, tank);
     Tanks.tanks = g_list_append(Tanks.tanks, (void *)tank);
 }
 
@@ -259,11 +290,19 @@ bool TankStatusSet(Tank *tank, bool status, bool save)
         mtx_lock(&Tanks.sts_mtx);
 
         LogF(LOG_TYPE_INFO, "TANK", "Tank \"%s\" water control %s", tank->name, (status == true) ? "enabled" : "disabled");
+        JournalAdd(JOURNAL_CTRL_TANK, JOURNAL_EVENT_STATUS, tank->name, status);
 
         tank->status = status;
-        GpioPinWrite(tank->gpio[TANK_GPIO_STATUS_LED], status);
+        IndicatorSet(tank->gpio[TANK_GPIO_STATUS_LED], status);
 
         if (!status) {
+            if (tank->pump) {
+                JournalAdd(JOURNAL_CTRL_TANK, JOURNAL_EVENT_PUMP, tank->name, false);
+            }
+            if (tank->valve) {
+                JournalAdd(JOURNAL_CTRL_TANK, JOURNAL_EVENT_VALVE, tank->name, false);
+            }
+
             GpioPinWrite(tank->gpio[TANK_GPIO_PUMP], false);
             GpioPinWrite(tank->gpio[TANK_GPIO_VALVE], false);
             tank->valve = false;
@@ -284,13 +323,7 @@ bool TankStatusSet(Tank *tank, bool status, bool save)
 
 Tank *TankGet(const char *name)
 {
-    for (GList *t = Tanks.tanks; t != NULL; t = t->next) {
-        Tank *tank = (Tank *)t->data;
-        if (!strcmp(tank->name, name)) {
-            return tank;
-        }
-    }
-    return NULL;
+    return (Tank *)RegistryGet(&Tanks.index, name);
 }
 
 bool TankStatusGet(Tank *tank)
@@ -305,6 +338,10 @@ bool TankPumpSet(Tank *tank, bool status)
         return false;
     }
 
+    if (tank->pump != status) {
+        JournalAdd(JOURNAL_CTRL_TANK, JOURNAL_EVENT_PUMP, tank->name, status);
+    }
+
     GpioPinWrite(tank->gpio[TANK_GPIO_PUMP], status);
     tank->pump = status;
     LogF(LOG_TYPE_INFO, "TANK", "Tank \"%s\" pump %s", tank->name, (status == true) ? "enabled" : "disabled");
@@ -319,6 +356,10 @@ bool TankValveSet(Tank *tank, bool status)
         return false;
     }
 
+    if (tank->valve != status) {
+        JournalAdd(JOURNAL_CTRL_TANK, JOURNAL_EVENT_VALVE, tank->name, status);
+    }
+
     GpioPinWrite(tank->gpio[TANK_GPIO_VALVE], status);
     tank->valve = status;
     LogF(LOG_TYPE_INFO, "TANK", "Tank \"%s\" valve %s", tank->name, (status == true) ? "openned" : "closed");
@@ -328,21 +369,20 @@ bool TankValveSet(Tank *tank, bool status)
 
 bool TankControllerStart()
 {
-    thrd_t  lvl_th, sts_th;
-
     Log(LOG_TYPE_INFO, "TANK", "Starting Tank controller");
 
-    if (thrd_create(&lvl_th, &TankLevelsThread, NULL) != thrd_success) {
-        return false;
-    }
-    if (thrd_detach(lvl_th) != thrd_success) {
+    Tanks.timer = TimerNew(LevelsTimerHandler, NULL);
+    if (!TimerPeriodicSet(Tanks.timer, TANK_CHECK_SEC * 1000)) {
         return false;
     }
-    if (thrd_create(&sts_th, &TankStatusThread, NULL) != thrd_success) {
-        return false;
-    }
-    if (thrd_detach(sts_th) != thrd_success) {
-        return false;
+
+    for (GList *t = Tanks.tanks; t != NULL; t = t->next) {
+        Tank *tank = (Tank *)t->data;
+
+        if (!ScanSubscribe(tank->gpio[TANK_GPIO_STATUS_BUTTON], GPIO_EDGE_RISING, StatusButtonHandler, tank)) {
+            LogF(LOG_TYPE_ERROR, "TANK", "Failed to watch GPIO \"%s\"", tank->gpio[TANK_GPIO_STATUS_BUTTON]->name);
+            return false;
+        }
     }
 
     return true;
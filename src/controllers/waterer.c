@@ -9,9 +9,15 @@
 /*********************************************************************/
 
 #include <controllers/waterer.h>
+#include <core/scan.h>
+#include <core/indicator.h>
+#include <core/timer.h>
+#include <plc/clock.h>
 #include <utils/log.h>
+#include <utils/registry.h>
 #include <net/notifier.h>
 #include <db/database.h>
+#include <db/journal.h>
 
 #include <threads.h>
 
@@ -22,10 +28,15 @@
 /*********************************************************************/
 
 static struct {
-    GList   *waterers;
-    mtx_t   sts_mtx;
+    GList       *waterers;
+    Registry    index;
+    mtx_t       sts_mtx;
+    Timer       *timer;
+    Timer       *check_timer;
 } Watering = {
-    .waterers = NULL
+    .waterers = NULL,
+    .timer = NULL,
+    .check_timer = NULL
 };
 
 /*********************************************************************/
@@ -66,32 +77,106 @@ static void WatererNotify(Waterer *wtr)
 
     snprintf(msg, STR_LEN, "ПОЛИВ+\"%s\":+кран+%s", wtr->name, (wtr->valve == true) ? "открыт" : "закрыт");
 
-    if (!NotifierTelegramSend(msg)) {
+    if (!NotifierPost(NOTIFIER_TELEGRAM, msg)) {
         Log(LOG_TYPE_ERROR, "WATERER", "Failed to send waterer notify");
     }
 }
 
-static void WateringTimesCheck(Waterer *wtr)
+static int64_t MinuteGet(const PlcTime *time)
 {
-    PlcTime now;
+    /* Days from civil date, year starts in March to keep leap day last */
+    int64_t     y = (int64_t)time->year - (time->month <= 2);
+    int64_t     era = (y >= 0 ? y : y - 399) / 400;
+    unsigned    yoe = (unsigned)(y - era * 400);
+    unsigned    doy = (153 * (time->month + (time->month > 2 ? -3 : 9)) + 2) / 5 + time->day - 1;
+    unsigned    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t     days = era * 146097 + (int64_t)doe - 719468;
+
+    return days * 24 * 60 + time->hour * 60 + time->min;
+}
+
+static unsigned WeekMinuteGet(const PlcTime *time)
+{
+    return time->dow * 24 * 60 + time->hour * 60 + time->min;
+}
+
+static bool ScheduleCompile(Waterer *wtr)
+{
+    unsigned count = g_list_length(wtr->times);
 
-    PlcTimeGet(&now);
+    free(wtr->schedule);
+    wtr->schedule = NULL;
+    wtr->schedule_len = 0;
+
+    if (count == 0) {
+        return true;
+    }
+
+    wtr->schedule = (WateringEvent *)malloc(count * sizeof(WateringEvent));
+    if (wtr->schedule == NULL) {
+        return false;
+    }
 
     for (GList *t = wtr->times; t != NULL; t = t->next) {
         WateringTime *tm = (WateringTime *)t->data;
 
-        if (tm->state != wtr->valve) {
-            if (tm->time.dow == now.dow && tm->time.hour == now.hour && tm->time.min == now.min && wtr->status) {
-                GpioPinWrite(wtr->gpio[WATERER_GPIO_VALVE], tm->state);
-                wtr->valve = tm->state;
-                LogF(LOG_TYPE_INFO, "WATERER", "Waterer \"%s\" valve %s", wtr->name, (tm->state == true) ? "openned" : "closed");
+        if (tm->time.dow > 6 || tm->time.hour > 23 || tm->time.min > 59) {
+            LogF(LOG_TYPE_ERROR, "WATERER", "Waterer \"%s\" skip invalid time %u %02u:%02u",
+                wtr->name, tm->time.dow, tm->time.hour, tm->time.min);
+            continue;
+        }
 
-                if (tm->notify) {
-                    WatererNotify(wtr);
-                }
-            }
+        WateringEvent ev = {
+            .minute = WeekMinuteGet(&tm->time),
+            .state = tm->state,
+            .notify = tm->notify
+        };
+
+        /* Insertion keeps config order for events at the same minute */
+        unsigned i = wtr->schedule_len++;
+
+        while (i > 0 && wtr->schedule[i - 1].minute > ev.minute) {
+            wtr->schedule[i] = wtr->schedule[i - 1];
+            i--;
+        }
+        wtr->schedule[i] = ev;
+    }
+
+    return true;
+}
+
+static unsigned ScheduleNextGet(const Waterer *wtr, unsigned week)
+{
+    unsigned lo = 0, hi = wtr->schedule_len;
+
+    /* First event after current minute, schedule_len wraps to next week */
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (wtr->schedule[mid].minute <= week) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
+    return lo;
+}
+
+static unsigned ScheduleDelayGet(const Waterer *wtr, unsigned idx, unsigned week)
+{
+    unsigned minute = wtr->schedule[idx % wtr->schedule_len].minute;
+
+    if (idx >= wtr->schedule_len || minute <= week) {
+        minute += WATERER_WEEK_MIN;
+    }
+    return minute - week;
+}
+
+static void CheckTimerStart()
+{
+    if (!TimerPeriodicSet(Watering.check_timer, WATERER_CHECK_SEC * 1000)) {
+        Log(LOG_TYPE_ERROR, "WATERER", "Failed to start valves check timer");
+    }
 }
 
 static bool TankLevelEmptyCheck(Waterer *wtr)
@@ -104,58 +189,124 @@ static bool TankLevelEmptyCheck(Waterer *wtr)
             }
             wtr->valve = false;
             LogF(LOG_TYPE_INFO, "WATERER", "Waterer \"%s\" valve closed by empty tank", wtr->name);
+            JournalAdd(JOURNAL_CTRL_WATERER, JOURNAL_EVENT_VALVE, wtr->name, false);
         }
         return true;
     }
     return false;
 }
 
-static int WatererThread(void *data)
+static void WateringEventApply(Waterer *wtr, const WateringEvent *ev)
 {
-    for (;;) {
+    if (!wtr->status || ev->state == wtr->valve || TankLevelEmptyCheck(wtr)) {
+        return;
+    }
 
-        for (GList *w = Watering.waterers; w != NULL; w = w->next) {
-            Waterer *wtr = (Waterer *)w->data;
+    GpioPinWrite(wtr->gpio[WATERER_GPIO_VALVE], ev->state);
+    wtr->valve = ev->state;
+    LogF(LOG_TYPE_INFO, "WATERER", "Waterer \"%s\" valve %s", wtr->name, (ev->state == true) ? "openned" : "closed");
+    JournalAdd(JOURNAL_CTRL_WATERER, JOURNAL_EVENT_VALVE, wtr->name, ev->state);
 
-            if (!TankLevelEmptyCheck(wtr)) {
-                WateringTimesCheck(wtr);
-            }
+    if (ev->state) {
+        CheckTimerStart();
+    }
+
+    if (ev->notify) {
+        WatererNotify(wtr);
+    }
+}
+
+static void WateringScheduleCheck(Waterer *wtr, int64_t minute, unsigned week)
+{
+    /* Checked minute only grows, events are not repeated after clock moved back */
+    if (minute <= wtr->checked) {
+        return;
+    }
+
+    /* Only last event since previous check defines valve state */
+    unsigned idx = ScheduleNextGet(wtr, week);
+    const WateringEvent *ev = &wtr->schedule[(idx == 0) ? wtr->schedule_len - 1 : idx - 1];
+    unsigned ago = (week + WATERER_WEEK_MIN - ev->minute) % WATERER_WEEK_MIN;
+
+    if (minute - ago > wtr->checked) {
+        if (ago > 0) {
+            LogF(LOG_TYPE_INFO, "WATERER", "Waterer \"%s\" catch up event missed %u min ago", wtr->name, ago);
         }
+        WateringEventApply(wtr, ev);
+    }
+    wtr->checked = minute;
+}
+
+static void ScheduleTimerHandler(void *data)
+{
+    PlcTime     now;
+    uint64_t    sleep = WATERER_SLEEP_MAX_SEC * 1000;
 
-        UtilsSecSleep(1);
+    if (!PlcTimeGet(&now)) {
+        Log(LOG_TYPE_ERROR, "WATERER", "Failed to get time for watering schedule");
+        TimerOnceSet(Watering.timer, WATERER_CHECK_SEC * 1000);
+        return;
     }
-    return 0;
+
+    int64_t     minute = MinuteGet(&now);
+    unsigned    week = WeekMinuteGet(&now);
+
+    for (GList *w = Watering.waterers; w != NULL; w = w->next) {
+        Waterer *wtr = (Waterer *)w->data;
+
+        if (wtr->schedule_len == 0) {
+            continue;
+        }
+
+        WateringScheduleCheck(wtr, minute, week);
+
+        /* Seconds are not counted in schedule, so wake up at minute start */
+        unsigned delay = ScheduleDelayGet(wtr, ScheduleNextGet(wtr, week), week);
+        uint64_t msec = ((uint64_t)delay * 60 - now.sec) * 1000;
+
+        if (msec < sleep) {
+            sleep = msec;
+        }
+    }
+
+    /* Sleep is limited to follow local time shifts without clock step */
+    TimerAtSet(Watering.timer, UtilsMonoMsecGet() + sleep);
 }
 
-static int ButtonsThread(void *data)
+static void ValvesCheckTimerHandler(void *data)
 {
-    bool state;
-
-    for (;;) {
-        bool pressed = false;
-
-        for (GList *w = Watering.waterers; w != NULL; w = w->next) {
-            Waterer *wtr = (Waterer *)w->data;
-
-            if (!GpioPinRead(wtr->gpio[WATERER_GPIO_STATUS_BUTTON], &state)) {
-                LogF(LOG_TYPE_ERROR, "WATERER", "Failed to read GPIO \"%s\"", wtr->gpio[WATERER_GPIO_STATUS_BUTTON]->name);
-            } else {
-                if (state) {
-                    pressed = true;
-                    if (!WatererStatusSet(wtr, !wtr->status, true)) {
-                        LogF(LOG_TYPE_ERROR, "WATERER", "Failed to switch Waterer \"%s\" status", wtr->name);
-                    }
-                }
-            }
+    bool opened = false;
+
+    for (GList *w = Watering.waterers; w != NULL; w = w->next) {
+        Waterer *wtr = (Waterer *)w->data;
+
+        if (wtr->flow != NULL && !TankFlowUpdate(wtr->flow)) {
+            LogF(LOG_TYPE_ERROR, "WATERER", "Failed to read flow meter GPIO \"%s\"", wtr->flow->gpio->name);
         }
 
-        if (pressed) {
-            UtilsMsecSleep(800);
+        if (wtr->valve && !TankLevelEmptyCheck(wtr)) {
+            opened = true;
         }
+    }
+
+    /* Flow and tank level matter only while water runs */
+    if (!opened) {
+        TimerCancel(Watering.check_timer);
+    }
+}
+
+static void ClockStepHandler(void *data)
+{
+    TimerTrigger(Watering.timer);
+}
 
-        UtilsMsecSleep(200);
+static void StatusButtonHandler(const GpioEvent *event, void *data)
+{
+    Waterer *wtr = (Waterer *)data;
+
+    if (!WatererStatusSet(wtr, !wtr->status, true)) {
+        LogF(LOG_TYPE_ERROR, "WATERER", "Failed to switch Waterer \"%s\" status", wtr->name);
     }
-    return 0;
 }
 
 /*********************************************************************/
@@ -171,21 +322,19 @@ Waterer *WatererNew(const char *name, Tank *tank)
     strncpy(wtr->name, name, SHORT_STR_LEN);
     wtr->status = false;
     wtr->times = NULL;
+    wtr->schedule = NULL;
+    wtr->schedule_len = 0;
+    wtr->checked = 0;
     wtr->valve = false;
     wtr->tank = tank;
+    wtr->flow = NULL;
 
     return wtr;
 }
 
 Waterer *WatererGet(const char *name)
 {
-    for (GList *s = Watering.waterers; s != NULL; s = s->next) {
-        Waterer *wtr = (Waterer *)s->data;
-        if (!strcmp(wtr->name, name)) {
-            return wtr;
-        }
-    }
-    return NULL;
+    return (Waterer *)RegistryGet(&Watering.index, name);
 }
 
 WateringTime *WateringTimeNew(PlcTime time, bool state, bool notify)
@@ -201,6 +350,7 @@ WateringTime *WateringTimeNew(PlcTime time, bool state, bool notify)
 
 void WatererAdd(Waterer *wtr)
 {
+    RegistryAdd(&Watering.index, wtr->name, wtr);
     Watering.waterers = g_list_append(Watering.waterers, (void *)wtr);
 }
 
@@ -214,6 +364,11 @@ GList **WaterersGet()
     return &Watering.waterers;
 }
 
+void WatererFlowSet(Waterer *wtr, TankFlow *flow)
+{
+    wtr->flow = flow;
+}
+
 void WatererGpioSet(Waterer *wtr, WatererGpioType type, GpioPin *gpio)
 {
     wtr->gpio[type] = gpio;
@@ -225,11 +380,16 @@ bool WatererStatusSet(Waterer *wtr, bool status, bool save)
         mtx_lock(&Watering.sts_mtx);
 
         LogF(LOG_TYPE_INFO, "WATERER", "Waterer \"%s\" status %s", wtr->name, (status == true) ? "enabled" : "disabled");
+        JournalAdd(JOURNAL_CTRL_WATERER, JOURNAL_EVENT_STATUS, wtr->name, status);
 
         wtr->status = status;
-        GpioPinWrite(wtr->gpio[WATERER_GPIO_STATUS_LED], status);
+        IndicatorSet(wtr->gpio[WATERER_GPIO_STATUS_LED], status);
 
         if (!status) {
+            if (wtr->valve) {
+                JournalAdd(JOURNAL_CTRL_WATERER, JOURNAL_EVENT_VALVE, wtr->name, false);
+            }
+
             GpioPinWrite(wtr->gpio[WATERER_GPIO_VALVE], false);
             wtr->valve = false;
         }
@@ -271,37 +431,109 @@ bool WatererValveSet(Waterer *wtr, bool status)
         GpioPinWrite(wtr->gpio[WATERER_GPIO_VALVE], status);
         wtr->valve = status;
         LogF(LOG_TYPE_INFO, "WATERER", "Waterer \"%s\" valve %s", wtr->name, (status == true) ? "openned" : "closed");
+        JournalAdd(JOURNAL_CTRL_WATERER, JOURNAL_EVENT_VALVE, wtr->name, status);
         WatererNotify(wtr);
+
+        if (status) {
+            CheckTimerStart();
+        }
     }
 
     return true;
 }
 
-bool WatererControllerStart()
+unsigned WatererUpcomingGet(WateringAction *actions, unsigned count)
 {
-    thrd_t  wtr_th, bth_th;
+    PlcTime     now;
+    unsigned    found = 0;
+
+    if (count == 0 || !PlcTimeGet(&now)) {
+        return 0;
+    }
 
+    unsigned week = WeekMinuteGet(&now);
+
+    for (GList *w = Watering.waterers; w != NULL; w = w->next) {
+        Waterer *wtr = (Waterer *)w->data;
+        bool    status;
+
+        if (wtr->schedule_len == 0 || !WatererStatusGet(wtr, &status) || !status) {
+            continue;
+        }
+
+        unsigned next = ScheduleNextGet(wtr, week);
+
+        /* Events of one waterer are sorted, later ones can not fit when buffer is full */
+        for (unsigned n = 0; n < wtr->schedule_len && n < count; n++) {
+            const WateringEvent *ev = &wtr->schedule[(next + n) % wtr->schedule_len];
+            unsigned delay = ScheduleDelayGet(wtr, next + n, week);
+
+            if (found == count && delay >= actions[found - 1].delay) {
+                break;
+            }
+
+            unsigned i = (found < count) ? found++ : found - 1;
+
+            while (i > 0 && actions[i - 1].delay > delay) {
+                actions[i] = actions[i - 1];
+                i--;
+            }
+
+            actions[i].wtr = wtr;
+            actions[i].delay = delay;
+            actions[i].dow = ev->minute / (24 * 60);
+            actions[i].hour = ev->minute / 60 % 24;
+            actions[i].min = ev->minute % 60;
+            actions[i].state = ev->state;
+        }
+    }
+
+    return found;
+}
+
+bool WatererControllerStart()
+{
     if (g_list_length(Watering.waterers) == 0) {
         return true;
     }
 
     Log(LOG_TYPE_INFO, "WATERER", "Starting Waterer controller");
 
-    if (thrd_create(&wtr_th, &WatererThread, NULL) != thrd_success) {
+    PlcTime now;
+
+    if (!PlcTimeGet(&now)) {
+        Log(LOG_TYPE_ERROR, "WATERER", "Failed to get time for watering schedule");
         return false;
     }
 
-    if (thrd_detach(wtr_th) != thrd_success) {
+    Watering.timer = TimerNew(ScheduleTimerHandler, NULL);
+    Watering.check_timer = TimerNew(ValvesCheckTimerHandler, NULL);
+
+    if (Watering.timer == NULL || Watering.check_timer == NULL) {
         return false;
     }
 
-    if (thrd_create(&bth_th, &ButtonsThread, NULL) != thrd_success) {
-        return false;
+    for (GList *w = Watering.waterers; w != NULL; w = w->next) {
+        Waterer *wtr = (Waterer *)w->data;
+
+        if (!ScheduleCompile(wtr)) {
+            LogF(LOG_TYPE_ERROR, "WATERER", "Failed to compile Waterer \"%s\" schedule", wtr->name);
+            return false;
+        }
+
+        /* Events before start are not replayed */
+        wtr->checked = MinuteGet(&now);
+
+        if (!ScanSubscribe(wtr->gpio[WATERER_GPIO_STATUS_BUTTON], GPIO_EDGE_RISING, StatusButtonHandler, wtr)) {
+            LogF(LOG_TYPE_ERROR, "WATERER", "Failed to watch GPIO \"%s\"", wtr->gpio[WATERER_GPIO_STATUS_BUTTON]->name);
+            return false;
+        }
     }
 
-    if (thrd_detach(bth_th) != thrd_success) {
+    if (!ClockSubscribe(ClockStepHandler, NULL)) {
         return false;
     }
 
-    return true;
+    CheckTimerStart();
+    return TimerTrigger(Watering.timer);
 }
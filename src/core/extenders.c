@@ -11,12 +11,13 @@
 #include <glib-2.0/glib.h>
 
 #include <core/extenders.h>
+#include <core/sim.h>
+#include <utils/log.h>
 
 #ifdef __arm__
 #include <wiringPiLite/wiringPi.h>
 #include <wiringPiLite/pcf8574.h>
 #include <wiringPiLite/mcp23017.h>
-#include <wiringPiLite/ads1115.h>
 #endif
 
 /*********************************************************************/
@@ -25,50 +26,468 @@
 /*                                                                   */
 /*********************************************************************/
 
-static GList *exts = NULL;
+static struct _Extenders {
+    GList   *exts;
+    bool    defer;
+} Extenders = {
+    .exts = NULL,
+    .defer = false
+};
 
 /*********************************************************************/
 /*                                                                   */
-/*                          PUBLIC FUNCTIONS                         */
+/*                         PRIVATE FUNCTIONS                         */
 /*                                                                   */
 /*********************************************************************/
 
-Extender *ExtenderNew(const char *name, ExtenderType type, unsigned bus, unsigned addr, unsigned base)
+static unsigned PinsCount(const Extender *ext)
 {
-    Extender *ext = (Extender *)malloc(sizeof(Extender));
+    switch (ext->type) {
+        case EXT_TYPE_PCF_8574:
+            return EXT_PCF_8574_PINS;
 
-    strncpy(ext->name, name, SHORT_STR_LEN);
-    ext->type = type;
-    ext->addr = addr;
-    ext->base = base;
-    ext->bus = bus;
+        case EXT_TYPE_MCP_23017:
+            return EXT_MCP_23017_PINS;
 
-    return ext;    
+        case EXT_TYPE_ADS_1115:
+            return EXT_ADS_1115_PINS;
+    }
+    return 0;
 }
 
-bool ExtenderAdd(const Extender *ext, char *err)
+static SimDeviceType SimTypeGet(const Extender *ext)
 {
-#ifdef __arm__
+    switch (ext->type) {
+        case EXT_TYPE_MCP_23017:
+            return SIM_DEV_MCP_23017;
+
+        case EXT_TYPE_ADS_1115:
+            return SIM_DEV_ADS_1115;
+
+        default:
+            return SIM_DEV_PCF_8574;
+    }
+}
+
+static bool PortRead(Extender *ext)
+{
+    uint8_t buf[2];
+
     switch (ext->type) {
         case EXT_TYPE_PCF_8574:
-            if (!pcf8574Setup(ext->bus, ext->addr, ext->base)) {
+            if (!I2cRead(&ext->dev, buf, 1)) {
                 return false;
             }
-            break;
+            ext->in = buf[0];
+            return true;
 
         case EXT_TYPE_MCP_23017:
-            if (!mcp23017Setup(ext->bus, ext->addr, ext->base)) {
+            if (!I2cRegRead(&ext->dev, EXT_MCP_23017_GPIOA, buf, 2)) {
+                return false;
+            }
+            ext->in = buf[0] | (buf[1] << 8);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool PortWrite(Extender *ext)
+{
+    uint8_t buf[2];
+
+    switch (ext->type) {
+        case EXT_TYPE_PCF_8574:
+            /* Quasi-bidirectional inputs must be kept high */
+            buf[0] = (ext->out | ext->inputs) & 0xFF;
+            if (!I2cWrite(&ext->dev, buf, 1)) {
                 return false;
             }
             break;
 
-        case EXT_TYPE_ADS_1115:
-            if (!ads1115Setup(ext->bus, ext->addr, ext->base)) {
+        case EXT_TYPE_MCP_23017:
+            buf[0] = ext->out & 0xFF;
+            buf[1] = ext->out >> 8;
+            if (!I2cRegWrite(&ext->dev, EXT_MCP_23017_OLATA, buf, 2)) {
                 return false;
             }
             break;
+
+        default:
+            return false;
+    }
+
+    ext->dirty = false;
+    return true;
+}
+
+static bool PortSetup(Extender *ext)
+{
+    uint8_t buf[2];
+
+    if (ext->type != EXT_TYPE_MCP_23017) {
+        return PortWrite(ext);
+    }
+
+    if (ext->int_pin[0] != '\0') {
+        /* INTA and INTB mirrored, active low, interrupt on any input change */
+        buf[0] = EXT_MCP_23017_IOCON_MIRROR;
+        if (!I2cRegWrite(&ext->dev, EXT_MCP_23017_IOCON, buf, 1)) {
+            return false;
+        }
+
+        buf[0] = 0;
+        buf[1] = 0;
+        if (!I2cRegWrite(&ext->dev, EXT_MCP_23017_INTCONA, buf, 2)) {
+            return false;
+        }
+
+        buf[0] = ext->inputs & 0xFF;
+        buf[1] = ext->inputs >> 8;
+        if (!I2cRegWrite(&ext->dev, EXT_MCP_23017_GPINTENA, buf, 2)) {
+            return false;
+        }
+    }
+
+    buf[0] = ext->inputs & 0xFF;
+    buf[1] = ext->inputs >> 8;
+    if (!I2cRegWrite(&ext->dev, EXT_MCP_23017_IODIRA, buf, 2)) {
+        return false;
+    }
+
+    buf[0] = ext->pullups & 0xFF;
+    buf[1] = ext->pullups >> 8;
+    if (!I2cRegWrite(&ext->dev, EXT_MCP_23017_GPPUA, buf, 2)) {
+        return false;
+    }
+
+    return PortWrite(ext);
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+Extender *ExtenderNew(const char *name, ExtenderType type, unsigned bus, unsigned addr, unsigned base)
+{
+    Extender *ext = (Extender *)malloc(sizeof(Extender));
+
+    strncpy(ext->name, name, SHORT_STR_LEN);
+    ext->type = type;
+    ext->addr = addr;
+    ext->base = base;
+    ext->bus = bus;
+    ext->dev.fd = -1;
+    ext->dev.sim = false;
+    ext->online = false;
+    ext->in = 0;
+    ext->out = 0;
+    ext->inputs = 0;
+    ext->pullups = 0;
+    ext->dirty = false;
+    ext->int_pin[0] = '\0';
+    ext->pending = true;
+    ext->synced = 0;
+
+    return ext;    
+}
+
+bool ExtenderAdd(Extender *ext, char *err)
+{
+    bool direct = SimEnabled();
+
+    if (mtx_init(&ext->mtx, mtx_plain) != thrd_success) {
+        strncpy(err, "Failed to init extender mutex", ERROR_STR_LEN);
+        return false;
+    }
+
+    if (SimEnabled()) {
+        if (!SimDeviceAdd(SimTypeGet(ext), ext->bus, ext->addr, ext->base)) {
+            snprintf(err, ERROR_STR_LEN, "Failed to simulate I2C bus %u addr %u", ext->bus, ext->addr);
+            return false;
+        }
+    }
+#ifdef __arm__
+    else {
+        switch (ext->type) {
+            case EXT_TYPE_PCF_8574:
+                if (!pcf8574Setup(ext->bus, ext->addr, ext->base)) {
+                    return false;
+                }
+                break;
+
+            case EXT_TYPE_MCP_23017:
+                if (!mcp23017Setup(ext->bus, ext->addr, ext->base)) {
+                    return false;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        /* ADS1115 is driven over I2C directly for continuous sampling */
+        direct = true;
     }
 #endif
-    exts = g_list_append(exts, (void *)ext);
+
+    if (direct) {
+        if (!I2cOpen(&ext->dev, ext->bus, ext->addr)) {
+            snprintf(err, ERROR_STR_LEN, "Failed to open I2C bus %u addr %u", ext->bus, ext->addr);
+            return false;
+        }
+        ext->online = true;
+    }
+
+    Extenders.exts = g_list_append(Extenders.exts, (void *)ext);
     return true;
 }
+
+GList **ExtendersGet()
+{
+    return &Extenders.exts;
+}
+
+void ExtenderIntSet(Extender *ext, const char *pin)
+{
+    strncpy(ext->int_pin, pin, SHORT_STR_LEN);
+}
+
+void ExtenderIntRaise(Extender *ext)
+{
+    mtx_lock(&ext->mtx);
+    ext->pending = true;
+    mtx_unlock(&ext->mtx);
+}
+
+Extender *ExtenderPinGet(unsigned pin)
+{
+    for (GList *e = Extenders.exts; e != NULL; e = e->next) {
+        Extender *ext = (Extender *)e->data;
+        if (pin >= ext->base && pin < ext->base + PinsCount(ext)) {
+            return ext;
+        }
+    }
+    return NULL;
+}
+
+bool ExtenderPinModeSet(Extender *ext, unsigned pin, bool input, bool pullup)
+{
+    uint16_t    mask = 1 << (pin - ext->base);
+    bool        ret;
+
+    mtx_lock(&ext->mtx);
+
+    if (input) {
+        ext->inputs |= mask;
+    } else {
+        ext->inputs &= ~mask;
+        ext->out &= ~mask;
+    }
+
+    if (pullup) {
+        ext->pullups |= mask;
+    } else {
+        ext->pullups &= ~mask;
+    }
+
+    ret = PortSetup(ext);
+
+    mtx_unlock(&ext->mtx);
+    return ret;
+}
+
+bool ExtenderPinRead(Extender *ext, unsigned pin, bool *state)
+{
+    uint16_t    mask = 1 << (pin - ext->base);
+    bool        ret = true;
+
+    mtx_lock(&ext->mtx);
+
+    if (!(ext->inputs & mask)) {
+        *state = (ext->out & mask) ? true : false;
+    } else {
+        if (!Extenders.defer) {
+            ret = PortRead(ext);
+        }
+        *state = (ext->in & mask) ? true : false;
+    }
+
+    mtx_unlock(&ext->mtx);
+    return ret;
+}
+
+bool ExtenderPinReadA(Extender *ext, unsigned pin, int *value)
+{
+    uint16_t    config = EXT_ADS_1115_SINGLE | ((4 + pin - ext->base) << 12);
+    uint8_t     buf[2];
+    bool        ret = false;
+
+    if (ext->type != EXT_TYPE_ADS_1115) {
+        return false;
+    }
+
+    mtx_lock(&ext->mtx);
+
+    buf[0] = config >> 8;
+    buf[1] = config & 0xFF;
+    if (!I2cRegWrite(&ext->dev, EXT_ADS_1115_CONFIG, buf, 2)) {
+        mtx_unlock(&ext->mtx);
+        return false;
+    }
+
+    for (unsigned i = 0; i < EXT_ADS_1115_CONV_TRIES; i++) {
+        if (!I2cRegRead(&ext->dev, EXT_ADS_1115_CONFIG, buf, 2)) {
+            break;
+        }
+        if (buf[0] & (EXT_ADS_1115_OS >> 8)) {
+            ret = true;
+            break;
+        }
+        UtilsMsecSleep(EXT_ADS_1115_CONV_MSEC);
+    }
+
+    if (ret && I2cRegRead(&ext->dev, EXT_ADS_1115_CONV, buf, 2)) {
+        *value = (int16_t)((buf[0] << 8) | buf[1]);
+    } else {
+        ret = false;
+    }
+
+    mtx_unlock(&ext->mtx);
+    return ret;
+}
+
+bool ExtenderAdcStart(Extender *ext, unsigned pin)
+{
+    uint16_t    config = EXT_ADS_1115_CONTINUOUS | ((4 + pin - ext->base) << 12);
+    uint8_t     buf[2];
+
+    if (ext->type != EXT_TYPE_ADS_1115) {
+        return false;
+    }
+
+    buf[0] = config >> 8;
+    buf[1] = config & 0xFF;
+
+    mtx_lock(&ext->mtx);
+    bool ret = I2cRegWrite(&ext->dev, EXT_ADS_1115_CONFIG, buf, 2);
+    mtx_unlock(&ext->mtx);
+
+    return ret;
+}
+
+bool ExtenderAdcRead(Extender *ext, int *value)
+{
+    uint8_t buf[2];
+
+    if (ext->type != EXT_TYPE_ADS_1115) {
+        return false;
+    }
+
+    mtx_lock(&ext->mtx);
+    bool ret = I2cRegRead(&ext->dev, EXT_ADS_1115_CONV, buf, 2);
+    mtx_unlock(&ext->mtx);
+
+    if (ret) {
+        *value = (int16_t)((buf[0] << 8) | buf[1]);
+    }
+    return ret;
+}
+
+bool ExtenderPinWrite(Extender *ext, unsigned pin, bool state)
+{
+    uint16_t    mask = 1 << (pin - ext->base);
+    bool        ret = true;
+
+    mtx_lock(&ext->mtx);
+
+    if (state) {
+        ext->out |= mask;
+    } else {
+        ext->out &= ~mask;
+    }
+    ext->dirty = true;
+
+    if (!Extenders.defer) {
+        ret = PortWrite(ext);
+    }
+
+    mtx_unlock(&ext->mtx);
+    return ret;
+}
+
+bool ExtenderStreamWrite(Extender *ext, const uint8_t *buf, size_t len)
+{
+    if (ext->type != EXT_TYPE_PCF_8574) {
+        return false;
+    }
+
+    mtx_lock(&ext->mtx);
+    bool ret = I2cWrite(&ext->dev, buf, len);
+    mtx_unlock(&ext->mtx);
+
+    return ret;
+}
+
+void ExtendersDeferSet(bool defer)
+{
+    Extenders.defer = defer;
+}
+
+bool ExtendersRead()
+{
+    bool        ret = true;
+    uint64_t    now = UtilsMonoMsecGet();
+
+    for (GList *e = Extenders.exts; e != NULL; e = e->next) {
+        Extender *ext = (Extender *)e->data;
+
+        if (!ext->online || ext->inputs == 0) {
+            continue;
+        }
+
+        mtx_lock(&ext->mtx);
+
+        if (ext->int_pin[0] != '\0' && !ext->pending && (now - ext->synced) < EXT_INT_RESYNC_SEC * 1000) {
+            mtx_unlock(&ext->mtx);
+            continue;
+        }
+
+        if (PortRead(ext)) {
+            ext->pending = false;
+            ext->synced = now;
+        } else {
+            LogF(LOG_TYPE_ERROR, "EXT", "Failed to read Extender \"%s\" port", ext->name);
+            ret = false;
+        }
+
+        mtx_unlock(&ext->mtx);
+    }
+
+    return ret;
+}
+
+bool ExtendersWrite()
+{
+    bool ret = true;
+
+    for (GList *e = Extenders.exts; e != NULL; e = e->next) {
+        Extender *ext = (Extender *)e->data;
+
+        if (!ext->online || !ext->dirty) {
+            continue;
+        }
+
+        mtx_lock(&ext->mtx);
+        if (!PortWrite(ext)) {
+            LogF(LOG_TYPE_ERROR, "EXT", "Failed to write Extender \"%s\" port", ext->name);
+            ret = false;
+        }
+        mtx_unlock(&ext->mtx);
+    }
+
+    return ret;
+}
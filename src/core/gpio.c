@@ -9,6 +9,12 @@
 /*********************************************************************/
 
 #include <core/gpio.h>
+#include <core/sim.h>
+#include <core/sampler.h>
+#include <utils/registry.h>
+
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
 
 #ifdef __arm__
 #include <wiringPiLite/wiringPi.h>
@@ -20,7 +26,8 @@
 /*                                                                   */
 /*********************************************************************/
 
-static GList *pins = NULL;
+static GList     *pins = NULL;
+static Registry  pins_index = { 0 };
 
 /*********************************************************************/
 /*                                                                   */
@@ -37,12 +44,23 @@ GpioPin *GpioPinNew(const char *name, GpioType type, unsigned pin, GpioMode mode
     gpio->pin = pin;
     gpio->mode = mode;
     gpio->pull = pull;
+    gpio->id = 0;
+    gpio->filter = 0;
+    gpio->counter = false;
+    gpio->chip = 0;
+    gpio->line = GPIO_LINE_NONE;
+    gpio->fd = -1;
+    gpio->ext = NULL;
 
     return gpio;
 }
 
 bool GpioInit()
 {
+    if (SimEnabled()) {
+        return true;
+    }
+
 #ifdef __arm__
     if (wiringPiSetup() < 0) {
         return false;
@@ -51,8 +69,31 @@ bool GpioInit()
     return true;
 }
 
-bool GpioPinAdd(const GpioPin *pin, char *err)
+bool GpioPinAdd(GpioPin *pin, char *err)
 {
+    Extender *ext = ExtenderPinGet(pin->pin);
+
+    if (ext != NULL && ext->online) {
+        if (pin->type == GPIO_TYPE_DIGITAL &&
+            !ExtenderPinModeSet(ext, pin->pin, pin->mode == GPIO_MODE_INPUT, pin->pull == GPIO_PULL_UP)) {
+            snprintf(err, ERROR_STR_LEN, "Failed to setup Extender \"%s\" pin", ext->name);
+            return false;
+        }
+        pin->ext = ext;
+        pin->id = RegistryAdd(&pins_index, pin->name, pin);
+        pins = g_list_append(pins, (void *)pin);
+        return true;
+    }
+
+    if (SimEnabled()) {
+        if (pin->mode == GPIO_MODE_OUTPUT) {
+            SimPinWrite(pin->pin, false);
+        }
+        pin->id = RegistryAdd(&pins_index, pin->name, pin);
+        pins = g_list_append(pins, (void *)pin);
+        return true;
+    }
+
 #ifdef __arm__
     switch (pin->mode) {
         case GPIO_MODE_INPUT:
@@ -84,19 +125,40 @@ bool GpioPinAdd(const GpioPin *pin, char *err)
     }
 #endif
 
+    pin->id = RegistryAdd(&pins_index, pin->name, pin);
     pins = g_list_append(pins, (void *)pin);
     return true;
 }
 
+void GpioPinFilterSet(GpioPin *pin, unsigned msec)
+{
+    pin->filter = msec;
+}
+
+void GpioPinCounterSet(GpioPin *pin, bool counter)
+{
+    pin->counter = counter;
+}
+
+void GpioPinLineSet(GpioPin *pin, unsigned chip, int line)
+{
+    pin->chip = chip;
+    pin->line = line;
+}
+
 GpioPin *GpioPinGet(const char *name)
 {
-    for (GList *p = pins; p != NULL; p = p->next) {
-        GpioPin *pin = (GpioPin *)p->data;
-        if (!strcmp(pin->name, name)) {
-            return pin;
-        }
-    }
-    return NULL;
+    return (GpioPin *)RegistryGet(&pins_index, name);
+}
+
+bool GpioPinIdGet(const char *name, unsigned *id)
+{
+    return RegistryHandleGet(&pins_index, name, id);
+}
+
+GpioPin *GpioPinByIdGet(unsigned id)
+{
+    return (GpioPin *)RegistryAt(&pins_index, id);
 }
 
 GList **GpioPinsGet()
@@ -114,11 +176,26 @@ bool GpioPinRead(const GpioPin *pin, bool *state)
         return true;
     }
 
-#ifdef __arm__
-    if (!pinMode(pin->pin, INPUT)) {
-        return false;
+    if (pin->fd >= 0) {
+        struct gpiohandle_data data;
+
+        if (ioctl(pin->fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0) {
+            return false;
+        }
+
+        *state = (data.values[0] != 0) ? true : false;
+        return true;
+    }
+
+    if (pin->ext != NULL) {
+        return ExtenderPinRead(pin->ext, pin->pin, state);
     }
 
+    if (SimEnabled()) {
+        return SimPinRead(pin->pin, state);
+    }
+
+#ifdef __arm__
     ret = digitalRead(pin->pin, &val);
 
     *state = (val == HIGH) ? true : false;
@@ -137,6 +214,18 @@ int GpioPinReadA(const GpioPin *pin, int *value)
         return true;
     }
 
+    if (SamplerHas(pin)) {
+        return SamplerValueGet(pin, value);
+    }
+
+    if (pin->ext != NULL) {
+        return ExtenderPinReadA(pin->ext, pin->pin, value);
+    }
+
+    if (SimEnabled()) {
+        return SimPinReadA(pin->pin, value);
+    }
+
 #ifdef __arm__
     return analogRead(pin->pin, value);
 #endif
@@ -150,6 +239,15 @@ bool GpioPinWrite(const GpioPin *pin, bool state)
     if (pin->pin == 0) {
         return true;
     }
+
+    if (pin->ext != NULL) {
+        return ExtenderPinWrite(pin->ext, pin->pin, state);
+    }
+
+    if (SimEnabled()) {
+        return SimPinWrite(pin->pin, state);
+    }
+
 #ifdef __arm__
     if (!pinMode(pin->pin, OUTPUT)) {
         return false;
@@ -166,6 +264,11 @@ void GpioPinWriteA(const GpioPin *pin, int value)
     if (pin->pin == 0) {
         return;
     }
+
+    if (SimEnabled()) {
+        SimPinWriteA(pin->pin, value);
+        return;
+    }
 #ifdef __arm__
     analogWrite(pin->pin, value);
 #endif
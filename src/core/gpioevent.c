@@ -0,0 +1,473 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <core/gpioevent.h>
+#include <core/sim.h>
+#include <core/loop.h>
+#include <core/timer.h>
+#include <utils/log.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <threads.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+typedef struct {
+    GpioEdge            edge;
+    GpioEventHandler    handler;
+    void                *data;
+} GpioEventSub;
+
+typedef struct {
+    GpioPin     *pin;
+    bool        state;
+    bool        pending;
+    bool        fake;
+    uint64_t    ts;
+    uint64_t    deadline;
+    uint64_t    pulses;
+    GList       *subs;
+} GpioEventLine;
+
+typedef struct {
+    GpioPin     *pin;
+    bool        state;
+} GpioEventFake;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _GpioEvents {
+    int         epfd;
+    int         fake[2];
+    GList       *lines;
+    uint64_t    poll_next;
+    Timer       *timer;
+    mtx_t       mtx;
+    bool        ready;
+} GpioEvents = {
+    .epfd = -1,
+    .fake = { -1, -1 },
+    .lines = NULL,
+    .poll_next = 0,
+    .timer = NULL,
+    .ready = false
+};
+
+static once_flag events_once = ONCE_FLAG_INIT;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static void EventsInit()
+{
+    struct epoll_event ev = {
+        .events = EPOLLIN,
+        .data.ptr = NULL
+    };
+
+    if (mtx_init(&GpioEvents.mtx, mtx_plain | mtx_recursive) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "GPIO", "Failed to init GPIO events mutex");
+        return;
+    }
+
+    GpioEvents.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (GpioEvents.epfd < 0) {
+        Log(LOG_TYPE_ERROR, "GPIO", "Failed to create GPIO events poll");
+        return;
+    }
+
+    if (pipe(GpioEvents.fake) < 0) {
+        Log(LOG_TYPE_ERROR, "GPIO", "Failed to create GPIO fake events pipe");
+        return;
+    }
+    fcntl(GpioEvents.fake[0], F_SETFL, O_NONBLOCK);
+
+    if (epoll_ctl(GpioEvents.epfd, EPOLL_CTL_ADD, GpioEvents.fake[0], &ev) < 0) {
+        Log(LOG_TYPE_ERROR, "GPIO", "Failed to watch GPIO fake events pipe");
+        return;
+    }
+
+    GpioEvents.ready = true;
+}
+
+static GpioEventLine *LineFind(const GpioPin *pin)
+{
+    for (GList *l = GpioEvents.lines; l != NULL; l = l->next) {
+        GpioEventLine *line = (GpioEventLine *)l->data;
+        if (line->pin == pin) {
+            return line;
+        }
+    }
+    return NULL;
+}
+
+static bool LineRequest(GpioEventLine *line)
+{
+    char                    path[SHORT_STR_LEN];
+    struct gpioevent_request req;
+    struct epoll_event      ev;
+    GpioPin                 *pin = line->pin;
+
+    snprintf(path, SHORT_STR_LEN, "%s%u", GPIO_EVENT_CHIP_PATH, pin->chip);
+
+    int chip = open(path, O_RDONLY | O_CLOEXEC);
+    if (chip < 0) {
+        return false;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.lineoffset = (unsigned)pin->line;
+    req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+    strncpy(req.consumer_label, pin->name, sizeof(req.consumer_label) - 1);
+
+    if (ioctl(chip, GPIO_GET_LINEEVENT_IOCTL, &req) < 0) {
+        close(chip);
+        return false;
+    }
+    close(chip);
+
+    fcntl(req.fd, F_SETFL, fcntl(req.fd, F_GETFL) | O_NONBLOCK);
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = line;
+
+    if (epoll_ctl(GpioEvents.epfd, EPOLL_CTL_ADD, req.fd, &ev) < 0) {
+        close(req.fd);
+        return false;
+    }
+
+    pin->fd = req.fd;
+    return true;
+}
+
+static uint64_t SettleGet(const GpioPin *pin)
+{
+    unsigned msec = (pin->filter != 0) ? pin->filter : GPIO_EVENT_SETTLE_MSEC;
+    return msec * 1000000ULL;
+}
+
+static void LineDispatch(GpioEventLine *line)
+{
+    GpioEvent event = {
+        .pin = line->pin,
+        .state = line->state,
+        .ts = line->ts
+    };
+
+    for (GList *s = line->subs; s != NULL; s = s->next) {
+        GpioEventSub *sub = (GpioEventSub *)s->data;
+
+        if ((line->state && (sub->edge & GPIO_EDGE_RISING)) ||
+            (!line->state && (sub->edge & GPIO_EDGE_FALLING))) {
+            sub->handler(&event, sub->data);
+        }
+    }
+}
+
+static void LineEventsRead(GpioEventLine *line, uint64_t now)
+{
+    struct gpioevent_data   data[GPIO_EVENTS_MAX];
+    ssize_t                 len;
+
+    len = read(line->pin->fd, data, sizeof(data));
+    if (len < (ssize_t)sizeof(struct gpioevent_data)) {
+        return;
+    }
+
+    /* Counter takes every kernel edge, settling applies only to state */
+    if (line->pin->counter) {
+        for (size_t i = 0; i < (size_t)len / sizeof(struct gpioevent_data); i++) {
+            if (data[i].id == GPIOEVENT_EVENT_RISING_EDGE) {
+                line->pulses++;
+            }
+        }
+    }
+
+    if (!line->pending) {
+        line->pending = true;
+        line->ts = data[0].timestamp;
+    }
+    line->deadline = now + SettleGet(line->pin);
+}
+
+static void LineSample(GpioEventLine *line, uint64_t now)
+{
+    bool state;
+
+    if (!GpioPinRead(line->pin, &state)) {
+        return;
+    }
+
+    if (state != line->state && !line->pending) {
+        line->pending = true;
+        line->ts = now;
+        line->deadline = now + SettleGet(line->pin);
+    } else if (state == line->state && line->pending) {
+        line->pending = false;
+    }
+}
+
+static void LineSettle(GpioEventLine *line)
+{
+    bool state;
+
+    line->pending = false;
+
+    if (!GpioPinRead(line->pin, &state)) {
+        LogF(LOG_TYPE_ERROR, "GPIO", "Failed to read GPIO \"%s\"", line->pin->name);
+        return;
+    }
+
+    if (state != line->state) {
+        line->state = state;
+        LineDispatch(line);
+    }
+}
+
+static void FakeEventsRead(uint64_t now)
+{
+    GpioEventFake fake;
+
+    while (read(GpioEvents.fake[0], &fake, sizeof(fake)) == sizeof(fake)) {
+        GpioEventLine *line = LineFind(fake.pin);
+        if (line == NULL) {
+            continue;
+        }
+
+        line->fake = true;
+        line->pending = false;
+        line->state = fake.state;
+        line->ts = now;
+        LineDispatch(line);
+    }
+}
+
+static uint64_t DeadlineGet()
+{
+    uint64_t next = UINT64_MAX;
+
+    for (GList *l = GpioEvents.lines; l != NULL; l = l->next) {
+        GpioEventLine *line = (GpioEventLine *)l->data;
+
+        if (line->pin->fd < 0 && !line->fake && GpioEvents.poll_next < next) {
+            next = GpioEvents.poll_next;
+        }
+        if (line->pending && line->deadline < next) {
+            next = line->deadline;
+        }
+    }
+
+    return next;
+}
+
+static void EventsProcess()
+{
+    struct epoll_event  evs[GPIO_EVENTS_MAX];
+    uint64_t            now;
+
+    /* Ready lines are fetched without waiting, loop waits for poll fd */
+    int count = epoll_wait(GpioEvents.epfd, evs, GPIO_EVENTS_MAX, 0);
+    if (count < 0) {
+        if (errno != EINTR) {
+            Log(LOG_TYPE_ERROR, "GPIO", "Failed to wait GPIO events");
+        }
+        count = 0;
+    }
+
+    mtx_lock(&GpioEvents.mtx);
+    now = UtilsMonoNsecGet();
+
+    for (int i = 0; i < count; i++) {
+        if (evs[i].data.ptr == NULL) {
+            FakeEventsRead(now);
+        } else {
+            LineEventsRead((GpioEventLine *)evs[i].data.ptr, now);
+        }
+    }
+
+    bool poll = (now >= GpioEvents.poll_next);
+
+    for (GList *l = GpioEvents.lines; l != NULL; l = l->next) {
+        GpioEventLine *line = (GpioEventLine *)l->data;
+
+        if (poll && line->pin->fd < 0 && !line->fake) {
+            LineSample(line, now);
+        }
+        if (line->pending && !line->fake && line->deadline <= now) {
+            LineSettle(line);
+        }
+    }
+
+    if (poll) {
+        GpioEvents.poll_next = now + GPIO_EVENT_POLL_MSEC * 1000000ULL;
+    }
+
+    /* Settle deadlines and polling are served by timer */
+    uint64_t next = DeadlineGet();
+    if (next != UINT64_MAX) {
+        TimerAtSet(GpioEvents.timer, (next + 999999ULL) / 1000000ULL);
+    }
+
+    mtx_unlock(&GpioEvents.mtx);
+}
+
+static void EventsFdHandler(int fd, uint32_t events, void *data)
+{
+    EventsProcess();
+}
+
+static void EventsTimerHandler(void *data)
+{
+    EventsProcess();
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+bool GpioEventAdd(GpioPin *pin, GpioEdge edge, GpioEventHandler handler, void *data)
+{
+    call_once(&events_once, EventsInit);
+
+    if (!GpioEvents.ready) {
+        return false;
+    }
+
+    if (pin->pin == 0) {
+        return true;
+    }
+
+    mtx_lock(&GpioEvents.mtx);
+
+    GpioEventLine *line = LineFind(pin);
+    if (line == NULL) {
+        line = (GpioEventLine *)malloc(sizeof(GpioEventLine));
+
+        line->pin = pin;
+        line->pending = false;
+        line->fake = false;
+        line->ts = 0;
+        line->deadline = 0;
+        line->pulses = 0;
+        line->subs = NULL;
+
+        if (pin->line != GPIO_LINE_NONE && pin->fd < 0 && !SimEnabled()) {
+            if (LineRequest(line)) {
+                LogF(LOG_TYPE_INFO, "GPIO", "GPIO \"%s\" watched by gpiochip%u line %d events",
+                    pin->name, pin->chip, pin->line);
+            } else {
+                LogF(LOG_TYPE_ERROR, "GPIO", "Failed to request gpiochip%u line %d for GPIO \"%s\", fallback to polling",
+                    pin->chip, pin->line, pin->name);
+            }
+        }
+
+        if (!GpioPinRead(pin, &line->state)) {
+            line->state = false;
+        }
+
+        GpioEvents.lines = g_list_append(GpioEvents.lines, (void *)line);
+    }
+
+    GpioEventSub *sub = (GpioEventSub *)malloc(sizeof(GpioEventSub));
+
+    sub->edge = edge;
+    sub->handler = handler;
+    sub->data = data;
+
+    line->subs = g_list_append(line->subs, (void *)sub);
+
+    /* New polled line is sampled without waiting for other deadlines */
+    if (GpioEvents.timer != NULL) {
+        TimerTrigger(GpioEvents.timer);
+    }
+
+    mtx_unlock(&GpioEvents.mtx);
+    return true;
+}
+
+bool GpioEventPulsesGet(const GpioPin *pin, uint64_t *pulses)
+{
+    call_once(&events_once, EventsInit);
+
+    if (!GpioEvents.ready) {
+        return false;
+    }
+
+    mtx_lock(&GpioEvents.mtx);
+
+    GpioEventLine *line = LineFind(pin);
+    if (line == NULL || line->pin->fd < 0) {
+        mtx_unlock(&GpioEvents.mtx);
+        return false;
+    }
+    *pulses = line->pulses;
+
+    mtx_unlock(&GpioEvents.mtx);
+    return true;
+}
+
+bool GpioEventInject(GpioPin *pin, bool state)
+{
+    GpioEventFake fake = {
+        .pin = pin,
+        .state = state
+    };
+
+    call_once(&events_once, EventsInit);
+
+    if (!GpioEvents.ready) {
+        return false;
+    }
+
+    return write(GpioEvents.fake[1], &fake, sizeof(fake)) == sizeof(fake);
+}
+
+bool GpioEventStart()
+{
+    call_once(&events_once, EventsInit);
+
+    if (!GpioEvents.ready) {
+        return false;
+    }
+
+    Log(LOG_TYPE_INFO, "GPIO", "Starting GPIO events");
+
+    mtx_lock(&GpioEvents.mtx);
+    GpioEvents.timer = TimerNew(EventsTimerHandler, NULL);
+    mtx_unlock(&GpioEvents.mtx);
+
+    if (!TimerTrigger(GpioEvents.timer)) {
+        return false;
+    }
+
+    /* Lines poll fd gets readable when any line has events */
+    return LoopFdAdd(GpioEvents.epfd, EPOLLIN, EventsFdHandler, NULL);
+}
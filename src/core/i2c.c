@@ -0,0 +1,111 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <core/i2c.h>
+#include <core/sim.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+bool I2cOpen(I2cDevice *dev, unsigned bus, unsigned addr)
+{
+    char path[32];
+
+    dev->bus = bus;
+    dev->addr = addr;
+    dev->sim = SimEnabled();
+
+    if (dev->sim) {
+        dev->fd = -1;
+        return SimDeviceFound(bus, addr);
+    }
+
+    snprintf(path, sizeof(path), "%s%u", I2C_DEV_PATH, bus);
+
+    dev->fd = open(path, O_RDWR | O_CLOEXEC);
+    if (dev->fd < 0) {
+        return false;
+    }
+
+    if (ioctl(dev->fd, I2C_SLAVE, addr) < 0) {
+        close(dev->fd);
+        dev->fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+void I2cClose(I2cDevice *dev)
+{
+    if (dev->fd >= 0) {
+        close(dev->fd);
+        dev->fd = -1;
+    }
+}
+
+bool I2cWrite(I2cDevice *dev, const uint8_t *buf, size_t len)
+{
+    if (dev->sim) {
+        return SimI2cTransfer(dev->bus, dev->addr, buf, len, NULL, 0);
+    }
+    return write(dev->fd, buf, len) == (ssize_t)len;
+}
+
+bool I2cRead(I2cDevice *dev, uint8_t *buf, size_t len)
+{
+    if (dev->sim) {
+        return SimI2cTransfer(dev->bus, dev->addr, NULL, 0, buf, len);
+    }
+    return read(dev->fd, buf, len) == (ssize_t)len;
+}
+
+bool I2cRegWrite(I2cDevice *dev, uint8_t reg, const uint8_t *buf, size_t len)
+{
+    uint8_t data[I2C_BUF_MAX + 1];
+
+    if (len > I2C_BUF_MAX) {
+        return false;
+    }
+
+    data[0] = reg;
+    memcpy(&data[1], buf, len);
+
+    return I2cWrite(dev, data, len + 1);
+}
+
+bool I2cRegRead(I2cDevice *dev, uint8_t reg, uint8_t *buf, size_t len)
+{
+    struct i2c_msg msgs[2] = {
+        { .addr = dev->addr, .flags = 0, .len = 1, .buf = &reg },
+        { .addr = dev->addr, .flags = I2C_M_RD, .len = len, .buf = buf }
+    };
+    struct i2c_rdwr_ioctl_data data = {
+        .msgs = msgs,
+        .nmsgs = 2
+    };
+
+    if (dev->sim) {
+        return SimI2cTransfer(dev->bus, dev->addr, &reg, 1, buf, len);
+    }
+
+    return ioctl(dev->fd, I2C_RDWR, &data) >= 0;
+}
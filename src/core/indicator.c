@@ -0,0 +1,321 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <threads.h>
+
+#include <core/indicator.h>
+#include <core/timer.h>
+#include <utils/log.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+typedef struct {
+    bool                used;
+    IndicatorPattern    pattern;
+} IndicatorSlot;
+
+typedef struct {
+    GpioPin         *pin;
+    IndicatorSlot   slots[INDICATOR_PRIO_MAX];
+    int             active;
+    bool            restart;
+    unsigned        step;
+    unsigned        loops;
+    uint64_t        deadline;
+    bool            level;
+    bool            out;
+    bool            written;
+} IndicatorChannel;
+
+typedef struct {
+    GpioPin     *pin;
+    bool        state;
+} IndicatorWrite;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _Indicators {
+    GList           *channels;
+    unsigned        count;
+    IndicatorWrite  *writes;
+    unsigned        size;
+    Timer           *timer;
+    mtx_t           mtx;
+} Indicators = {
+    .channels = NULL,
+    .count = 0,
+    .writes = NULL,
+    .size = 0,
+    .timer = NULL
+};
+
+static once_flag indicators_once = ONCE_FLAG_INIT;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static void IndicatorsInit()
+{
+    if (mtx_init(&Indicators.mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "INDICATOR", "Failed to init indicators mutex");
+    }
+}
+
+static IndicatorChannel *ChannelGet(GpioPin *pin)
+{
+    for (GList *c = Indicators.channels; c != NULL; c = c->next) {
+        IndicatorChannel *ch = (IndicatorChannel *)c->data;
+        if (ch->pin == pin) {
+            return ch;
+        }
+    }
+
+    IndicatorChannel *ch = (IndicatorChannel *)calloc(1, sizeof(IndicatorChannel));
+    if (ch == NULL) {
+        return NULL;
+    }
+
+    ch->pin = pin;
+    ch->active = -1;
+    ch->deadline = UINT64_MAX;
+
+    Indicators.channels = g_list_append(Indicators.channels, (void *)ch);
+    Indicators.count++;
+
+    return ch;
+}
+
+static int ChannelTop(const IndicatorChannel *ch)
+{
+    for (int prio = INDICATOR_PRIO_MAX - 1; prio >= 0; prio--) {
+        if (ch->slots[prio].used) {
+            return prio;
+        }
+    }
+    return -1;
+}
+
+static bool PatternEqual(const IndicatorPattern *a, const IndicatorPattern *b)
+{
+    if (a->count != b->count || a->repeat != b->repeat) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < a->count; i++) {
+        if (a->steps[i].state != b->steps[i].state || a->steps[i].msec != b->steps[i].msec) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint64_t StepDeadline(uint64_t from, const IndicatorStep *step)
+{
+    if (step->msec == INDICATOR_HOLD) {
+        return UINT64_MAX;
+    }
+    return from + step->msec;
+}
+
+static uint64_t ChannelUpdate(IndicatorChannel *ch, uint64_t now)
+{
+    for (;;) {
+        int top = ChannelTop(ch);
+
+        if (top != ch->active || ch->restart) {
+            ch->active = top;
+            ch->restart = false;
+
+            if (top < 0) {
+                ch->level = false;
+                ch->deadline = UINT64_MAX;
+                return UINT64_MAX;
+            }
+
+            const IndicatorStep *first = &ch->slots[top].pattern.steps[0];
+
+            ch->step = 0;
+            ch->loops = 0;
+            ch->level = first->state;
+            ch->deadline = StepDeadline(now, first);
+        }
+
+        if (top < 0 || ch->deadline > now) {
+            return ch->deadline;
+        }
+
+        /* Next step is timed from previous deadline, so periods do not drift */
+        const IndicatorPattern *pattern = &ch->slots[top].pattern;
+
+        if (++ch->step >= pattern->count) {
+            ch->step = 0;
+            ch->loops++;
+
+            if (pattern->repeat != 0 && ch->loops >= pattern->repeat) {
+                ch->slots[top].used = false;
+                continue;
+            }
+        }
+
+        ch->level = pattern->steps[ch->step].state;
+        ch->deadline = StepDeadline(ch->deadline, &pattern->steps[ch->step]);
+    }
+}
+
+static void SequencerTimerHandler(void *data)
+{
+    uint64_t    now = UtilsMonoMsecGet();
+    uint64_t    next = UINT64_MAX;
+    unsigned    count = 0;
+
+    mtx_lock(&Indicators.mtx);
+
+    if (Indicators.size < Indicators.count) {
+        IndicatorWrite *buf = (IndicatorWrite *)realloc(Indicators.writes, Indicators.count * sizeof(IndicatorWrite));
+        if (buf != NULL) {
+            Indicators.writes = buf;
+            Indicators.size = Indicators.count;
+        }
+    }
+
+    for (GList *c = Indicators.channels; c != NULL; c = c->next) {
+        IndicatorChannel *ch = (IndicatorChannel *)c->data;
+
+        uint64_t deadline = ChannelUpdate(ch, now);
+        if (deadline < next) {
+            next = deadline;
+        }
+
+        if ((!ch->written || ch->out != ch->level) && count < Indicators.size) {
+            ch->out = ch->level;
+            ch->written = true;
+
+            Indicators.writes[count].pin = ch->pin;
+            Indicators.writes[count].state = ch->level;
+            count++;
+        }
+    }
+
+    if (next != UINT64_MAX) {
+        TimerAtSet(Indicators.timer, next);
+    }
+
+    mtx_unlock(&Indicators.mtx);
+
+    /* Timer handler is never run concurrently, so writes buffer is not shared */
+    for (unsigned i = 0; i < count; i++) {
+        if (!GpioPinWrite(Indicators.writes[i].pin, Indicators.writes[i].state)) {
+            LogF(LOG_TYPE_ERROR, "INDICATOR", "Failed to write indicator GPIO \"%s\"", Indicators.writes[i].pin->name);
+        }
+    }
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+bool IndicatorPlay(GpioPin *pin, const IndicatorPattern *pattern, IndicatorPrio prio)
+{
+    if (pin == NULL || prio >= INDICATOR_PRIO_MAX || pattern->count == 0 || pattern->count > INDICATOR_STEPS_MAX) {
+        return false;
+    }
+
+    call_once(&indicators_once, IndicatorsInit);
+
+    mtx_lock(&Indicators.mtx);
+
+    IndicatorChannel *ch = ChannelGet(pin);
+    if (ch == NULL) {
+        mtx_unlock(&Indicators.mtx);
+        return false;
+    }
+
+    IndicatorSlot *slot = &ch->slots[prio];
+
+    if (!slot->used || !PatternEqual(&slot->pattern, pattern)) {
+        memcpy(&slot->pattern, pattern, sizeof(IndicatorPattern));
+        slot->used = true;
+
+        if (ch->active == (int)prio) {
+            ch->restart = true;
+        }
+        TimerTrigger(Indicators.timer);
+    }
+
+    mtx_unlock(&Indicators.mtx);
+    return true;
+}
+
+bool IndicatorStop(GpioPin *pin, IndicatorPrio prio)
+{
+    if (pin == NULL || prio >= INDICATOR_PRIO_MAX) {
+        return false;
+    }
+
+    call_once(&indicators_once, IndicatorsInit);
+
+    mtx_lock(&Indicators.mtx);
+
+    IndicatorChannel *ch = ChannelGet(pin);
+    if (ch == NULL) {
+        mtx_unlock(&Indicators.mtx);
+        return false;
+    }
+
+    if (ch->slots[prio].used) {
+        ch->slots[prio].used = false;
+        TimerTrigger(Indicators.timer);
+    }
+
+    mtx_unlock(&Indicators.mtx);
+    return true;
+}
+
+bool IndicatorSet(GpioPin *pin, bool state)
+{
+    IndicatorPattern pattern = {
+        .count = 1,
+        .repeat = 0,
+        .steps = {
+            { state, INDICATOR_HOLD }
+        }
+    };
+
+    return IndicatorPlay(pin, &pattern, INDICATOR_PRIO_STATUS);
+}
+
+bool IndicatorStart()
+{
+    call_once(&indicators_once, IndicatorsInit);
+
+    Log(LOG_TYPE_INFO, "INDICATOR", "Starting indicators sequencer");
+
+    mtx_lock(&Indicators.mtx);
+    Indicators.timer = TimerNew(SequencerTimerHandler, NULL);
+    mtx_unlock(&Indicators.mtx);
+
+    return TimerTrigger(Indicators.timer);
+}
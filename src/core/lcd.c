@@ -13,6 +13,8 @@
 #include <glib-2.0/glib.h>
 
 #include <core/lcd.h>
+#include <core/sim.h>
+#include <utils/registry.h>
 
 #ifdef __arm__
 #include <wiringPiLite/wiringPi.h>
@@ -26,7 +28,194 @@
 /*********************************************************************/
 
 static GList    *lcds = NULL;
-static int      lcd_fd = 0;
+static Registry lcds_index = { 0 };
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static uint8_t PinMask(const LCD *lcd, unsigned pin)
+{
+    return 1 << (pin - lcd->ext->base);
+}
+
+static bool TransportOwns(const LCD *lcd, const Extender *ext)
+{
+    unsigned pins[] = { lcd->rs, lcd->rw, lcd->e, lcd->k, lcd->d4, lcd->d5, lcd->d6, lcd->d7 };
+
+    for (unsigned i = 0; i < sizeof(pins) / sizeof(pins[0]); i++) {
+        if (pins[i] < ext->base || pins[i] >= ext->base + EXT_PCF_8574_PINS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void TransportNibble(LCD *lcd, uint8_t nibble, bool data)
+{
+    unsigned    d[] = { lcd->d4, lcd->d5, lcd->d6, lcd->d7 };
+    uint8_t     port = PinMask(lcd, lcd->k);
+
+    if (data) {
+        port |= PinMask(lcd, lcd->rs);
+    }
+
+    for (unsigned i = 0; i < 4; i++) {
+        if (nibble & (1 << i)) {
+            port |= PinMask(lcd, d[i]);
+        }
+    }
+
+    /* Nibble is latched by display on falling edge of E */
+    lcd->tx[lcd->tx_len++] = port | PinMask(lcd, lcd->e);
+    lcd->tx[lcd->tx_len++] = port;
+}
+
+static bool TransportCommit(LCD *lcd)
+{
+    bool ret = true;
+
+    if (lcd->tx_len == 0) {
+        return true;
+    }
+
+    if (!ExtenderStreamWrite(lcd->ext, lcd->tx, lcd->tx_len)) {
+        ret = false;
+    }
+
+    lcd->writes++;
+    lcd->tx_len = 0;
+
+    return ret;
+}
+
+static bool TransportByte(LCD *lcd, uint8_t byte, bool data)
+{
+    bool ret = true;
+
+    if (lcd->tx_len + 4 > LCD_TX_MAX) {
+        ret = TransportCommit(lcd);
+    }
+
+    TransportNibble(lcd, byte >> 4, data);
+    TransportNibble(lcd, byte & 0x0F, data);
+
+    return ret;
+}
+
+static bool TransportInit(LCD *lcd)
+{
+    uint8_t cmds[] = { LCD_CMD_FUNCTION, LCD_CMD_DISPLAY, LCD_CMD_ENTRY, LCD_CMD_CLEAR };
+
+    lcd->tx_len = 0;
+
+    /* Reset by instruction into 8 bit mode, then switch to 4 bit */
+    UtilsMsecSleep(50);
+    for (unsigned i = 0; i < 3; i++) {
+        TransportNibble(lcd, 0x03, false);
+        if (!TransportCommit(lcd)) {
+            return false;
+        }
+        UtilsMsecSleep(5);
+    }
+
+    TransportNibble(lcd, 0x02, false);
+    if (!TransportCommit(lcd)) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++) {
+        TransportByte(lcd, cmds[i], false);
+        if (!TransportCommit(lcd)) {
+            return false;
+        }
+        UtilsMsecSleep(2);
+    }
+
+    return true;
+}
+
+static bool HwInit(LCD *lcd)
+{
+    Extender *ext = ExtenderPinGet(lcd->rs);
+
+    if (ext != NULL && ext->online && ext->type == EXT_TYPE_PCF_8574 && TransportOwns(lcd, ext)) {
+        lcd->ext = ext;
+        return TransportInit(lcd);
+    }
+
+    if (SimEnabled()) {
+        return true;
+    }
+
+#ifdef __arm__
+    pinMode(lcd->rw, OUTPUT);
+    digitalWrite(lcd->rw, LOW);
+    pinMode(lcd->k, OUTPUT);
+    digitalWrite(lcd->k, HIGH);
+
+    for (int i = 0; i < LCD_INIT_RETRIES; i++)
+    {
+        lcd->fd = lcdInit(LCD_ROWS, LCD_COLS, LCD_BITS, lcd->rs, lcd->e, lcd->d4, lcd->d5, lcd->d6, lcd->d7, 0, 0, 0, 0);
+        if (lcd->fd != 0)
+            break;
+        delay(100);
+    }
+
+    if (lcd->fd == 0) {
+        return false;
+    }
+
+    lcdClear(lcd->fd);
+#endif
+    return true;
+}
+
+static void HwPosSet(LCD *lcd, unsigned row, unsigned col)
+{
+    if (lcd->ext != NULL) {
+        TransportByte(lcd, LCD_CMD_DDRAM | (row * LCD_ROW_ADDR + col), false);
+    } else if (!SimEnabled()) {
+#ifdef __arm__
+        lcdPosition(lcd->fd, col, row);
+#endif
+    }
+
+    lcd->hw_row = row;
+    lcd->hw_col = col;
+}
+
+static void HwWrite(LCD *lcd, const char *text, unsigned len)
+{
+    if (lcd->ext != NULL) {
+        for (unsigned i = 0; i < len; i++) {
+            TransportByte(lcd, (uint8_t)text[i], true);
+        }
+    } else if (!SimEnabled()) {
+#ifdef __arm__
+        for (unsigned i = 0; i < len; i++) {
+            lcdPutchar(lcd->fd, text[i]);
+        }
+#endif
+    }
+
+    lcd->hw_col += len;
+}
+
+static bool HwCommit(LCD *lcd)
+{
+    if (lcd->ext != NULL) {
+        return TransportCommit(lcd);
+    }
+    return true;
+}
+
+static bool CellChanged(const LCD *lcd, unsigned row, unsigned col)
+{
+    return lcd->frame[row][col] != lcd->shadow[row][col];
+}
 
 /*********************************************************************/
 /*                                                                   */
@@ -47,6 +236,17 @@ LCD *LcdNew(const char *name, unsigned rs, unsigned rw, unsigned e, unsigned k,
     lcd->d5 = d5;
     lcd->d6 = d6;
     lcd->d7 = d7;
+    lcd->fd = 0;
+    lcd->row = 0;
+    lcd->col = 0;
+    lcd->hw_row = 0;
+    lcd->hw_col = 0;
+    lcd->ext = NULL;
+    lcd->tx_len = 0;
+    lcd->writes = 0;
+
+    memset(lcd->frame, ' ', sizeof(lcd->frame));
+    memset(lcd->shadow, ' ', sizeof(lcd->shadow));
 
     return lcd;
 }
@@ -58,64 +258,139 @@ GList **LcdsGet()
 
 LCD *LcdGet(const char *name)
 {
-    for (GList *l = lcds; l != NULL; l = l->next) {
-        LCD *lcd = (LCD *)l->data;
-        if (!strcmp(lcd->name, name)) {
-            return lcd;
-        }
-    }
-    return NULL;
+    return (LCD *)RegistryGet(&lcds_index, name);
 }
 
-bool LcdAdd(const LCD *lcd)
+bool LcdAdd(LCD *lcd)
 {
-#ifdef __arm__
-    pinMode(lcd->rw, OUTPUT);
-    digitalWrite(lcd->rw, LOW);
-    pinMode(lcd->k, OUTPUT);
-    digitalWrite(lcd->k, HIGH);
-
-    for (int i = 0; i < LCD_INIT_RETRIES; i++)
-    {
-        lcd_fd = lcdInit(LCD_ROWS, LCD_COLS, LCD_BITS, lcd->rs, lcd->e, lcd->d4, lcd->d5, lcd->d6, lcd->d7, 0, 0, 0, 0);
-        if (lcd_fd != 0)
-            break;
-        delay(100);
+    if (mtx_init(&lcd->mtx, mtx_plain | mtx_recursive) != thrd_success) {
+        return false;
     }
 
-    if (lcd_fd == 0) {
+    /* Display is cleared by init, so shadow matches blank glass */
+    if (!HwInit(lcd)) {
         return false;
     }
 
-    lcdClear(lcd_fd);
-    lcdPosition(lcd_fd, 0, 0);
-    lcdPuts(lcd_fd, LCD_DEFAULT_TEXT_UP);
-    lcdPosition(lcd_fd, 0, 1);
-    lcdPuts(lcd_fd, LCD_DEFAULT_TEXT_DOWN);
-#endif
+    LcdPosSet(lcd, 0, 0);
+    LcdPrint(lcd, LCD_DEFAULT_TEXT_UP);
+    LcdPosSet(lcd, 1, 0);
+    LcdPrint(lcd, LCD_DEFAULT_TEXT_DOWN);
+    LcdFlush(lcd);
 
+    RegistryAdd(&lcds_index, lcd->name, (void *)lcd);
     lcds = g_list_append(lcds, (void *)lcd);
 
     return true;
 }
 
-void LcdPrint(const LCD *lcd, char *text)
+void LcdPrint(LCD *lcd, const char *text)
 {
-#ifdef __arm__
-    lcdPuts(lcd_fd, text);
-#endif
+    mtx_lock(&lcd->mtx);
+
+    for (const char *c = text; *c != '\0' && lcd->col < LCD_COLS; c++) {
+        lcd->frame[lcd->row][lcd->col++] = *c;
+    }
+
+    mtx_unlock(&lcd->mtx);
 }
 
-void LcdPosSet(const LCD *lcd, unsigned row, unsigned col)
+void LcdPosSet(LCD *lcd, unsigned row, unsigned col)
 {
-#ifdef __arm__
-    lcdPosition(lcd_fd, col, row);
-#endif
+    mtx_lock(&lcd->mtx);
+
+    lcd->row = (row < LCD_ROWS) ? row : LCD_ROWS - 1;
+    lcd->col = (col < LCD_COLS) ? col : LCD_COLS;
+
+    mtx_unlock(&lcd->mtx);
 }
 
-void LcdClear(const LCD *lcd)
+void LcdClear(LCD *lcd)
 {
-#ifdef __arm__
-    lcdClear(lcd_fd);
-#endif
+    mtx_lock(&lcd->mtx);
+
+    memset(lcd->frame, ' ', sizeof(lcd->frame));
+    lcd->row = 0;
+    lcd->col = 0;
+
+    mtx_unlock(&lcd->mtx);
+}
+
+bool LcdFlush(LCD *lcd)
+{
+    bool ret;
+
+    mtx_lock(&lcd->mtx);
+
+    for (unsigned row = 0; row < LCD_ROWS; row++) {
+        unsigned col = 0;
+
+        while (col < LCD_COLS) {
+            if (!CellChanged(lcd, row, col)) {
+                col++;
+                continue;
+            }
+
+            /* Rewriting one unchanged cell costs the same as cursor move */
+            unsigned end = col + 1;
+            while (end < LCD_COLS) {
+                if (CellChanged(lcd, row, end)) {
+                    end++;
+                } else if (end + 1 < LCD_COLS && CellChanged(lcd, row, end + 1)) {
+                    end += 2;
+                } else {
+                    break;
+                }
+            }
+
+            if (lcd->hw_row != row || lcd->hw_col != col) {
+                HwPosSet(lcd, row, col);
+            }
+            HwWrite(lcd, &lcd->frame[row][col], end - col);
+
+            memcpy(&lcd->shadow[row][col], &lcd->frame[row][col], end - col);
+            col = end;
+        }
+    }
+
+    /* Whole frame with cursor moves fits LCD_TX_MAX, so it is one write */
+    ret = HwCommit(lcd);
+    if (!ret) {
+        /* Glass state is unknown, redraw everything next time */
+        memset(lcd->shadow, 0, sizeof(lcd->shadow));
+        lcd->hw_row = LCD_ROWS;
+    }
+
+    mtx_unlock(&lcd->mtx);
+    return ret;
+}
+
+bool LcdBenchmark(LCD *lcd, unsigned *cps, unsigned *writes)
+{
+    const char  *patterns[] = { "0123456789ABCDEF", "FEDCBA9876543210" };
+    bool        ret = true;
+
+    mtx_lock(&lcd->mtx);
+
+    unsigned    start_writes = lcd->writes;
+    uint64_t    start = UtilsMonoNsecGet();
+
+    /* Patterns differ in every cell, so each frame is full redraw */
+    for (unsigned f = 0; f < LCD_BENCH_FRAMES && ret; f++) {
+        for (unsigned row = 0; row < LCD_ROWS; row++) {
+            LcdPosSet(lcd, row, 0);
+            LcdPrint(lcd, patterns[(f + row) % 2]);
+        }
+        ret = LcdFlush(lcd);
+    }
+
+    uint64_t elapsed = UtilsMonoNsecGet() - start;
+
+    *writes = (lcd->writes - start_writes) / LCD_BENCH_FRAMES;
+    *cps = (elapsed != 0) ? (unsigned)(LCD_BENCH_FRAMES * LCD_ROWS * LCD_COLS * 1000000000ULL / elapsed) : 0;
+
+    LcdClear(lcd);
+
+    mtx_unlock(&lcd->mtx);
+    return ret;
 }
@@ -0,0 +1,272 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <threads.h>
+#include <sys/epoll.h>
+
+#include <core/loop.h>
+#include <utils/utils.h>
+#include <utils/log.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+typedef struct {
+    int             fd;
+    LoopFdHandler   handler;
+    void            *data;
+} LoopWatch;
+
+typedef struct {
+    LoopHandler     handler;
+    void            *data;
+} LoopWork;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _Loop {
+    int         epfd;
+    LoopWork    queue[LOOP_QUEUE_LEN];
+    unsigned    head;
+    unsigned    count;
+    bool        full;
+    uint64_t    dropped;
+    LoopStats   stats;
+    mtx_t       mtx;
+    cnd_t       work;
+} Loop = {
+    .epfd = -1,
+    .head = 0,
+    .count = 0,
+    .full = false,
+    .dropped = 0
+};
+
+static once_flag loop_once = ONCE_FLAG_INIT;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static void LoopInit()
+{
+    if (mtx_init(&Loop.mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "LOOP", "Failed to init loop mutex");
+    }
+    if (cnd_init(&Loop.work) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "LOOP", "Failed to init loop condition");
+    }
+
+    Loop.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (Loop.epfd < 0) {
+        Log(LOG_TYPE_ERROR, "LOOP", "Failed to create loop poll");
+    }
+}
+
+static int LoopThread(void *data)
+{
+    struct epoll_event evs[LOOP_EVENTS_MAX];
+
+    for (;;) {
+        int count = epoll_wait(Loop.epfd, evs, LOOP_EVENTS_MAX, -1);
+
+        if (count < 0) {
+            if (errno != EINTR) {
+                Log(LOG_TYPE_ERROR, "LOOP", "Failed to wait loop events");
+                UtilsMsecSleep(100);
+            }
+            continue;
+        }
+
+        for (int i = 0; i < count; i++) {
+            LoopWatch *watch = (LoopWatch *)evs[i].data.ptr;
+            watch->handler(watch->fd, evs[i].events, watch->data);
+        }
+    }
+    return 0;
+}
+
+static int WorkerThread(void *data)
+{
+    mtx_lock(&Loop.mtx);
+
+    for (;;) {
+        while (Loop.count == 0) {
+            cnd_wait(&Loop.work, &Loop.mtx);
+        }
+
+        LoopWork work = Loop.queue[Loop.head];
+
+        Loop.head = (Loop.head + 1) % LOOP_QUEUE_LEN;
+        Loop.count--;
+        Loop.stats.depth = Loop.count;
+
+        mtx_unlock(&Loop.mtx);
+        work.handler(work.data);
+        mtx_lock(&Loop.mtx);
+    }
+
+    mtx_unlock(&Loop.mtx);
+    return 0;
+}
+
+static bool StackSizeSet()
+{
+    pthread_attr_t  attr;
+    bool            ret = false;
+
+    if (pthread_attr_init(&attr) != 0) {
+        return false;
+    }
+
+    /* C11 threads are created with default attributes */
+    if (pthread_attr_setstacksize(&attr, LOOP_STACK_SIZE) == 0 && pthread_setattr_default_np(&attr) == 0) {
+        ret = true;
+    }
+
+    pthread_attr_destroy(&attr);
+    return ret;
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+bool LoopFdAdd(int fd, uint32_t events, LoopFdHandler handler, void *data)
+{
+    call_once(&loop_once, LoopInit);
+
+    if (Loop.epfd < 0) {
+        return false;
+    }
+
+    LoopWatch *watch = (LoopWatch *)malloc(sizeof(LoopWatch));
+    if (watch == NULL) {
+        return false;
+    }
+
+    watch->fd = fd;
+    watch->handler = handler;
+    watch->data = data;
+
+    struct epoll_event ev = {
+        .events = events,
+        .data.ptr = watch
+    };
+
+    if (epoll_ctl(Loop.epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        free(watch);
+        return false;
+    }
+
+    return true;
+}
+
+bool LoopWorkAdd(LoopHandler handler, void *data)
+{
+    call_once(&loop_once, LoopInit);
+
+    mtx_lock(&Loop.mtx);
+
+    if (Loop.count == LOOP_QUEUE_LEN) {
+        if (!Loop.full) {
+            Loop.full = true;
+            Loop.dropped = Loop.stats.dropped;
+            Log(LOG_TYPE_ERROR, "LOOP", "Worker queue is full, work dropped");
+        }
+        Loop.stats.dropped++;
+        mtx_unlock(&Loop.mtx);
+        return false;
+    }
+
+    if (Loop.full) {
+        Loop.full = false;
+        LogF(LOG_TYPE_ERROR, "LOOP", "Worker queue recovered, %llu work items dropped",
+            (unsigned long long)(Loop.stats.dropped - Loop.dropped));
+    }
+
+    Loop.queue[(Loop.head + Loop.count) % LOOP_QUEUE_LEN] = (LoopWork) {
+        .handler = handler,
+        .data = data
+    };
+    Loop.count++;
+
+    Loop.stats.queued++;
+    Loop.stats.depth = Loop.count;
+    if (Loop.count > Loop.stats.depth_max) {
+        Loop.stats.depth_max = Loop.count;
+    }
+
+    cnd_signal(&Loop.work);
+    mtx_unlock(&Loop.mtx);
+
+    return true;
+}
+
+void LoopStatsGet(LoopStats *stats)
+{
+    call_once(&loop_once, LoopInit);
+
+    mtx_lock(&Loop.mtx);
+    memcpy(stats, &Loop.stats, sizeof(LoopStats));
+    mtx_unlock(&Loop.mtx);
+}
+
+bool LoopStart()
+{
+    thrd_t  th;
+
+    call_once(&loop_once, LoopInit);
+
+    if (Loop.epfd < 0) {
+        return false;
+    }
+
+    if (!StackSizeSet()) {
+        Log(LOG_TYPE_ERROR, "LOOP", "Failed to set threads stack size");
+    }
+
+    LogF(LOG_TYPE_INFO, "LOOP", "Starting event loop with %u workers", LOOP_WORKERS);
+
+    if (thrd_create(&th, &LoopThread, NULL) != thrd_success) {
+        return false;
+    }
+    if (thrd_detach(th) != thrd_success) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < LOOP_WORKERS; i++) {
+        if (thrd_create(&th, &WorkerThread, NULL) != thrd_success) {
+            return false;
+        }
+        if (thrd_detach(th) != thrd_success) {
+            return false;
+        }
+    }
+
+    return true;
+}
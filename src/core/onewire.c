@@ -10,8 +10,14 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <threads.h>
 
 #include <core/onewire.h>
+#include <core/timer.h>
+#include <utils/log.h>
 
 /*********************************************************************/
 /*                                                                   */
@@ -19,11 +25,48 @@
 /*                                                                   */
 /*********************************************************************/
 
-typedef enum {
-    ONE_WIRE_IBUTTONS,
-    ONE_WIRE_TEMPS,
-    ONE_WIRE_ALL
-} OneWireDeviceType;
+typedef struct {
+    char    prefix[SHORT_STR_LEN];
+    char    value[SHORT_STR_LEN];
+    int     fd;
+    bool    seen;
+} OneWireDevice;
+
+typedef struct {
+    char            prefix[SHORT_STR_LEN];
+    OneWireHandler  handler;
+    void            *data;
+} OneWireSub;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _OneWire {
+    char        root[STR_LEN];
+    char        slaves[ONE_WIRE_SLAVES_LEN];
+    ssize_t     len;
+    bool        online;
+    bool        error;
+    uint64_t    scanned;
+    GList       *devices;
+    GList       *subs;
+    Timer       *timer;
+    mtx_t       mtx;
+} OneWire = {
+    .root = ONE_WIRE_ROOT_PATH,
+    .len = -1,
+    .online = false,
+    .error = false,
+    .timer = NULL,
+    .scanned = 0,
+    .devices = NULL,
+    .subs = NULL
+};
+
+static once_flag one_wire_once = ONCE_FLAG_INIT;
 
 /*********************************************************************/
 /*                                                                   */
@@ -31,87 +74,286 @@ typedef enum {
 /*                                                                   */
 /*********************************************************************/
 
-static bool OneWireDevicesGet(OneWireDeviceType type, GList **devices)
+static void OneWireInit()
 {
-    char    buf[STR_LEN];
-    FILE    *fd = NULL;
+    if (mtx_init(&OneWire.mtx, mtx_plain | mtx_recursive) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "ONEWIRE", "Failed to init 1-Wire mutex");
+    }
+}
 
-    fd = fopen(ONE_WIRE_SLAVES_PATH, "r");
-    if (fd == NULL) {
-        return false;
+static OneWireDevice *DeviceFind(const char *prefix, const char *value)
+{
+    for (GList *d = OneWire.devices; d != NULL; d = d->next) {
+        OneWireDevice *dev = (OneWireDevice *)d->data;
+
+        if (!strcmp(dev->prefix, prefix) && !strcmp(dev->value, value)) {
+            return dev;
+        }
+    }
+    return NULL;
+}
+
+static void DeviceNotify(const OneWireDevice *dev, bool present)
+{
+    for (GList *s = OneWire.subs; s != NULL; s = s->next) {
+        OneWireSub *sub = (OneWireSub *)s->data;
+
+        if (!strcmp(sub->prefix, dev->prefix)) {
+            sub->handler(dev->value, present, sub->data);
+        }
+    }
+}
+
+static void SlavesParse()
+{
+    char *saveptr = NULL;
+
+    for (GList *d = OneWire.devices; d != NULL; d = d->next) {
+        ((OneWireDevice *)d->data)->seen = false;
+    }
+
+    /* "not found." is listed when bus is empty, it has no family prefix */
+    for (char *line = strtok_r(OneWire.slaves, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr)) {
+        char *value = strchr(line, '-');
+
+        if (value == NULL) {
+            continue;
+        }
+        *value++ = '\0';
+
+        OneWireDevice *dev = DeviceFind(line, value);
+        if (dev == NULL) {
+            dev = (OneWireDevice *)malloc(sizeof(OneWireDevice));
+
+            strncpy(dev->prefix, line, SHORT_STR_LEN);
+            strncpy(dev->value, value, SHORT_STR_LEN);
+            dev->fd = -1;
+
+            OneWire.devices = g_list_append(OneWire.devices, (void *)dev);
+            DeviceNotify(dev, true);
+        }
+        dev->seen = true;
     }
 
-    while (fgets(buf, STR_LEN, fd)) {
-        buf[strlen(buf)-1] = '\0';
-
-        char **parts = g_strsplit(buf, "-", 0);
-
-        if (parts[0] != NULL && parts[1] != NULL) {
-            OneWireData *data = NULL;
-
-            switch (type) {
-                case ONE_WIRE_IBUTTONS:
-                    if (!strcmp(parts[0], ONE_WIRE_IBUTTON_PREFIX)) {
-                        data = (OneWireData *)malloc(sizeof(OneWireData));
-                        strncpy(data->value, parts[1], SHORT_STR_LEN);
-                        *devices = g_list_append(*devices, data);
-                    }
-                    break;
-
-                case ONE_WIRE_TEMPS:
-                    if (!strcmp(parts[0], ONE_WIRE_DS18B20_PREFIX)) {
-                        data = (OneWireData *)malloc(sizeof(OneWireData));
-                        strncpy(data->value, parts[1], SHORT_STR_LEN);
-                        *devices = g_list_append(*devices, data);
-                    }
-                    break;
-
-                case ONE_WIRE_ALL:
-                    data = (OneWireData *)malloc(sizeof(OneWireData));
-                    strncpy(data->value, parts[1], SHORT_STR_LEN);
-                    *devices = g_list_append(*devices, data);
-                    break;
+    GList *d = OneWire.devices;
+    while (d != NULL) {
+        GList         *next = d->next;
+        OneWireDevice *dev = (OneWireDevice *)d->data;
+
+        if (!dev->seen) {
+            OneWire.devices = g_list_remove(OneWire.devices, dev);
+            DeviceNotify(dev, false);
+
+            if (dev->fd >= 0) {
+                close(dev->fd);
             }
+            free(dev);
         }
+        d = next;
+    }
+}
+
+static bool SlavesScan(bool force)
+{
+    char        path[STR_LEN];
+    char        buf[ONE_WIRE_SLAVES_LEN];
+    uint64_t    now = UtilsMonoMsecGet();
+
+    if (!force && OneWire.scanned != 0 && (now - OneWire.scanned) < ONE_WIRE_SCAN_MSEC) {
+        return OneWire.online;
+    }
+    OneWire.scanned = now;
+
+    snprintf(path, STR_LEN, "%s/%s", OneWire.root, ONE_WIRE_SLAVES_PATH);
 
-        g_strfreev(parts);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        OneWire.online = false;
+        return false;
+    }
+    ssize_t len = read(fd, buf, ONE_WIRE_SLAVES_LEN - 1);
+    close(fd);
+
+    if (len < 0) {
+        OneWire.online = false;
+        return false;
     }
+    OneWire.online = true;
+
+    /* Table is rebuilt only when slaves list was changed */
+    if (len == OneWire.len && !memcmp(buf, OneWire.slaves, len)) {
+        return true;
+    }
+
+    memcpy(OneWire.slaves, buf, len);
+    OneWire.slaves[len] = '\0';
+    SlavesParse();
 
-    fclose(fd);
+    /* Parsing splits buffer, so keep raw copy for comparison */
+    memcpy(OneWire.slaves, buf, len);
+    OneWire.len = len;
 
     return true;
 }
 
+static void ScanTimerHandler(void *data)
+{
+    mtx_lock(&OneWire.mtx);
+    bool ret = SlavesScan(true);
+    mtx_unlock(&OneWire.mtx);
+
+    if (!ret && !OneWire.error) {
+        Log(LOG_TYPE_ERROR, "ONEWIRE", "Failed to read 1-Wire slaves list");
+    } else if (ret && OneWire.error) {
+        Log(LOG_TYPE_INFO, "ONEWIRE", "Successfully read 1-Wire slaves list");
+    }
+    OneWire.error = !ret;
+}
+
 /*********************************************************************/
 /*                                                                   */
 /*                          PUBLIC FUNCTIONS                         */
 /*                                                                   */
 /*********************************************************************/
 
+void OneWireRootSet(const char *path)
+{
+    strncpy(OneWire.root, path, STR_LEN);
+}
+
 bool OneWireDevicesList(GList **devices)
 {
-    return OneWireDevicesGet(ONE_WIRE_ALL, devices);
+    call_once(&one_wire_once, OneWireInit);
+
+    mtx_lock(&OneWire.mtx);
+
+    if (!SlavesScan(false)) {
+        mtx_unlock(&OneWire.mtx);
+        return false;
+    }
+
+    for (GList *d = OneWire.devices; d != NULL; d = d->next) {
+        OneWireDevice *dev = (OneWireDevice *)d->data;
+        OneWireData   *data = (OneWireData *)malloc(sizeof(OneWireData));
+
+        strncpy(data->value, dev->value, SHORT_STR_LEN);
+        *devices = g_list_append(*devices, data);
+    }
+
+    mtx_unlock(&OneWire.mtx);
+    return true;
+}
+
+bool OneWireSubscribe(const char *prefix, OneWireHandler handler, void *data)
+{
+    call_once(&one_wire_once, OneWireInit);
+
+    OneWireSub *sub = (OneWireSub *)malloc(sizeof(OneWireSub));
+
+    strncpy(sub->prefix, prefix, SHORT_STR_LEN);
+    sub->handler = handler;
+    sub->data = data;
+
+    mtx_lock(&OneWire.mtx);
+    OneWire.subs = g_list_append(OneWire.subs, (void *)sub);
+    mtx_unlock(&OneWire.mtx);
+
+    return true;
 }
 
-bool OneWireKeysRead(GList **keys)
+bool OneWireStart()
 {
-    return OneWireDevicesGet(ONE_WIRE_IBUTTONS, keys);
+    call_once(&one_wire_once, OneWireInit);
+
+    Log(LOG_TYPE_INFO, "ONEWIRE", "Starting 1-Wire scan");
+
+    OneWire.timer = TimerBlockingNew(ScanTimerHandler, NULL);
+    if (!TimerPeriodicSet(OneWire.timer, ONE_WIRE_SCAN_MSEC)) {
+        return false;
+    }
+    TimerTrigger(OneWire.timer);
+
+    return true;
 }
 
-bool OneWireTempRead(const char *id, float *temp)
+bool OneWireTempConvert()
 {
-    char    buf[STR_LEN];
-    char    file_name[STR_LEN];
+    char    path[STR_LEN];
+    int     state = -1;
     FILE    *file;
 
-    snprintf(file_name, STR_LEN, "%s/%s-%s/temperature", ONE_WIRE_PATH, ONE_WIRE_DS18B20_PREFIX, id);
+    snprintf(path, STR_LEN, "%s/%s", OneWire.root, ONE_WIRE_BULK_PATH);
 
-    file = fopen(file_name, "r");
+    file = fopen(path, "w");
     if (file == NULL) {
         return false;
     }
-    fscanf(file, "%s", buf);
-    fclose(file);
+    fputs("trigger\n", file);
+    if (fclose(file) != 0) {
+        return false;
+    }
+
+    /* -1 while conversion is in progress on any sensor */
+    for (unsigned waited = 0; waited <= ONE_WIRE_CONVERT_MSEC * 2; waited += ONE_WIRE_POLL_MSEC) {
+        UtilsMsecSleep(ONE_WIRE_POLL_MSEC);
+
+        file = fopen(path, "r");
+        if (file == NULL) {
+            return false;
+        }
+        if (fscanf(file, "%d", &state) != 1) {
+            state = 0;
+        }
+        fclose(file);
+
+        if (state >= 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool OneWireTempRead(const char *id, float *temp)
+{
+    char    buf[SHORT_STR_LEN];
+    char    file_name[STR_LEN];
+    ssize_t len;
+
+    call_once(&one_wire_once, OneWireInit);
+
+    mtx_lock(&OneWire.mtx);
+
+    OneWireDevice *dev = DeviceFind(ONE_WIRE_DS18B20_PREFIX, id);
+    if (dev == NULL) {
+        SlavesScan(false);
+        dev = DeviceFind(ONE_WIRE_DS18B20_PREFIX, id);
+    }
+    if (dev == NULL) {
+        mtx_unlock(&OneWire.mtx);
+        return false;
+    }
+
+    if (dev->fd < 0) {
+        snprintf(file_name, STR_LEN, "%s/%s/%s-%s/temperature", OneWire.root, ONE_WIRE_PATH, ONE_WIRE_DS18B20_PREFIX, id);
+        dev->fd = open(file_name, O_RDONLY | O_CLOEXEC);
+    }
+    if (dev->fd < 0) {
+        mtx_unlock(&OneWire.mtx);
+        return false;
+    }
+
+    /* sysfs attribute is regenerated on every read from offset 0 */
+    len = pread(dev->fd, buf, SHORT_STR_LEN - 1, 0);
+    if (len <= 0) {
+        close(dev->fd);
+        dev->fd = -1;
+        mtx_unlock(&OneWire.mtx);
+        return false;
+    }
+
+    mtx_unlock(&OneWire.mtx);
+    buf[len] = '\0';
 
     *temp = strtof(buf, NULL);
     *temp /= 1000;
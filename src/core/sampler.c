@@ -0,0 +1,292 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <threads.h>
+
+#include <core/sampler.h>
+#include <core/extenders.h>
+#include <utils/log.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+typedef struct {
+    GpioPin     *pin;
+    atomic_int  samples[SAMPLER_RING_LEN];
+    atomic_uint head;
+} SamplerRing;
+
+typedef struct {
+    Extender    *ext;
+    GList       *rings;
+} SamplerAdc;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _Sampler {
+    SamplerRing **rings;
+    unsigned    count;
+    GList       *adcs;
+} Sampler = {
+    .rings = NULL,
+    .count = 0,
+    .adcs = NULL
+};
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static SamplerRing *RingGet(const GpioPin *pin)
+{
+    if (Sampler.rings == NULL || pin->id >= Sampler.count) {
+        return NULL;
+    }
+    return Sampler.rings[pin->id];
+}
+
+static void RingPush(SamplerRing *ring, int value)
+{
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    atomic_store_explicit(&ring->samples[head % SAMPLER_RING_LEN], value, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static unsigned RingCopy(SamplerRing *ring, int *buf, unsigned count)
+{
+    if (count > SAMPLER_WINDOW_MAX) {
+        count = SAMPLER_WINDOW_MAX;
+    }
+
+    for (unsigned t = 0; t < SAMPLER_READ_TRIES; t++) {
+        unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned n = (head < count) ? head : count;
+
+        for (unsigned i = 0; i < n; i++) {
+            buf[i] = atomic_load_explicit(&ring->samples[(head - n + i) % SAMPLER_RING_LEN], memory_order_relaxed);
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+
+        /* Copy is valid if writer did not wrap over copied slots */
+        unsigned after = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        if (after - head <= SAMPLER_RING_LEN - n) {
+            return n;
+        }
+    }
+
+    return 0;
+}
+
+static bool ChannelSample(SamplerAdc *adc, SamplerRing *ring, bool setup)
+{
+    int     value;
+    int     sum = 0;
+
+    if (setup) {
+        if (!ExtenderAdcStart(adc->ext, ring->pin->pin)) {
+            return false;
+        }
+        /* First conversion after input switch may hold previous input */
+        UtilsMsecSleep(SAMPLER_SETTLE_MSEC);
+    }
+
+    for (unsigned i = 0; i < SAMPLER_OVERSAMPLE; i++) {
+        if (!ExtenderAdcRead(adc->ext, &value)) {
+            return false;
+        }
+        sum += value;
+
+        if (i + 1 < SAMPLER_OVERSAMPLE) {
+            UtilsMsecSleep(SAMPLER_CONV_MSEC);
+        }
+    }
+
+    RingPush(ring, sum / SAMPLER_OVERSAMPLE);
+    return true;
+}
+
+static int AdcThread(void *data)
+{
+    SamplerAdc  *adc = (SamplerAdc *)data;
+    bool        single = (g_list_length(adc->rings) == 1);
+    bool        setup = true;
+    bool        error = false;
+
+    for (;;) {
+        bool ret = true;
+
+        for (GList *r = adc->rings; r != NULL; r = r->next) {
+            /* Single channel stays selected between cycles */
+            if (!ChannelSample(adc, (SamplerRing *)r->data, setup || !single)) {
+                ret = false;
+            }
+        }
+        setup = !ret;
+
+        if (!ret && !error) {
+            LogF(LOG_TYPE_ERROR, "SAMPLER", "Failed to sample Extender \"%s\"", adc->ext->name);
+        } else if (ret && error) {
+            LogF(LOG_TYPE_INFO, "SAMPLER", "Successfully sampled Extender \"%s\"", adc->ext->name);
+        }
+        error = !ret;
+
+        UtilsMsecSleep(SAMPLER_CYCLE_MSEC);
+    }
+    return 0;
+}
+
+static SamplerAdc *AdcGet(Extender *ext)
+{
+    for (GList *a = Sampler.adcs; a != NULL; a = a->next) {
+        SamplerAdc *adc = (SamplerAdc *)a->data;
+        if (adc->ext == ext) {
+            return adc;
+        }
+    }
+
+    SamplerAdc *adc = (SamplerAdc *)malloc(sizeof(SamplerAdc));
+
+    adc->ext = ext;
+    adc->rings = NULL;
+
+    Sampler.adcs = g_list_append(Sampler.adcs, (void *)adc);
+    return adc;
+}
+
+static int IntCompare(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+bool SamplerHas(const GpioPin *pin)
+{
+    return RingGet(pin) != NULL;
+}
+
+unsigned SamplerWindowGet(const GpioPin *pin, int *buf, unsigned count)
+{
+    SamplerRing *ring = RingGet(pin);
+
+    if (ring == NULL) {
+        return 0;
+    }
+    return RingCopy(ring, buf, count);
+}
+
+bool SamplerMeanGet(const GpioPin *pin, unsigned window, int *value)
+{
+    int         buf[SAMPLER_WINDOW_MAX];
+    long long   sum = 0;
+
+    unsigned n = SamplerWindowGet(pin, buf, window);
+    if (n == 0) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < n; i++) {
+        sum += buf[i];
+    }
+
+    *value = (int)(sum / n);
+    return true;
+}
+
+bool SamplerMedianGet(const GpioPin *pin, unsigned window, int *value)
+{
+    int buf[SAMPLER_WINDOW_MAX];
+
+    unsigned n = SamplerWindowGet(pin, buf, window);
+    if (n == 0) {
+        return false;
+    }
+
+    qsort(buf, n, sizeof(int), IntCompare);
+
+    *value = buf[n / 2];
+    return true;
+}
+
+bool SamplerValueGet(const GpioPin *pin, int *value)
+{
+    return SamplerMeanGet(pin, SAMPLER_WINDOW, value);
+}
+
+bool SamplerStart()
+{
+    GList *pins = *GpioPinsGet();
+
+    Sampler.count = g_list_length(pins);
+    SamplerRing **rings = (SamplerRing **)calloc(Sampler.count, sizeof(SamplerRing *));
+    if (rings == NULL && Sampler.count != 0) {
+        Log(LOG_TYPE_ERROR, "SAMPLER", "Failed to allocate ring buffers");
+        return false;
+    }
+
+    for (GList *p = pins; p != NULL; p = p->next) {
+        GpioPin *pin = (GpioPin *)p->data;
+
+        if (pin->type != GPIO_TYPE_ANALOG || pin->ext == NULL || pin->ext->type != EXT_TYPE_ADS_1115) {
+            continue;
+        }
+
+        SamplerRing *ring = (SamplerRing *)malloc(sizeof(SamplerRing));
+
+        ring->pin = pin;
+        atomic_init(&ring->head, 0);
+        for (unsigned i = 0; i < SAMPLER_RING_LEN; i++) {
+            atomic_init(&ring->samples[i], 0);
+        }
+
+        SamplerAdc *adc = AdcGet(pin->ext);
+        adc->rings = g_list_append(adc->rings, (void *)ring);
+
+        rings[pin->id] = ring;
+    }
+
+    /* Single shot reads would break continuous mode from now */
+    Sampler.rings = rings;
+
+    LogF(LOG_TYPE_INFO, "SAMPLER", "Starting sampling of %u ADC extenders", g_list_length(Sampler.adcs));
+
+    for (GList *a = Sampler.adcs; a != NULL; a = a->next) {
+        thrd_t adc_th;
+
+        if (thrd_create(&adc_th, &AdcThread, a->data) != thrd_success) {
+            return false;
+        }
+        if (thrd_detach(adc_th) != thrd_success) {
+            return false;
+        }
+    }
+
+    return true;
+}
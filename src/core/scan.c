@@ -0,0 +1,870 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#define _GNU_SOURCE
+
+#define SCAN_WORD_BITS      64
+#define SCAN_WORDS(count)   (((count) + SCAN_WORD_BITS - 1) / SCAN_WORD_BITS)
+
+/* Bit planes of sliced counters, vote tally must hold SCAN_VOTE_SAMPLES */
+#define SCAN_VOTE_PLANES    3
+#define SCAN_FILTER_PLANES  8
+#define SCAN_FILTER_MAX     ((1U << SCAN_FILTER_PLANES) - 1)
+
+#include <core/scan.h>
+#include <core/extenders.h>
+#include <core/sim.h>
+#include <core/loop.h>
+#include <utils/utils.h>
+#include <utils/log.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <threads.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+typedef struct {
+    GpioEdge            edge;
+    GpioEventHandler    handler;
+    void                *data;
+} ScanSub;
+
+typedef uint64_t ScanWord;
+
+typedef struct {
+    GpioPin     *pin;
+    uint64_t    changed;
+    uint64_t    pulses;
+    uint64_t    window;
+    uint64_t    window_pulses;
+    float       rate;
+    GList       *subs;
+} ScanInput;
+
+typedef struct {
+    Extender    *ext;
+    GpioPin     *pin;
+} ScanIrq;
+
+typedef struct {
+    unsigned    id;
+    bool        state;
+    uint64_t    ts;
+} ScanEdge;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _Scan {
+    ScanInput   *image;
+    ScanWord    *inputs;
+    ScanWord    *sampling;
+    ScanWord    *outputs;
+    ScanWord    *counters;
+    ScanWord    *raw;
+    ScanWord    *state;
+    ScanWord    *sample;
+    ScanWord    *votes;
+    ScanWord    *tally;
+    ScanWord    *quorum;
+    ScanWord    *voted;
+    ScanWord    *stable;
+    ScanWord    *filter;
+    unsigned    vote;
+    unsigned    count;
+    unsigned    words;
+    unsigned    sampled;
+    unsigned    cycle;
+    unsigned    priority;
+    unsigned    watchdog;
+    unsigned    late;
+    ScanStats   stats;
+    GList       *irqs;
+    ScanEdge    edges[SCAN_EDGES_LEN];
+    unsigned    edges_head;
+    unsigned    edges_count;
+    uint64_t    dropped_logged;
+    bool        dispatching;
+    mtx_t       mtx;
+    bool        ready;
+} Scan = {
+    .image = NULL,
+    .inputs = NULL,
+    .sampling = NULL,
+    .outputs = NULL,
+    .counters = NULL,
+    .raw = NULL,
+    .state = NULL,
+    .sample = NULL,
+    .votes = NULL,
+    .tally = NULL,
+    .quorum = NULL,
+    .voted = NULL,
+    .stable = NULL,
+    .filter = NULL,
+    .vote = 0,
+    .irqs = NULL,
+    .edges_head = 0,
+    .edges_count = 0,
+    .dropped_logged = 0,
+    .dispatching = false,
+    .count = 0,
+    .words = 0,
+    .sampled = 0,
+    .cycle = SCAN_CYCLE_MSEC,
+    .priority = 0,
+    .watchdog = 0,
+    .late = 0,
+    .ready = false
+};
+
+static once_flag scan_once = ONCE_FLAG_INIT;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static inline bool BitGet(const ScanWord *image, unsigned id)
+{
+    return (image[id / SCAN_WORD_BITS] >> (id % SCAN_WORD_BITS)) & 1;
+}
+
+static inline void BitSet(ScanWord *image, unsigned id, bool state)
+{
+    ScanWord bit = (ScanWord)1 << (id % SCAN_WORD_BITS);
+
+    if (state) {
+        image[id / SCAN_WORD_BITS] |= bit;
+    } else {
+        image[id / SCAN_WORD_BITS] &= ~bit;
+    }
+}
+
+static inline unsigned BitNext(ScanWord *bits)
+{
+    unsigned bit = (unsigned)__builtin_ctzll(*bits);
+
+    *bits &= *bits - 1;
+    return bit;
+}
+
+static bool InputIs(const GpioPin *pin)
+{
+    return pin->id < Scan.count && BitGet(Scan.inputs, pin->id);
+}
+
+static unsigned FilterGet(const GpioPin *pin)
+{
+    unsigned msec = (pin->filter != 0) ? pin->filter : SCAN_FILTER_MSEC;
+    return (msec + Scan.cycle - 1) / Scan.cycle;
+}
+
+static ScanWord *PlaneGet(ScanWord *planes, unsigned plane, unsigned w)
+{
+    return &planes[plane * Scan.words + w];
+}
+
+static void PlanesSet(ScanWord *planes, unsigned count, unsigned id, unsigned value)
+{
+    for (unsigned p = 0; p < count; p++) {
+        BitSet(PlaneGet(planes, p, 0), id, (value >> p) & 1);
+    }
+}
+
+/* Bit-sliced a >= b for every bit of word, most significant plane first */
+static ScanWord PlanesGe(ScanWord *a, ScanWord *b, unsigned count, unsigned w)
+{
+    ScanWord gt = 0;
+    ScanWord eq = ~(ScanWord)0;
+
+    for (unsigned p = count; p-- > 0;) {
+        ScanWord x = *PlaneGet(a, p, w);
+        ScanWord y = *PlaneGet(b, p, w);
+
+        gt |= eq & x & ~y;
+        eq &= ~(x ^ y);
+    }
+
+    return gt | eq;
+}
+
+static ScanWord VoteUpdate(unsigned w, ScanWord next)
+{
+    ScanWord *oldest = PlaneGet(Scan.votes, Scan.vote, w);
+    ScanWord inc = next & ~*oldest;
+    ScanWord dec = *oldest & ~next;
+
+    *oldest = next;
+
+    /* Tally of ones in last samples, carry and borrow ripple through planes */
+    for (unsigned p = 0; p < SCAN_VOTE_PLANES && (inc | dec) != 0; p++) {
+        ScanWord *plane = PlaneGet(Scan.tally, p, w);
+        ScanWord carry = *plane & inc;
+        ScanWord borrow = ~*plane & dec;
+
+        *plane ^= inc | dec;
+        inc = carry;
+        dec = borrow;
+    }
+
+    return PlanesGe(Scan.tally, Scan.quorum, SCAN_VOTE_PLANES, w);
+}
+
+static void StableUpdate(unsigned w, ScanWord flip)
+{
+    ScanWord full = ~(ScanWord)0;
+
+    for (unsigned p = 0; p < SCAN_FILTER_PLANES; p++) {
+        full &= *PlaneGet(Scan.stable, p, w);
+    }
+
+    /* Flipped inputs restart from zero, saturated ones keep their count */
+    ScanWord inc = ~(flip | full);
+
+    for (unsigned p = 0; p < SCAN_FILTER_PLANES; p++) {
+        ScanWord *plane = PlaneGet(Scan.stable, p, w);
+        ScanWord carry = *plane & inc;
+
+        *plane = (*plane ^ inc) & ~flip;
+        inc = carry;
+    }
+}
+
+static void EdgeDeliver(const ScanEdge *edge)
+{
+    ScanInput *in = &Scan.image[edge->id];
+
+    GpioEvent event = {
+        .pin = in->pin,
+        .state = edge->state,
+        .ts = edge->ts
+    };
+
+    for (GList *s = in->subs; s != NULL; s = s->next) {
+        ScanSub *sub = (ScanSub *)s->data;
+
+        if ((edge->state && (sub->edge & GPIO_EDGE_RISING)) ||
+            (!edge->state && (sub->edge & GPIO_EDGE_FALLING))) {
+            sub->handler(&event, sub->data);
+        }
+    }
+}
+
+static void EdgesDispatchWork(void *data)
+{
+    mtx_lock(&Scan.mtx);
+
+    while (Scan.edges_count != 0) {
+        ScanEdge edge = Scan.edges[Scan.edges_head];
+
+        Scan.edges_head = (Scan.edges_head + 1) % SCAN_EDGES_LEN;
+        Scan.edges_count--;
+
+        /* Controller handlers may block, image is not held by them */
+        mtx_unlock(&Scan.mtx);
+        EdgeDeliver(&edge);
+        mtx_lock(&Scan.mtx);
+    }
+
+    uint64_t dropped = Scan.stats.dropped - Scan.dropped_logged;
+
+    Scan.dropped_logged = Scan.stats.dropped;
+    Scan.dispatching = false;
+
+    mtx_unlock(&Scan.mtx);
+
+    if (dropped != 0) {
+        LogF(LOG_TYPE_ERROR, "SCAN", "Input edges queue is full, %llu edges dropped", (unsigned long long)dropped);
+    }
+}
+
+static void EdgePush(unsigned id, bool state, uint64_t ts)
+{
+    if (Scan.image[id].subs == NULL) {
+        return;
+    }
+
+    if (Scan.edges_count == SCAN_EDGES_LEN) {
+        Scan.stats.dropped++;
+        return;
+    }
+
+    Scan.edges[(Scan.edges_head + Scan.edges_count) % SCAN_EDGES_LEN] = (ScanEdge) {
+        .id = id,
+        .state = state,
+        .ts = ts
+    };
+    Scan.edges_count++;
+
+    /* One dispatch is queued at a time to keep edges order */
+    if (!Scan.dispatching) {
+        Scan.dispatching = LoopWorkAdd(EdgesDispatchWork, NULL);
+    }
+}
+
+static void LineHandler(const GpioEvent *event, void *data)
+{
+    ScanInput *in = (ScanInput *)data;
+
+    mtx_lock(&Scan.mtx);
+
+    BitSet(Scan.raw, in->pin->id, event->state);
+    in->changed = event->ts;
+
+    if (BitGet(Scan.state, in->pin->id) != event->state) {
+        BitSet(Scan.state, in->pin->id, event->state);
+        EdgePush(in->pin->id, event->state, event->ts);
+    }
+
+    mtx_unlock(&Scan.mtx);
+}
+
+static void IntHandler(const GpioEvent *event, void *data)
+{
+    ScanIrq *irq = (ScanIrq *)data;
+
+    /* Raised port is read out on next cycle deadline */
+    ExtenderIntRaise(irq->ext);
+}
+
+static void IrqsInit()
+{
+    for (GList *e = *ExtendersGet(); e != NULL; e = e->next) {
+        Extender *ext = (Extender *)e->data;
+
+        if (ext->int_pin[0] == '\0' || !ext->online) {
+            continue;
+        }
+
+        GpioPin *pin = GpioPinGet(ext->int_pin);
+        if (pin == NULL || pin->line == GPIO_LINE_NONE) {
+            LogF(LOG_TYPE_ERROR, "SCAN", "Extender \"%s\" interrupt GPIO \"%s\" must be a gpiochip line, fallback to polling",
+                ext->name, ext->int_pin);
+            ExtenderIntSet(ext, "");
+            continue;
+        }
+
+        if (SimEnabled()) {
+            SimDeviceIntSet(ext->bus, ext->addr, pin->pin);
+        }
+
+        ScanIrq *irq = (ScanIrq *)malloc(sizeof(ScanIrq));
+
+        irq->ext = ext;
+        irq->pin = pin;
+
+        if (!GpioEventAdd(pin, GPIO_EDGE_FALLING, IntHandler, irq)) {
+            LogF(LOG_TYPE_ERROR, "SCAN", "Failed to watch Extender \"%s\" interrupt, fallback to polling", ext->name);
+            ExtenderIntSet(ext, "");
+            free(irq);
+            continue;
+        }
+
+        Scan.irqs = g_list_append(Scan.irqs, (void *)irq);
+        LogF(LOG_TYPE_INFO, "SCAN", "Extender \"%s\" read by interrupt GPIO \"%s\"", ext->name, pin->name);
+    }
+}
+
+static void IrqsCheck()
+{
+    bool state;
+
+    /* INT stays asserted while changes are not read out */
+    for (GList *i = Scan.irqs; i != NULL; i = i->next) {
+        ScanIrq *irq = (ScanIrq *)i->data;
+
+        if (GpioPinRead(irq->pin, &state) && !state) {
+            ExtenderIntRaise(irq->ext);
+        }
+    }
+}
+
+static void ScanInit()
+{
+    GList *pins = *GpioPinsGet();
+
+    if (mtx_init(&Scan.mtx, mtx_plain | mtx_recursive) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "SCAN", "Failed to init scan mutex");
+        return;
+    }
+
+    Scan.count = g_list_length(pins);
+    Scan.words = SCAN_WORDS(Scan.count);
+    Scan.image = (ScanInput *)calloc(Scan.count, sizeof(ScanInput));
+
+    /* One bit per pin id, images are scanned a word at a time */
+    Scan.inputs = (ScanWord *)calloc(Scan.words, sizeof(ScanWord));
+    Scan.sampling = (ScanWord *)calloc(Scan.words, sizeof(ScanWord));
+    Scan.outputs = (ScanWord *)calloc(Scan.words, sizeof(ScanWord));
+    Scan.counters = (ScanWord *)calloc(Scan.words, sizeof(ScanWord));
+    Scan.raw = (ScanWord *)calloc(Scan.words, sizeof(ScanWord));
+    Scan.state = (ScanWord *)calloc(Scan.words, sizeof(ScanWord));
+    Scan.sample = (ScanWord *)calloc(Scan.words, sizeof(ScanWord));
+
+    /* Sliced counters keep one word per plane for every image word */
+    Scan.votes = (ScanWord *)calloc(Scan.words * SCAN_VOTE_SAMPLES, sizeof(ScanWord));
+    Scan.tally = (ScanWord *)calloc(Scan.words * SCAN_VOTE_PLANES, sizeof(ScanWord));
+    Scan.quorum = (ScanWord *)calloc(Scan.words * SCAN_VOTE_PLANES, sizeof(ScanWord));
+    Scan.voted = (ScanWord *)calloc(Scan.words, sizeof(ScanWord));
+    Scan.stable = (ScanWord *)calloc(Scan.words * SCAN_FILTER_PLANES, sizeof(ScanWord));
+    Scan.filter = (ScanWord *)calloc(Scan.words * SCAN_FILTER_PLANES, sizeof(ScanWord));
+
+    if (Scan.count != 0 && (Scan.image == NULL || Scan.inputs == NULL || Scan.sampling == NULL ||
+        Scan.outputs == NULL || Scan.counters == NULL || Scan.raw == NULL || Scan.state == NULL ||
+        Scan.sample == NULL || Scan.votes == NULL || Scan.tally == NULL || Scan.quorum == NULL ||
+        Scan.voted == NULL || Scan.stable == NULL || Scan.filter == NULL)) {
+        Log(LOG_TYPE_ERROR, "SCAN", "Failed to allocate input image");
+        return;
+    }
+
+    for (GList *p = pins; p != NULL; p = p->next) {
+        GpioPin *pin = (GpioPin *)p->data;
+        ScanInput *in = &Scan.image[pin->id];
+        bool raw = false;
+
+        in->pin = pin;
+        in->subs = NULL;
+        in->changed = 0;
+        in->pulses = 0;
+        in->window = UtilsMonoNsecGet();
+        in->window_pulses = 0;
+        in->rate = 0.0f;
+
+        if (pin->type != GPIO_TYPE_DIGITAL || pin->pin == 0) {
+            continue;
+        }
+
+        if (pin->mode == GPIO_MODE_OUTPUT) {
+            BitSet(Scan.outputs, pin->id, true);
+            continue;
+        }
+
+        if (pin->mode != GPIO_MODE_INPUT) {
+            continue;
+        }
+        BitSet(Scan.inputs, pin->id, true);
+
+        if (!GpioPinRead(pin, &raw)) {
+            LogF(LOG_TYPE_ERROR, "SCAN", "Failed to read GPIO \"%s\"", pin->name);
+            raw = false;
+        }
+        BitSet(Scan.raw, pin->id, raw);
+        BitSet(Scan.state, pin->id, raw);
+        BitSet(Scan.sample, pin->id, raw);
+        BitSet(Scan.voted, pin->id, raw);
+
+        for (unsigned v = 0; v < SCAN_VOTE_SAMPLES; v++) {
+            BitSet(PlaneGet(Scan.votes, v, 0), pin->id, raw);
+        }
+        PlanesSet(Scan.tally, SCAN_VOTE_PLANES, pin->id, raw ? SCAN_VOTE_SAMPLES : 0);
+        PlanesSet(Scan.stable, SCAN_FILTER_PLANES, pin->id, SCAN_FILTER_MAX);
+
+        if (pin->line != GPIO_LINE_NONE) {
+            if (!GpioEventAdd(pin, GPIO_EDGE_BOTH, LineHandler, in)) {
+                LogF(LOG_TYPE_ERROR, "SCAN", "Failed to watch GPIO \"%s\"", pin->name);
+            }
+        }
+
+        if (pin->fd < 0) {
+            BitSet(Scan.sampling, pin->id, true);
+            BitSet(Scan.counters, pin->id, pin->counter);
+            Scan.sampled++;
+        }
+    }
+
+    IrqsInit();
+
+    Scan.ready = true;
+}
+
+static void InputsRead()
+{
+    bool raw;
+
+    /* Sample image is owned by scan thread, pins are read without lock */
+    for (unsigned w = 0; w < Scan.words; w++) {
+        ScanWord bits = Scan.sampling[w];
+        ScanWord next = 0;
+
+        while (bits != 0) {
+            unsigned bit = BitNext(&bits);
+            unsigned id = w * SCAN_WORD_BITS + bit;
+
+            /* Unread input keeps previous level */
+            if (!GpioPinRead(Scan.image[id].pin, &raw)) {
+                raw = BitGet(Scan.sample, id);
+            }
+            next |= (ScanWord)raw << bit;
+        }
+
+        Scan.sample[w] = next;
+    }
+}
+
+static void FiltersInit()
+{
+    for (unsigned id = 0; id < Scan.count; id++) {
+        if (!BitGet(Scan.sampling, id)) {
+            continue;
+        }
+
+        GpioPin *pin = Scan.image[id].pin;
+        unsigned cycles = FilterGet(pin);
+
+        if (cycles > SCAN_FILTER_MAX) {
+            LogF(LOG_TYPE_ERROR, "SCAN", "Filter of GPIO \"%s\" is limited to %u cycles", pin->name, SCAN_FILTER_MAX);
+            cycles = SCAN_FILTER_MAX;
+        }
+        PlanesSet(Scan.filter, SCAN_FILTER_PLANES, id, cycles);
+        PlanesSet(Scan.quorum, SCAN_VOTE_PLANES, id, SCAN_VOTE_SAMPLES / 2 + 1);
+    }
+}
+
+static void InputsUpdate(uint64_t now)
+{
+    for (unsigned w = 0; w < Scan.words; w++) {
+        ScanWord next = Scan.sample[w];
+        ScanWord changed = (next ^ Scan.raw[w]) & Scan.sampling[w];
+        ScanWord pulses = changed & next & Scan.counters[w];
+
+        Scan.raw[w] ^= changed;
+
+        while (pulses != 0) {
+            Scan.image[w * SCAN_WORD_BITS + BitNext(&pulses)].pulses++;
+        }
+
+        /* Majority of last samples, then it must hold for filter cycles */
+        ScanWord flip = (VoteUpdate(w, Scan.raw[w]) ^ Scan.voted[w]) & Scan.sampling[w];
+
+        Scan.voted[w] ^= flip;
+        StableUpdate(w, flip);
+
+        while (flip != 0) {
+            Scan.image[w * SCAN_WORD_BITS + BitNext(&flip)].changed = now;
+        }
+
+        ScanWord commit = (Scan.voted[w] ^ Scan.state[w]) & Scan.sampling[w] &
+            PlanesGe(Scan.stable, Scan.filter, SCAN_FILTER_PLANES, w);
+
+        Scan.state[w] ^= commit;
+
+        while (commit != 0) {
+            unsigned id = w * SCAN_WORD_BITS + BitNext(&commit);
+            EdgePush(id, BitGet(Scan.state, id), Scan.image[id].changed);
+        }
+    }
+
+    Scan.vote = (Scan.vote + 1) % SCAN_VOTE_SAMPLES;
+}
+
+static void OutputsSafeSet()
+{
+    for (unsigned w = 0; w < Scan.words; w++) {
+        ScanWord bits = Scan.outputs[w];
+
+        while (bits != 0) {
+            GpioPin *pin = Scan.image[w * SCAN_WORD_BITS + BitNext(&bits)].pin;
+
+            if (!GpioPinWrite(pin, false)) {
+                LogF(LOG_TYPE_ERROR, "SCAN", "Failed to set safe state of GPIO \"%s\"", pin->name);
+            }
+        }
+    }
+}
+
+static void RtSet()
+{
+    struct sched_param param = {
+        .sched_priority = (int)Scan.priority
+    };
+
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err != 0) {
+        LogF(LOG_TYPE_ERROR, "SCAN", "Failed to set SCHED_FIFO priority %u: %s", Scan.priority, strerror(err));
+    }
+}
+
+static void StatsUpdate(uint64_t deadline, uint64_t start, uint64_t end)
+{
+    ScanStats   *stats = &Scan.stats;
+    unsigned    exec = (unsigned)((end - start) / 1000ULL);
+    unsigned    jitter = (unsigned)((start - deadline) / 1000ULL);
+
+    /* Averages are exponential with 1/16 weight of last cycle */
+    if (stats->cycles == 0) {
+        stats->exec_avg = exec;
+        stats->jitter_avg = jitter;
+    } else {
+        stats->exec_avg = stats->exec_avg - stats->exec_avg / 16 + exec / 16;
+        stats->jitter_avg = stats->jitter_avg - stats->jitter_avg / 16 + jitter / 16;
+    }
+
+    stats->cycles++;
+    stats->exec_last = exec;
+    if (exec > stats->exec_max) {
+        stats->exec_max = exec;
+    }
+    stats->jitter_last = jitter;
+    if (jitter > stats->jitter_max) {
+        stats->jitter_max = jitter;
+    }
+}
+
+static uint64_t DeadlineNext(uint64_t deadline, uint64_t now, uint64_t period, bool *trip)
+{
+    deadline += period;
+
+    if (deadline > now) {
+        Scan.late = 0;
+        return deadline;
+    }
+
+    /* Cycle overran its period, missed deadlines are skipped */
+    Scan.stats.overruns++;
+    Scan.late++;
+
+    if (Scan.watchdog != 0 && Scan.late >= Scan.watchdog) {
+        Scan.late = 0;
+        Scan.stats.trips++;
+        *trip = true;
+    }
+
+    return deadline + ((now - deadline) / period + 1) * period;
+}
+
+static int ScanThread(void *data)
+{
+    struct timespec ts;
+    uint64_t        period = Scan.cycle * 1000000ULL;
+    uint64_t        deadline;
+
+    if (Scan.priority != 0) {
+        RtSet();
+    }
+
+    deadline = UtilsMonoNsecGet();
+
+    for (;;) {
+        uint64_t    start = UtilsMonoNsecGet();
+        bool        trip = false;
+
+        /* Bus I/O is out of image lock, readers never wait for I2C */
+        ExtendersRead();
+        IrqsCheck();
+        InputsRead();
+
+        mtx_lock(&Scan.mtx);
+        InputsUpdate(start);
+        mtx_unlock(&Scan.mtx);
+
+        ExtendersWrite();
+
+        uint64_t end = UtilsMonoNsecGet();
+
+        mtx_lock(&Scan.mtx);
+        StatsUpdate(deadline, start, end);
+        deadline = DeadlineNext(deadline, end, period, &trip);
+        mtx_unlock(&Scan.mtx);
+
+        if (trip) {
+            LogF(LOG_TYPE_ERROR, "SCAN", "Scan cycle overran %u times in a row, outputs set to safe state", Scan.watchdog);
+            OutputsSafeSet();
+            ExtendersWrite();
+        }
+
+        ts.tv_sec = (time_t)(deadline / 1000000000ULL);
+        ts.tv_nsec = (long)(deadline % 1000000000ULL);
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+    }
+
+    return 0;
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+void ScanCycleSet(unsigned msec)
+{
+    if (msec != 0) {
+        Scan.cycle = msec;
+    }
+}
+
+void ScanPrioritySet(unsigned priority)
+{
+    Scan.priority = priority;
+}
+
+void ScanWatchdogSet(unsigned overruns)
+{
+    Scan.watchdog = overruns;
+}
+
+bool ScanStatsGet(ScanStats *stats)
+{
+    call_once(&scan_once, ScanInit);
+
+    if (!Scan.ready) {
+        return false;
+    }
+
+    mtx_lock(&Scan.mtx);
+    memcpy(stats, &Scan.stats, sizeof(ScanStats));
+    mtx_unlock(&Scan.mtx);
+
+    stats->period = Scan.cycle * 1000;
+
+    return true;
+}
+
+bool ScanSubscribe(GpioPin *pin, GpioEdge edge, GpioEventHandler handler, void *data)
+{
+    call_once(&scan_once, ScanInit);
+
+    if (!Scan.ready) {
+        return false;
+    }
+
+    if (pin->pin == 0) {
+        return true;
+    }
+
+    if (!InputIs(pin)) {
+        LogF(LOG_TYPE_ERROR, "SCAN", "GPIO \"%s\" is not a digital input", pin->name);
+        return false;
+    }
+
+    ScanSub *sub = (ScanSub *)malloc(sizeof(ScanSub));
+
+    sub->edge = edge;
+    sub->handler = handler;
+    sub->data = data;
+
+    mtx_lock(&Scan.mtx);
+    Scan.image[pin->id].subs = g_list_append(Scan.image[pin->id].subs, (void *)sub);
+    mtx_unlock(&Scan.mtx);
+
+    return true;
+}
+
+bool ScanInputGet(const GpioPin *pin, bool *state)
+{
+    call_once(&scan_once, ScanInit);
+
+    if (!Scan.ready || !InputIs(pin)) {
+        return GpioPinRead(pin, state);
+    }
+
+    mtx_lock(&Scan.mtx);
+    *state = BitGet(Scan.state, pin->id);
+    mtx_unlock(&Scan.mtx);
+
+    return true;
+}
+
+bool ScanCounterGet(const GpioPin *pin, ScanCounter *counter)
+{
+    uint64_t pulses;
+
+    call_once(&scan_once, ScanInit);
+
+    if (!Scan.ready || !InputIs(pin) || !pin->counter) {
+        return false;
+    }
+
+    /* Line pulses are read out of image lock, events lock is taken before it */
+    bool line = !BitGet(Scan.sampling, pin->id) && GpioEventPulsesGet(pin, &pulses);
+
+    mtx_lock(&Scan.mtx);
+
+    ScanInput *in = &Scan.image[pin->id];
+
+    if (!line) {
+        pulses = in->pulses;
+    }
+
+    uint64_t now = UtilsMonoNsecGet();
+
+    if (now - in->window >= SCAN_COUNTER_WINDOW_MSEC * 1000000ULL) {
+        in->rate = (float)(pulses - in->window_pulses) * 1e9f / (float)(now - in->window);
+        in->window = now;
+        in->window_pulses = pulses;
+    }
+
+    counter->pulses = pulses;
+    counter->rate = in->rate;
+
+    mtx_unlock(&Scan.mtx);
+    return true;
+}
+
+bool ScanStart()
+{
+    thrd_t  scan_th;
+
+    call_once(&scan_once, ScanInit);
+
+    if (!Scan.ready) {
+        return false;
+    }
+
+    LogF(LOG_TYPE_INFO, "SCAN", "Starting input scan of %u sampled inputs every %u ms", Scan.sampled, Scan.cycle);
+
+    if (Scan.sampled == 0) {
+        return true;
+    }
+
+    if (Scan.priority != 0) {
+        /* Page faults in scan cycle are as bad as preemption */
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            LogF(LOG_TYPE_ERROR, "SCAN", "Failed to lock memory: %s", strerror(errno));
+        }
+        LogF(LOG_TYPE_INFO, "SCAN", "Scan runs with SCHED_FIFO priority %u", Scan.priority);
+    }
+
+    if (Scan.watchdog != 0) {
+        LogF(LOG_TYPE_INFO, "SCAN", "Scan watchdog trips after %u overruns", Scan.watchdog);
+    }
+
+    FiltersInit();
+
+    /* Controllers' extender writes are committed by cycle from the first one */
+    ExtendersDeferSet(true);
+
+    if (thrd_create(&scan_th, &ScanThread, NULL) != thrd_success) {
+        ExtendersDeferSet(false);
+        return false;
+    }
+    if (thrd_detach(scan_th) != thrd_success) {
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,882 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib-2.0/glib.h>
+
+#include <core/sim.h>
+#include <core/gpio.h>
+#include <core/onewire.h>
+#include <utils/utils.h>
+#include <utils/log.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+typedef struct {
+    SimDeviceType   type;
+    unsigned        bus;
+    unsigned        addr;
+    unsigned        base;
+    uint8_t         regs[SIM_REGS_MAX];
+    uint16_t        words[4];
+    uint8_t         ptr;
+    unsigned        int_pin;
+    int64_t         clock;
+    uint64_t        since;
+} SimDevice;
+
+typedef struct {
+    char        id[SHORT_STR_LEN];
+    bool        present;
+    bool        temp;
+} SimW1Slave;
+
+typedef enum {
+    SIM_STEP_GPIO,
+    SIM_STEP_ANALOG,
+    SIM_STEP_TEMP,
+    SIM_STEP_KEY,
+    SIM_STEP_LOOP
+} SimStepType;
+
+typedef struct {
+    uint64_t    at;
+    SimStepType type;
+    unsigned    pin;
+    char        id[SHORT_STR_LEN];
+    int         value;
+} SimStep;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _Sim {
+    bool        enabled;
+    char        script[STR_LEN];
+    char        root[STR_LEN];
+    bool        level[SIM_PINS_MAX];
+    bool        driven[SIM_PINS_MAX];
+    int         analog[SIM_PINS_MAX];
+    GList       *devices;
+    GList       *slaves;
+    GList       *steps;
+    mtx_t       mtx;
+} Sim = {
+    .enabled = false,
+    .script = { 0 },
+    .root = { 0 },
+    .devices = NULL,
+    .slaves = NULL,
+    .steps = NULL
+};
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static SimDevice *DeviceFind(unsigned bus, unsigned addr)
+{
+    for (GList *d = Sim.devices; d != NULL; d = d->next) {
+        SimDevice *dev = (SimDevice *)d->data;
+        if (dev->bus == bus && dev->addr == addr) {
+            return dev;
+        }
+    }
+    return NULL;
+}
+
+static void DeviceIntSet(SimDevice *dev, bool active)
+{
+    /* INT output is open drain, active low */
+    if (dev->int_pin != 0) {
+        Sim.level[dev->int_pin] = !active;
+    }
+}
+
+static uint8_t PortGet(SimDevice *dev, unsigned port, uint8_t dir, uint8_t latch)
+{
+    uint8_t val = 0;
+
+    for (unsigned b = 0; b < 8; b++) {
+        unsigned pin = dev->base + port * 8 + b;
+        bool     bit = (dir & (1 << b)) ? Sim.level[pin] : (latch & (1 << b));
+
+        if (bit) {
+            val |= 1 << b;
+        }
+    }
+    return val;
+}
+
+static void PortSet(SimDevice *dev, unsigned port, uint8_t mask, uint8_t latch)
+{
+    for (unsigned b = 0; b < 8; b++) {
+        unsigned pin = dev->base + port * 8 + b;
+
+        if ((mask & (1 << b)) && !Sim.driven[pin]) {
+            Sim.level[pin] = (latch & (1 << b)) ? true : false;
+        }
+    }
+}
+
+static void Pcf8574Write(SimDevice *dev, const uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        dev->regs[0] = buf[i];
+        PortSet(dev, 0, 0xFF, dev->regs[0]);
+    }
+}
+
+static void Pcf8574Read(SimDevice *dev, uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        /* Quasi-bidirectional pin reads low if latch or line is low */
+        buf[i] = dev->regs[0] & PortGet(dev, 0, 0xFF, 0);
+        DeviceIntSet(dev, false);
+    }
+}
+
+static void Mcp23017Write(SimDevice *dev, const uint8_t *buf, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+
+    dev->ptr = buf[0] % 0x16;
+
+    for (size_t i = 1; i < len; i++) {
+        uint8_t reg = dev->ptr;
+
+        /* GPIO writes go to output latch */
+        if (reg == 0x12 || reg == 0x13) {
+            reg += 2;
+        }
+        dev->regs[reg] = buf[i];
+
+        if (reg == 0x14 || reg == 0x15) {
+            unsigned port = reg - 0x14;
+            PortSet(dev, port, ~dev->regs[port], dev->regs[reg]);
+        }
+
+        dev->ptr = (dev->ptr + 1) % 0x16;
+    }
+}
+
+static void Mcp23017Read(SimDevice *dev, uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        uint8_t reg = dev->ptr;
+
+        if (reg == 0x12 || reg == 0x13) {
+            unsigned port = reg - 0x12;
+            buf[i] = PortGet(dev, port, dev->regs[port], dev->regs[0x14 + port]);
+            DeviceIntSet(dev, false);
+        } else {
+            buf[i] = dev->regs[reg];
+        }
+
+        dev->ptr = (dev->ptr + 1) % 0x16;
+    }
+}
+
+static uint16_t Ads1115Value(SimDevice *dev, unsigned channel)
+{
+    int value = Sim.analog[dev->base + channel];
+
+    if (value > INT16_MAX) {
+        value = INT16_MAX;
+    } else if (value < INT16_MIN) {
+        value = INT16_MIN;
+    }
+    return (uint16_t)(int16_t)value;
+}
+
+static void Ads1115Write(SimDevice *dev, const uint8_t *buf, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+
+    dev->ptr = buf[0] & 0x03;
+
+    if (len < 3) {
+        return;
+    }
+
+    uint16_t word = (buf[1] << 8) | buf[2];
+
+    if (dev->ptr != SIM_ADS_1115_CONFIG) {
+        dev->words[dev->ptr] = word;
+        return;
+    }
+
+    dev->words[SIM_ADS_1115_CONFIG] = word;
+
+    /* Single shot conversion of single ended input completes at once */
+    unsigned mux = (word >> 12) & 0x07;
+    if ((word & SIM_ADS_1115_OS) && mux >= 4) {
+        dev->words[SIM_ADS_1115_CONV] = Ads1115Value(dev, mux - 4);
+    }
+    dev->words[SIM_ADS_1115_CONFIG] |= SIM_ADS_1115_OS;
+}
+
+static void Ads1115Read(SimDevice *dev, uint8_t *buf, size_t len)
+{
+    uint16_t config = dev->words[SIM_ADS_1115_CONFIG];
+    unsigned mux = (config >> 12) & 0x07;
+
+    /* Continuous mode always has fresh conversion of selected input */
+    if (dev->ptr == SIM_ADS_1115_CONV && !(config & SIM_ADS_1115_SINGLE) && mux >= 4) {
+        dev->words[SIM_ADS_1115_CONV] = Ads1115Value(dev, mux - 4);
+    }
+
+    uint16_t word = dev->words[dev->ptr];
+
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (i % 2 == 0) ? (word >> 8) : (word & 0xFF);
+    }
+}
+
+static uint8_t BcdGet(unsigned value)
+{
+    return (uint8_t)(((value / 10) << 4) | (value % 10));
+}
+
+static unsigned BcdParse(uint8_t bcd)
+{
+    return (bcd >> 4) * 10 + (bcd & 0x0F);
+}
+
+static void Ds3231Write(SimDevice *dev, const uint8_t *buf, size_t len)
+{
+    struct tm tm;
+
+    if (len == 0) {
+        return;
+    }
+
+    dev->ptr = buf[0] % SIM_DS_3231_REGS;
+
+    /* Only setting of whole time block is supported */
+    if (dev->ptr != SIM_DS_3231_TIME || len < 8) {
+        return;
+    }
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_sec = BcdParse(buf[1] & 0x7F);
+    tm.tm_min = BcdParse(buf[2] & 0x7F);
+    tm.tm_hour = BcdParse(buf[3] & 0x3F);
+    tm.tm_mday = BcdParse(buf[5] & 0x3F);
+    tm.tm_mon = BcdParse(buf[6] & 0x1F) - 1;
+    tm.tm_year = BcdParse(buf[7]) + 100;
+
+    dev->clock = (int64_t)timegm(&tm);
+    dev->since = UtilsMonoNsecGet();
+}
+
+static void Ds3231Read(SimDevice *dev, uint8_t *buf, size_t len)
+{
+    struct tm   tm;
+    time_t      now = (time_t)(dev->clock + (int64_t)((UtilsMonoNsecGet() - dev->since) / 1000000000ULL));
+
+    gmtime_r(&now, &tm);
+
+    dev->regs[0x00] = BcdGet(tm.tm_sec);
+    dev->regs[0x01] = BcdGet(tm.tm_min);
+    dev->regs[0x02] = BcdGet(tm.tm_hour);
+    dev->regs[0x03] = BcdGet(tm.tm_wday + 1);
+    dev->regs[0x04] = BcdGet(tm.tm_mday);
+    dev->regs[0x05] = BcdGet(tm.tm_mon + 1);
+    dev->regs[0x06] = BcdGet(tm.tm_year % 100);
+
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = dev->regs[dev->ptr];
+        dev->ptr = (dev->ptr + 1) % SIM_DS_3231_REGS;
+    }
+}
+
+static void DevicesNotify(unsigned pin)
+{
+    for (GList *d = Sim.devices; d != NULL; d = d->next) {
+        SimDevice *dev = (SimDevice *)d->data;
+        unsigned  bit = pin - dev->base;
+
+        if (pin < dev->base) {
+            continue;
+        }
+
+        switch (dev->type) {
+            case SIM_DEV_PCF_8574:
+                if (bit < 8 && (dev->regs[0] & (1 << bit))) {
+                    DeviceIntSet(dev, true);
+                }
+                break;
+
+            case SIM_DEV_MCP_23017:
+                if (bit < 16 && (dev->regs[0x04 + bit / 8] & (1 << (bit % 8)))) {
+                    DeviceIntSet(dev, true);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+static bool TreeWrite(const char *path, const char *text)
+{
+    char tmp[STR_LEN + 8];
+
+    /* Readers must never see partly written file */
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *file = fopen(tmp, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fputs(text, file);
+    fclose(file);
+
+    return rename(tmp, path) == 0;
+}
+
+static bool TreeTempWrite(const char *path, int value)
+{
+    char text[SHORT_STR_LEN];
+
+    /* Rewritten in place as readers keep the file open, fixed width
+       so no stale tail is left */
+    int len = snprintf(text, SHORT_STR_LEN, "%09d\n", value);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ret = (pwrite(fd, text, len, 0) == len);
+    close(fd);
+
+    return ret;
+}
+
+static bool TreeCreate()
+{
+    const char *dirs[] = {
+        ONE_WIRE_PATH,
+        "drivers",
+        "drivers/w1_master_driver",
+        "drivers/w1_master_driver/w1_bus_master1"
+    };
+    char path[STR_LEN];
+
+    strncpy(Sim.root, SIM_TREE_TEMPLATE, STR_LEN);
+    if (mkdtemp(Sim.root) == NULL) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        snprintf(path, STR_LEN, "%s/%s", Sim.root, dirs[i]);
+        if (mkdir(path, 0755) < 0) {
+            return false;
+        }
+    }
+
+    snprintf(path, STR_LEN, "%s/%s", Sim.root, ONE_WIRE_SLAVES_PATH);
+    if (!TreeWrite(path, "not found.\n")) {
+        return false;
+    }
+
+    /* Conversion completes at once, so bulk read never reports -1 */
+    snprintf(path, STR_LEN, "%s/%s", Sim.root, ONE_WIRE_BULK_PATH);
+    if (!TreeWrite(path, "0\n")) {
+        return false;
+    }
+
+    OneWireRootSet(Sim.root);
+    return true;
+}
+
+static bool TreeSlavesUpdate()
+{
+    char    path[STR_LEN];
+    GString *text = g_string_new("");
+    bool    empty = true;
+
+    for (GList *s = Sim.slaves; s != NULL; s = s->next) {
+        SimW1Slave *slave = (SimW1Slave *)s->data;
+
+        if (slave->present) {
+            g_string_append_printf(text, "%s\n", slave->id);
+            empty = false;
+        }
+    }
+
+    if (empty) {
+        g_string_append(text, "not found.\n");
+    }
+
+    snprintf(path, STR_LEN, "%s/%s", Sim.root, ONE_WIRE_SLAVES_PATH);
+    bool ret = TreeWrite(path, text->str);
+
+    g_string_free(text, true);
+    return ret;
+}
+
+static SimW1Slave *TreeSlaveGet(const char *prefix, const char *id)
+{
+    char    path[STR_LEN];
+    char    full_id[SHORT_STR_LEN];
+
+    snprintf(full_id, SHORT_STR_LEN, "%s-%s", prefix, id);
+
+    for (GList *s = Sim.slaves; s != NULL; s = s->next) {
+        SimW1Slave *slave = (SimW1Slave *)s->data;
+        if (!strcmp(slave->id, full_id)) {
+            return slave;
+        }
+    }
+
+    SimW1Slave *slave = (SimW1Slave *)malloc(sizeof(SimW1Slave));
+
+    strncpy(slave->id, full_id, SHORT_STR_LEN);
+    slave->present = false;
+    slave->temp = !strcmp(prefix, ONE_WIRE_DS18B20_PREFIX);
+
+    if (slave->temp) {
+        snprintf(path, STR_LEN, "%s/%s/%s", Sim.root, ONE_WIRE_PATH, slave->id);
+        mkdir(path, 0755);
+    }
+
+    Sim.slaves = g_list_append(Sim.slaves, (void *)slave);
+    return slave;
+}
+
+static bool ScriptLineParse(const char *buf, unsigned line)
+{
+    char        cmd[SHORT_STR_LEN];
+    char        name[SHORT_STR_LEN];
+    char        arg[SHORT_STR_LEN];
+    unsigned    at;
+    int         count;
+
+    count = sscanf(buf, "%u %49s %49s %49s", &at, cmd, name, arg);
+    if (count < 2) {
+        LogF(LOG_TYPE_ERROR, "SIM", "Script line %u is malformed", line);
+        return false;
+    }
+
+    SimStep *step = (SimStep *)malloc(sizeof(SimStep));
+
+    step->at = at;
+    step->pin = 0;
+    step->value = 0;
+    step->id[0] = '\0';
+
+    if (!strcmp(cmd, "loop")) {
+        step->type = SIM_STEP_LOOP;
+        Sim.steps = g_list_append(Sim.steps, (void *)step);
+        return true;
+    }
+
+    if (count < 4) {
+        LogF(LOG_TYPE_ERROR, "SIM", "Script line %u has no value", line);
+        free(step);
+        return false;
+    }
+
+    if (!strcmp(cmd, "gpio") || !strcmp(cmd, "analog")) {
+        GpioPin *pin = GpioPinGet(name);
+        if (pin == NULL || pin->pin >= SIM_PINS_MAX) {
+            LogF(LOG_TYPE_ERROR, "SIM", "Script line %u refers unknown GPIO \"%s\"", line, name);
+            free(step);
+            return false;
+        }
+        step->type = !strcmp(cmd, "gpio") ? SIM_STEP_GPIO : SIM_STEP_ANALOG;
+        step->pin = pin->pin;
+        step->value = atoi(arg);
+    } else if (!strcmp(cmd, "temp")) {
+        step->type = SIM_STEP_TEMP;
+        strncpy(step->id, name, SHORT_STR_LEN);
+        step->value = (int)(strtof(arg, NULL) * 1000);
+    } else if (!strcmp(cmd, "key")) {
+        step->type = SIM_STEP_KEY;
+        strncpy(step->id, name, SHORT_STR_LEN);
+        step->value = !strcmp(arg, "on");
+    } else {
+        LogF(LOG_TYPE_ERROR, "SIM", "Script line %u has unknown command \"%s\"", line, cmd);
+        free(step);
+        return false;
+    }
+
+    Sim.steps = g_list_append(Sim.steps, (void *)step);
+    return true;
+}
+
+static bool ScriptLoad()
+{
+    char        buf[STR_LEN];
+    unsigned    line = 0;
+    bool        ret = true;
+
+    FILE *file = fopen(Sim.script, "r");
+    if (file == NULL) {
+        LogF(LOG_TYPE_ERROR, "SIM", "Failed to open script \"%s\"", Sim.script);
+        return false;
+    }
+
+    while (fgets(buf, STR_LEN, file)) {
+        char *text = buf;
+
+        line++;
+
+        while (*text == ' ' || *text == '\t') {
+            text++;
+        }
+        if (*text == '#' || *text == '\n' || *text == '\r' || *text == '\0') {
+            continue;
+        }
+
+        if (!ScriptLineParse(text, line)) {
+            ret = false;
+            break;
+        }
+    }
+
+    fclose(file);
+    return ret;
+}
+
+static void ScriptStep(const SimStep *step)
+{
+    char        path[STR_LEN];
+    SimW1Slave  *slave;
+
+    mtx_lock(&Sim.mtx);
+
+    switch (step->type) {
+        case SIM_STEP_GPIO:
+            Sim.driven[step->pin] = true;
+            if (Sim.level[step->pin] != (step->value != 0)) {
+                Sim.level[step->pin] = (step->value != 0);
+                DevicesNotify(step->pin);
+            }
+            break;
+
+        case SIM_STEP_ANALOG:
+            Sim.analog[step->pin] = step->value;
+            break;
+
+        case SIM_STEP_TEMP:
+            slave = TreeSlaveGet(ONE_WIRE_DS18B20_PREFIX, step->id);
+
+            snprintf(path, STR_LEN, "%s/%s/%s/temperature", Sim.root, ONE_WIRE_PATH, slave->id);
+            if (!TreeTempWrite(path, step->value)) {
+                LogF(LOG_TYPE_ERROR, "SIM", "Failed to write sensor \"%s\" temperature", slave->id);
+            }
+
+            if (!slave->present) {
+                slave->present = true;
+                TreeSlavesUpdate();
+            }
+            break;
+
+        case SIM_STEP_KEY:
+            slave = TreeSlaveGet(ONE_WIRE_IBUTTON_PREFIX, step->id);
+
+            if (slave->present != (step->value != 0)) {
+                slave->present = (step->value != 0);
+                TreeSlavesUpdate();
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    mtx_unlock(&Sim.mtx);
+}
+
+static int ScriptThread(void *data)
+{
+    for (;;) {
+        uint64_t start = UtilsMonoMsecGet();
+
+        for (GList *s = Sim.steps; s != NULL; s = s->next) {
+            SimStep *step = (SimStep *)s->data;
+            uint64_t now = UtilsMonoMsecGet();
+
+            if (start + step->at > now) {
+                UtilsMsecSleep((unsigned)(start + step->at - now));
+            }
+
+            if (step->type == SIM_STEP_LOOP) {
+                break;
+            }
+            ScriptStep(step);
+
+            if (s->next == NULL) {
+                Log(LOG_TYPE_INFO, "SIM", "Script finished");
+                return 0;
+            }
+        }
+    }
+    return 0;
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+bool SimInit(const char *script)
+{
+    if (mtx_init(&Sim.mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "SIM", "Failed to init simulation mutex");
+        return false;
+    }
+
+    if (!TreeCreate()) {
+        Log(LOG_TYPE_ERROR, "SIM", "Failed to create 1-Wire sysfs tree");
+        return false;
+    }
+
+    if (script != NULL) {
+        strncpy(Sim.script, script, STR_LEN);
+    }
+
+    /* Undriven lines are pulled up */
+    for (unsigned i = 0; i < SIM_PINS_MAX; i++) {
+        Sim.level[i] = true;
+        Sim.driven[i] = false;
+        Sim.analog[i] = 0;
+    }
+
+    Sim.enabled = true;
+
+    LogF(LOG_TYPE_INFO, "SIM", "Simulated hardware enabled, 1-Wire tree \"%s\"", Sim.root);
+    return true;
+}
+
+bool SimEnabled()
+{
+    return Sim.enabled;
+}
+
+bool SimPinRead(unsigned pin, bool *state)
+{
+    if (pin >= SIM_PINS_MAX) {
+        return false;
+    }
+
+    mtx_lock(&Sim.mtx);
+    *state = Sim.level[pin];
+    mtx_unlock(&Sim.mtx);
+
+    return true;
+}
+
+bool SimPinWrite(unsigned pin, bool state)
+{
+    if (pin >= SIM_PINS_MAX) {
+        return false;
+    }
+
+    mtx_lock(&Sim.mtx);
+    if (!Sim.driven[pin]) {
+        Sim.level[pin] = state;
+    }
+    mtx_unlock(&Sim.mtx);
+
+    return true;
+}
+
+bool SimPinReadA(unsigned pin, int *value)
+{
+    if (pin >= SIM_PINS_MAX) {
+        return false;
+    }
+
+    mtx_lock(&Sim.mtx);
+    *value = Sim.analog[pin];
+    mtx_unlock(&Sim.mtx);
+
+    return true;
+}
+
+void SimPinWriteA(unsigned pin, int value)
+{
+    if (pin >= SIM_PINS_MAX) {
+        return;
+    }
+
+    mtx_lock(&Sim.mtx);
+    Sim.analog[pin] = value;
+    mtx_unlock(&Sim.mtx);
+}
+
+bool SimDeviceAdd(SimDeviceType type, unsigned bus, unsigned addr, unsigned base)
+{
+    if (base + 16 > SIM_PINS_MAX || DeviceFind(bus, addr) != NULL) {
+        return false;
+    }
+
+    SimDevice *dev = (SimDevice *)calloc(1, sizeof(SimDevice));
+
+    dev->type = type;
+    dev->bus = bus;
+    dev->addr = addr;
+    dev->base = base;
+    dev->int_pin = 0;
+
+    switch (type) {
+        case SIM_DEV_PCF_8574:
+            dev->regs[0] = 0xFF;
+            break;
+
+        case SIM_DEV_MCP_23017:
+            /* All pins are inputs after reset */
+            dev->regs[0x00] = 0xFF;
+            dev->regs[0x01] = 0xFF;
+            break;
+
+        case SIM_DEV_ADS_1115:
+            dev->words[SIM_ADS_1115_CONFIG] = 0x8583;
+            dev->words[2] = 0x8000;
+            dev->words[3] = 0x7FFF;
+            break;
+
+        case SIM_DEV_DS_3231: {
+            struct tm   tm;
+            time_t      now = time(NULL);
+
+            /* RTC keeps local time, stored as if it was UTC */
+            localtime_r(&now, &tm);
+            dev->clock = (int64_t)timegm(&tm);
+            dev->since = UtilsMonoNsecGet();
+            break;
+        }
+    }
+
+    mtx_lock(&Sim.mtx);
+    Sim.devices = g_list_append(Sim.devices, (void *)dev);
+    mtx_unlock(&Sim.mtx);
+
+    return true;
+}
+
+bool SimDeviceFound(unsigned bus, unsigned addr)
+{
+    mtx_lock(&Sim.mtx);
+    bool found = (DeviceFind(bus, addr) != NULL);
+    mtx_unlock(&Sim.mtx);
+
+    return found;
+}
+
+bool SimDeviceIntSet(unsigned bus, unsigned addr, unsigned pin)
+{
+    if (pin >= SIM_PINS_MAX) {
+        return false;
+    }
+
+    mtx_lock(&Sim.mtx);
+
+    SimDevice *dev = DeviceFind(bus, addr);
+    if (dev != NULL) {
+        dev->int_pin = pin;
+        Sim.driven[pin] = true;
+        Sim.level[pin] = true;
+    }
+
+    mtx_unlock(&Sim.mtx);
+    return dev != NULL;
+}
+
+bool SimI2cTransfer(unsigned bus, unsigned addr, const uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen)
+{
+    mtx_lock(&Sim.mtx);
+
+    SimDevice *dev = DeviceFind(bus, addr);
+    if (dev == NULL) {
+        mtx_unlock(&Sim.mtx);
+        return false;
+    }
+
+    switch (dev->type) {
+        case SIM_DEV_PCF_8574:
+            Pcf8574Write(dev, wbuf, wlen);
+            Pcf8574Read(dev, rbuf, rlen);
+            break;
+
+        case SIM_DEV_MCP_23017:
+            Mcp23017Write(dev, wbuf, wlen);
+            Mcp23017Read(dev, rbuf, rlen);
+            break;
+
+        case SIM_DEV_ADS_1115:
+            Ads1115Write(dev, wbuf, wlen);
+            Ads1115Read(dev, rbuf, rlen);
+            break;
+
+        case SIM_DEV_DS_3231:
+            Ds3231Write(dev, wbuf, wlen);
+            Ds3231Read(dev, rbuf, rlen);
+            break;
+    }
+
+    mtx_unlock(&Sim.mtx);
+    return true;
+}
+
+bool SimStart()
+{
+    thrd_t  script_th;
+
+    if (!Sim.enabled || Sim.script[0] == '\0') {
+        return true;
+    }
+
+    if (!ScriptLoad()) {
+        return false;
+    }
+
+    if (Sim.steps == NULL) {
+        return true;
+    }
+
+    LogF(LOG_TYPE_INFO, "SIM", "Starting script \"%s\" of %u steps", Sim.script, g_list_length(Sim.steps));
+
+    if (thrd_create(&script_th, &ScriptThread, NULL) != thrd_success) {
+        return false;
+    }
+    if (thrd_detach(script_th) != thrd_success) {
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,536 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <threads.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+#include <core/timer.h>
+#include <core/loop.h>
+#include <utils/utils.h>
+#include <utils/log.h>
+
+#define TIMER_TICK_NONE     UINT64_MAX
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+struct _Timer {
+    TimerHandler    handler;
+    void            *data;
+    uint64_t        deadline;
+    unsigned        period;
+    bool            blocking;
+    bool            armed;
+    bool            queued;
+    bool            running;
+    bool            again;
+    bool            pending;
+    Timer           **slot;
+    Timer           *prev;
+    Timer           *next;
+    Timer           *run_next;
+};
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _Timers {
+    Timer       *wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t    tick;
+    uint64_t    armed;
+    Timer       *pending;
+    Timer       *pending_tail;
+    int         fd;
+    int         wake;
+    mtx_t       mtx;
+} Timers = {
+    .wheel = {{0}},
+    .tick = 0,
+    .armed = TIMER_TICK_NONE,
+    .pending = NULL,
+    .pending_tail = NULL,
+    .fd = -1,
+    .wake = -1
+};
+
+static once_flag timers_once = ONCE_FLAG_INIT;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static void TimersInit()
+{
+    if (mtx_init(&Timers.mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "TIMER", "Failed to init timers mutex");
+    }
+
+    Timers.fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (Timers.fd < 0) {
+        Log(LOG_TYPE_ERROR, "TIMER", "Failed to create timerfd");
+    }
+
+    Timers.wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (Timers.wake < 0) {
+        Log(LOG_TYPE_ERROR, "TIMER", "Failed to create timers eventfd");
+    }
+
+    Timers.tick = UtilsMonoMsecGet() / TIMER_TICK_MSEC;
+}
+
+static void WheelInsert(Timer *timer)
+{
+    /* Rounded up, timer never expires before deadline */
+    uint64_t    expires = (timer->deadline + TIMER_TICK_MSEC - 1) / TIMER_TICK_MSEC;
+    unsigned    level = 0;
+
+    if (expires < Timers.tick) {
+        expires = Timers.tick;
+    }
+
+    uint64_t delta = expires - Timers.tick;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    /* Out of wheel range, timer is cascaded again from last slot */
+    if (delta >= (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))) {
+        expires = Timers.tick + (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    }
+
+    Timer **slot = &Timers.wheel[level][(expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = *slot;
+    if (*slot != NULL) {
+        (*slot)->prev = timer;
+    }
+    *slot = timer;
+}
+
+static void WheelRemove(Timer *timer)
+{
+    if (timer->prev != NULL) {
+        timer->prev->next = timer->next;
+    } else {
+        *timer->slot = timer->next;
+    }
+    if (timer->next != NULL) {
+        timer->next->prev = timer->prev;
+    }
+
+    timer->slot = NULL;
+    timer->prev = NULL;
+    timer->next = NULL;
+}
+
+static void TimerRun(void *data)
+{
+    Timer *timer = (Timer *)data;
+
+    mtx_lock(&Timers.mtx);
+
+    /* Queued call was cancelled */
+    if (!timer->queued) {
+        mtx_unlock(&Timers.mtx);
+        return;
+    }
+    timer->queued = false;
+    timer->running = true;
+
+    mtx_unlock(&Timers.mtx);
+    timer->handler(timer->data);
+    mtx_lock(&Timers.mtx);
+
+    timer->running = false;
+
+    if (timer->again) {
+        timer->again = false;
+        timer->queued = LoopWorkAdd(TimerRun, timer);
+    }
+
+    mtx_unlock(&Timers.mtx);
+}
+
+static void PendingAdd(Timer *timer)
+{
+    timer->queued = true;
+
+    /* Cancelled call stays listed and is skipped, so it is not listed twice */
+    if (timer->pending) {
+        return;
+    }
+    timer->pending = true;
+    timer->run_next = NULL;
+
+    if (Timers.pending_tail != NULL) {
+        Timers.pending_tail->run_next = timer;
+    } else {
+        Timers.pending = timer;
+
+        /* Loop thread is woken when calls are queued from other threads */
+        uint64_t one = 1;
+        if (Timers.wake >= 0 && write(Timers.wake, &one, sizeof(one)) < 0) {
+            Log(LOG_TYPE_ERROR, "TIMER", "Failed to wake timers");
+        }
+    }
+    Timers.pending_tail = timer;
+}
+
+static void PendingRun()
+{
+    mtx_lock(&Timers.mtx);
+
+    /* Calls queued again by handlers wait for next loop pass */
+    Timer *last = Timers.pending_tail;
+    bool done = (last == NULL);
+
+    while (!done) {
+        Timer *timer = Timers.pending;
+
+        Timers.pending = timer->run_next;
+        if (Timers.pending == NULL) {
+            Timers.pending_tail = NULL;
+        }
+        timer->run_next = NULL;
+        timer->pending = false;
+        done = (timer == last);
+
+        if (!timer->queued) {
+            continue;
+        }
+        timer->queued = false;
+        timer->running = true;
+
+        mtx_unlock(&Timers.mtx);
+        timer->handler(timer->data);
+        mtx_lock(&Timers.mtx);
+
+        timer->running = false;
+
+        if (timer->again) {
+            timer->again = false;
+            PendingAdd(timer);
+        }
+    }
+
+    mtx_unlock(&Timers.mtx);
+}
+
+static void TimerQueue(Timer *timer)
+{
+    if (timer->running) {
+        timer->again = true;
+        return;
+    }
+    if (timer->queued) {
+        return;
+    }
+
+    if (timer->blocking) {
+        timer->queued = LoopWorkAdd(TimerRun, timer);
+    } else {
+        PendingAdd(timer);
+    }
+}
+
+static void TimerExpire(Timer *timer, uint64_t now)
+{
+    if (timer->period != 0) {
+        timer->deadline += timer->period;
+
+        if (timer->deadline <= now) {
+            timer->deadline += ((now - timer->deadline) / timer->period + 1) * timer->period;
+        }
+        WheelInsert(timer);
+    } else {
+        timer->armed = false;
+    }
+
+    TimerQueue(timer);
+}
+
+static void WheelCascade(unsigned level)
+{
+    Timer **slot = &Timers.wheel[level][(Timers.tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+    Timer *timer = *slot;
+
+    *slot = NULL;
+
+    while (timer != NULL) {
+        Timer *next = timer->next;
+
+        WheelInsert(timer);
+        timer = next;
+    }
+}
+
+static void WheelAdvance(uint64_t now)
+{
+    uint64_t target = now / TIMER_TICK_MSEC;
+
+    while (Timers.tick <= target) {
+        /* Upper levels are moved down when lower level wraps */
+        for (unsigned level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if ((Timers.tick & ((1ULL << (TIMER_WHEEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            WheelCascade(level);
+        }
+
+        Timer **slot = &Timers.wheel[0][Timers.tick & TIMER_WHEEL_MASK];
+        Timer *timer = *slot;
+
+        *slot = NULL;
+
+        while (timer != NULL) {
+            Timer *next = timer->next;
+
+            timer->slot = NULL;
+            timer->prev = NULL;
+            timer->next = NULL;
+
+            TimerExpire(timer, now);
+            timer = next;
+        }
+
+        Timers.tick++;
+    }
+}
+
+static uint64_t WheelNextGet()
+{
+    uint64_t next = TIMER_TICK_NONE;
+
+    /* Level 0 slot holds only timers of exactly that tick */
+    for (uint64_t t = Timers.tick; t < Timers.tick + TIMER_WHEEL_SLOTS; t++) {
+        if (Timers.wheel[0][t & TIMER_WHEEL_MASK] != NULL) {
+            next = t;
+            break;
+        }
+    }
+
+    /* Upper levels need wakeup at cascade, timers are checked again after it */
+    for (unsigned level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        unsigned shift = TIMER_WHEEL_BITS * level;
+        uint64_t cur = Timers.tick >> shift;
+
+        for (uint64_t i = 1; i <= TIMER_WHEEL_SLOTS; i++) {
+            if (Timers.wheel[level][(cur + i) & TIMER_WHEEL_MASK] != NULL) {
+                uint64_t cascade = (cur + i) << shift;
+
+                if (cascade < next) {
+                    next = cascade;
+                }
+                break;
+            }
+        }
+    }
+
+    return next;
+}
+
+static void WheelArm()
+{
+    struct itimerspec   its;
+    uint64_t            next = WheelNextGet();
+
+    if (next == Timers.armed || Timers.fd < 0) {
+        return;
+    }
+
+    memset(&its, 0, sizeof(its));
+
+    if (next != TIMER_TICK_NONE) {
+        uint64_t msec = next * TIMER_TICK_MSEC;
+
+        its.it_value.tv_sec = msec / 1000;
+        its.it_value.tv_nsec = (long)(msec % 1000) * 1000000L;
+
+        /* Zero value disarms timerfd, so deadline at epoch is moved forward */
+        if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+            its.it_value.tv_nsec = 1;
+        }
+    }
+
+    if (timerfd_settime(Timers.fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+        Log(LOG_TYPE_ERROR, "TIMER", "Failed to arm timerfd");
+        return;
+    }
+    Timers.armed = next;
+}
+
+static bool TimerArm(Timer *timer, uint64_t deadline, unsigned period)
+{
+    if (timer == NULL) {
+        return false;
+    }
+
+    mtx_lock(&Timers.mtx);
+
+    if (timer->armed) {
+        WheelRemove(timer);
+    }
+
+    timer->deadline = deadline;
+    timer->period = period;
+    timer->armed = true;
+
+    WheelInsert(timer);
+    WheelArm();
+
+    mtx_unlock(&Timers.mtx);
+    return true;
+}
+
+static void WheelFdHandler(int fd, uint32_t events, void *data)
+{
+    uint64_t expirations;
+
+    /* Expiration count is not used, wheel is advanced by clock */
+    if (read(fd, &expirations, sizeof(expirations)) < 0) {
+        expirations = 0;
+    }
+
+    mtx_lock(&Timers.mtx);
+
+    WheelAdvance(UtilsMonoMsecGet());
+
+    /* Disarmed by expiration, armed value is not valid anymore */
+    Timers.armed = TIMER_TICK_NONE;
+    WheelArm();
+
+    mtx_unlock(&Timers.mtx);
+
+    PendingRun();
+}
+
+static void WakeFdHandler(int fd, uint32_t events, void *data)
+{
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) < 0) {
+        count = 0;
+    }
+
+    PendingRun();
+}
+
+static Timer *TimerCreate(TimerHandler handler, void *data, bool blocking)
+{
+    call_once(&timers_once, TimersInit);
+
+    Timer *timer = (Timer *)calloc(1, sizeof(Timer));
+    if (timer == NULL) {
+        return NULL;
+    }
+
+    timer->handler = handler;
+    timer->data = data;
+    timer->blocking = blocking;
+
+    return timer;
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+Timer *TimerNew(TimerHandler handler, void *data)
+{
+    return TimerCreate(handler, data, false);
+}
+
+Timer *TimerBlockingNew(TimerHandler handler, void *data)
+{
+    return TimerCreate(handler, data, true);
+}
+
+bool TimerPeriodicSet(Timer *timer, unsigned msec)
+{
+    if (msec == 0) {
+        return false;
+    }
+    return TimerArm(timer, UtilsMonoMsecGet() + msec, msec);
+}
+
+bool TimerOnceSet(Timer *timer, unsigned msec)
+{
+    return TimerArm(timer, UtilsMonoMsecGet() + msec, 0);
+}
+
+bool TimerAtSet(Timer *timer, uint64_t msec)
+{
+    return TimerArm(timer, msec, 0);
+}
+
+bool TimerTrigger(Timer *timer)
+{
+    if (timer == NULL) {
+        return false;
+    }
+
+    mtx_lock(&Timers.mtx);
+    TimerQueue(timer);
+    mtx_unlock(&Timers.mtx);
+
+    return true;
+}
+
+void TimerCancel(Timer *timer)
+{
+    if (timer == NULL) {
+        return;
+    }
+
+    mtx_lock(&Timers.mtx);
+
+    if (timer->armed) {
+        WheelRemove(timer);
+        timer->armed = false;
+    }
+    timer->queued = false;
+    timer->again = false;
+
+    mtx_unlock(&Timers.mtx);
+}
+
+bool TimerStart()
+{
+    call_once(&timers_once, TimersInit);
+
+    if (Timers.fd < 0 || Timers.wake < 0) {
+        return false;
+    }
+
+    Log(LOG_TYPE_INFO, "TIMER", "Starting timer wheel");
+
+    if (!LoopFdAdd(Timers.wake, EPOLLIN, WakeFdHandler, NULL)) {
+        return false;
+    }
+    return LoopFdAdd(Timers.fd, EPOLLIN, WheelFdHandler, NULL);
+}
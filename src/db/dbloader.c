@@ -28,9 +28,11 @@
 static bool DatabaseSecurityLoad()
 {
     int         status = 0, alarm = 0;
+    uint32_t    zones = 0;
     bool        exists = false;
     Database    db;
     char        sql[STR_LEN];
+    char        where[STR_LEN];
 
     if (!DatabaseOpen(&db, SECURITY_DB_FILE)) {
         DatabaseClose(&db);
@@ -83,7 +85,43 @@ static bool DatabaseSecurityLoad()
         }
     }
 
-    if (!SecurityStatusSet((bool)status, false)) {
+    /* Zones without row are created with controller status of previous versions */
+    for (GList *z = *SecurityZonesGet(); z != NULL; z = z->next) {
+        SecurityZone    *zone = (SecurityZone *)z->data;
+        int             zone_status = status;
+
+        snprintf(where, STR_LEN, "name=\"%s%s\"", SECURITY_DB_ZONE_PREFIX, zone->name);
+
+        if (!DatabaseRowExists(&db, "security", where, &exists)) {
+            LogF(LOG_TYPE_ERROR, "DBLOADER", "Failed to check Security zone \"%s\" status", zone->name);
+            DatabaseClose(&db);
+            return false;
+        }
+
+        if (exists) {
+            if (!DatabaseFindOne(&db, "security", "status", where, DATABASE_COL_TYPE_INT, (void *)&zone_status)) {
+                LogF(LOG_TYPE_ERROR, "DBLOADER", "Failed to find Security zone \"%s\" status", zone->name);
+                DatabaseClose(&db);
+                return false;
+            }
+            LogF(LOG_TYPE_INFO, "DBLOADER", "Loaded status for Security zone \"%s\" is \"%d\"", zone->name, zone_status);
+        } else {
+            snprintf(sql, STR_LEN, "\"%s%s\", %d, %d", SECURITY_DB_ZONE_PREFIX, zone->name, zone_status, 0);
+
+            if (!DatabaseInsert(&db, "security", "name, status, alarm", sql)) {
+                LogF(LOG_TYPE_ERROR, "DBLOADER", "Failed to insert Security zone \"%s\" status", zone->name);
+                DatabaseClose(&db);
+                return false;
+            }
+            LogF(LOG_TYPE_INFO, "DBLOADER", "Created status for Security zone \"%s\" is \"%d\"", zone->name, zone_status);
+        }
+
+        if (zone_status) {
+            zones |= 1U << zone->id;
+        }
+    }
+
+    if (!SecurityZonesStatusSet(zones, true, false)) {
         Log(LOG_TYPE_ERROR, "DBLOADER", "Failed to load Security controller status");
         DatabaseClose(&db);
         return false;
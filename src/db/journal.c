@@ -0,0 +1,533 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <db/journal.h>
+#include <core/timer.h>
+#include <utils/utils.h>
+#include <utils/log.h>
+
+#define JOURNAL_SEGMENT_SIZE    (JOURNAL_SEGMENT_RECORDS * sizeof(JournalSlot))
+#define JOURNAL_FILE_EXT        ".jrn"
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+/* On-disk record, seq is slot + 1 and is written last to commit it */
+typedef struct {
+    _Atomic uint64_t    seq;
+    uint64_t            time;
+    uint8_t             ctrl;
+    uint8_t             event;
+    uint16_t            reserved;
+    int32_t             value;
+    char                name[JOURNAL_NAME_LEN];
+} JournalSlot;
+
+_Static_assert(sizeof(JournalSlot) == 64, "Journal record must be 64 bytes");
+
+typedef struct {
+    _Atomic uint64_t    min;
+    _Atomic uint64_t    max;
+    atomic_uint         ctrls;
+} JournalBlock;
+
+typedef struct {
+    _Atomic(JournalSlot *)  map;
+    _Atomic uint64_t        number;
+    JournalBlock            blocks[JOURNAL_BLOCKS];
+} JournalSegment;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _Journal {
+    char                path[STR_LEN];
+    JournalSegment      segments[JOURNAL_SEGMENTS_MAX];
+    _Atomic uint64_t    head;
+    _Atomic uint64_t    dropped;
+    uint64_t            last;
+    uint64_t            synced;
+    unsigned            ticks;
+    Timer               *timer;
+    mtx_t               mtx;
+} Journal = {
+    .path = {0},
+    .last = 0,
+    .synced = 0,
+    .ticks = 0,
+    .timer = NULL
+};
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static uint64_t RealMsecGet()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void SegmentPathGet(uint64_t number, char *path)
+{
+    snprintf(path, EXT_STR_LEN, "%s%s%010llu%s", Journal.path, JOURNAL_DIR,
+        (unsigned long long)number, JOURNAL_FILE_EXT);
+}
+
+static bool SegmentNumberParse(const char *file, uint64_t *number)
+{
+    unsigned long long  value;
+    char                ext[8];
+
+    if (strlen(file) != 10 + strlen(JOURNAL_FILE_EXT)) {
+        return false;
+    }
+    if (sscanf(file, "%10llu%7s", &value, ext) != 2 || strcmp(ext, JOURNAL_FILE_EXT)) {
+        return false;
+    }
+
+    *number = value;
+    return true;
+}
+
+static void NameCopy(char *dst, const char *src)
+{
+    size_t len = strnlen(src, JOURNAL_NAME_LEN);
+
+    if (len == JOURNAL_NAME_LEN) {
+        len = JOURNAL_NAME_LEN - 1;
+
+        /* Cut is moved back to character start to keep name valid UTF-8 */
+        while (len > 0 && ((unsigned char)src[len] & 0xC0) == 0x80) {
+            len--;
+        }
+    }
+
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static void BlockUpdate(JournalBlock *block, uint64_t time, unsigned ctrl)
+{
+    uint64_t min = atomic_load_explicit(&block->min, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&block->max, memory_order_relaxed);
+
+    while (time < min && !atomic_compare_exchange_weak_explicit(&block->min, &min, time,
+            memory_order_relaxed, memory_order_relaxed)) {
+    }
+    while (time > max && !atomic_compare_exchange_weak_explicit(&block->max, &max, time,
+            memory_order_relaxed, memory_order_relaxed)) {
+    }
+
+    atomic_fetch_or_explicit(&block->ctrls, 1U << ctrl, memory_order_relaxed);
+}
+
+static void BlocksBuild(JournalSegment *seg, JournalSlot *map, uint64_t number)
+{
+    for (unsigned b = 0; b < JOURNAL_BLOCKS; b++) {
+        JournalBlock *block = &seg->blocks[b];
+
+        atomic_store_explicit(&block->min, UINT64_MAX, memory_order_relaxed);
+        atomic_store_explicit(&block->max, 0, memory_order_relaxed);
+        atomic_store_explicit(&block->ctrls, 0, memory_order_relaxed);
+
+        for (unsigned i = b * JOURNAL_BLOCK_RECORDS; i < (b + 1) * JOURNAL_BLOCK_RECORDS; i++) {
+            JournalSlot *rec = &map[i];
+
+            if (atomic_load_explicit(&rec->seq, memory_order_relaxed) != number * JOURNAL_SEGMENT_RECORDS + i + 1) {
+                continue;
+            }
+            if (rec->ctrl < JOURNAL_CTRL_MAX) {
+                BlockUpdate(block, rec->time, rec->ctrl);
+            }
+        }
+    }
+}
+
+static JournalSlot *SegmentMap(uint64_t number)
+{
+    char path[EXT_STR_LEN];
+
+    SegmentPathGet(number, path);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LogF(LOG_TYPE_ERROR, "JOURNAL", "Failed to open journal segment \"%s\"", path);
+        return NULL;
+    }
+
+    /* New segment is sparse, disk blocks are taken by written records only */
+    if (ftruncate(fd, JOURNAL_SEGMENT_SIZE) < 0) {
+        LogF(LOG_TYPE_ERROR, "JOURNAL", "Failed to resize journal segment \"%s\"", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, JOURNAL_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        LogF(LOG_TYPE_ERROR, "JOURNAL", "Failed to map journal segment \"%s\"", path);
+        return NULL;
+    }
+
+    return (JournalSlot *)map;
+}
+
+static bool SegmentAttach(uint64_t number)
+{
+    char            path[EXT_STR_LEN];
+    JournalSegment  *seg = &Journal.segments[number % JOURNAL_SEGMENTS_MAX];
+
+    /* Oldest segment shares ring position with new one and is removed */
+    JournalSlot *old = atomic_exchange_explicit(&seg->map, NULL, memory_order_acq_rel);
+    if (old != NULL) {
+        munmap(old, JOURNAL_SEGMENT_SIZE);
+
+        SegmentPathGet(atomic_load_explicit(&seg->number, memory_order_relaxed), path);
+        if (unlink(path) < 0) {
+            LogF(LOG_TYPE_ERROR, "JOURNAL", "Failed to remove journal segment \"%s\"", path);
+        }
+    }
+
+    JournalSlot *map = SegmentMap(number);
+    if (map == NULL) {
+        return false;
+    }
+
+    atomic_store_explicit(&seg->number, number, memory_order_relaxed);
+    BlocksBuild(seg, map, number);
+    atomic_store_explicit(&seg->map, map, memory_order_release);
+
+    return true;
+}
+
+static uint64_t SegmentHeadGet(uint64_t number)
+{
+    JournalSegment  *seg = &Journal.segments[number % JOURNAL_SEGMENTS_MAX];
+    JournalSlot     *map = atomic_load_explicit(&seg->map, memory_order_acquire);
+    uint64_t        head = number * JOURNAL_SEGMENT_RECORDS;
+
+    if (map == NULL) {
+        return head;
+    }
+
+    /* Records reserved but not committed before restart are left as holes */
+    for (unsigned i = 0; i < JOURNAL_SEGMENT_RECORDS; i++) {
+        uint64_t seq = atomic_load_explicit(&map[i].seq, memory_order_relaxed);
+
+        if (seq == number * JOURNAL_SEGMENT_RECORDS + i + 1) {
+            head = seq;
+        }
+    }
+
+    return head;
+}
+
+static bool SegmentAttached(uint64_t number)
+{
+    JournalSegment *seg = &Journal.segments[number % JOURNAL_SEGMENTS_MAX];
+
+    return atomic_load_explicit(&seg->map, memory_order_acquire) != NULL &&
+        atomic_load_explicit(&seg->number, memory_order_relaxed) == number;
+}
+
+static uint64_t SegmentsHeadGet(uint64_t last)
+{
+    uint64_t number = last;
+    uint64_t head = SegmentHeadGet(number);
+
+    /* Segments mapped ahead of head are empty and are reused by appends */
+    while (head == number * JOURNAL_SEGMENT_RECORDS && number > 0 && SegmentAttached(number - 1)) {
+        number--;
+        head = SegmentHeadGet(number);
+    }
+
+    return head;
+}
+
+static bool SegmentsLoad(uint64_t *last)
+{
+    char            dir_path[EXT_STR_LEN];
+    char            path[EXT_STR_LEN];
+    struct dirent   *entry;
+    uint64_t        number;
+    uint64_t        first = UINT64_MAX;
+    bool            found = false;
+
+    snprintf(dir_path, EXT_STR_LEN, "%s%s", Journal.path, JOURNAL_DIR);
+
+    if (mkdir(dir_path, 0755) < 0 && errno != EEXIST) {
+        LogF(LOG_TYPE_ERROR, "JOURNAL", "Failed to create journal folder \"%s\"", dir_path);
+        return false;
+    }
+
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL) {
+        LogF(LOG_TYPE_ERROR, "JOURNAL", "Failed to open journal folder \"%s\"", dir_path);
+        return false;
+    }
+
+    *last = 0;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (!SegmentNumberParse(entry->d_name, &number)) {
+            continue;
+        }
+        if (number < first) {
+            first = number;
+        }
+        if (!found || number > *last) {
+            *last = number;
+        }
+        found = true;
+    }
+
+    if (!found) {
+        closedir(dir);
+        return SegmentAttach(0);
+    }
+
+    /* Segments out of ring are left from run with larger journal */
+    rewinddir(dir);
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (SegmentNumberParse(entry->d_name, &number) && number + JOURNAL_SEGMENTS_MAX <= *last) {
+            SegmentPathGet(number, path);
+            unlink(path);
+        }
+    }
+    closedir(dir);
+
+    if (first + JOURNAL_SEGMENTS_MAX <= *last) {
+        first = *last - JOURNAL_SEGMENTS_MAX + 1;
+    }
+
+    for (number = first; number <= *last; number++) {
+        if (!SegmentAttach(number)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void SegmentsSync(uint64_t from, uint64_t to)
+{
+    for (uint64_t number = from; number <= to; number++) {
+        JournalSegment  *seg = &Journal.segments[number % JOURNAL_SEGMENTS_MAX];
+        JournalSlot     *map = atomic_load_explicit(&seg->map, memory_order_acquire);
+
+        if (map == NULL || atomic_load_explicit(&seg->number, memory_order_relaxed) != number) {
+            continue;
+        }
+
+        if (msync(map, JOURNAL_SEGMENT_SIZE, MS_SYNC) < 0) {
+            LogF(LOG_TYPE_ERROR, "JOURNAL", "Failed to sync journal segment %llu", (unsigned long long)number);
+        }
+    }
+}
+
+static void MaintenanceTimerHandler(void *data)
+{
+    uint64_t head = atomic_load_explicit(&Journal.head, memory_order_relaxed);
+    uint64_t number = head / JOURNAL_SEGMENT_RECORDS;
+
+    /* Next segment is mapped ahead, so appends never wait for file creation */
+    mtx_lock(&Journal.mtx);
+
+    while (Journal.last < number + 1) {
+        if (!SegmentAttach(Journal.last + 1)) {
+            break;
+        }
+        Journal.last++;
+    }
+
+    mtx_unlock(&Journal.mtx);
+
+    if (++Journal.ticks < JOURNAL_SYNC_SEC / JOURNAL_CHECK_SEC || Journal.synced == head) {
+        return;
+    }
+    Journal.ticks = 0;
+
+    /* Segments are unmapped by this handler only, so sync needs no lock */
+    SegmentsSync(Journal.synced / JOURNAL_SEGMENT_RECORDS, number);
+    Journal.synced = head;
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+void JournalPathSet(const char *path)
+{
+    strncpy(Journal.path, path, STR_LEN - 1);
+}
+
+void JournalAdd(JournalCtrl ctrl, JournalEvent event, const char *name, int value)
+{
+    if (ctrl >= JOURNAL_CTRL_MAX || event >= JOURNAL_EVENT_MAX) {
+        return;
+    }
+
+    uint64_t        slot = atomic_fetch_add_explicit(&Journal.head, 1, memory_order_relaxed);
+    uint64_t        number = slot / JOURNAL_SEGMENT_RECORDS;
+    unsigned        index = slot % JOURNAL_SEGMENT_RECORDS;
+    JournalSegment  *seg = &Journal.segments[number % JOURNAL_SEGMENTS_MAX];
+    JournalSlot     *map = atomic_load_explicit(&seg->map, memory_order_acquire);
+
+    if (map == NULL || atomic_load_explicit(&seg->number, memory_order_relaxed) != number) {
+        atomic_fetch_add_explicit(&Journal.dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    JournalSlot *rec = &map[index];
+
+    rec->time = RealMsecGet();
+    rec->ctrl = ctrl;
+    rec->event = event;
+    rec->value = value;
+    NameCopy(rec->name, (name != NULL) ? name : "");
+
+    BlockUpdate(&seg->blocks[index / JOURNAL_BLOCK_RECORDS], rec->time, ctrl);
+
+    atomic_store_explicit(&rec->seq, slot + 1, memory_order_release);
+}
+
+bool JournalQuery(uint64_t from, uint64_t to, uint32_t ctrls, unsigned limit, GList **records)
+{
+    unsigned count = 0;
+
+    if (records == NULL || from > to) {
+        return false;
+    }
+
+    mtx_lock(&Journal.mtx);
+
+    for (uint64_t k = 0; k < JOURNAL_SEGMENTS_MAX && k <= Journal.last && count < limit; k++) {
+        uint64_t        number = Journal.last - k;
+        JournalSegment  *seg = &Journal.segments[number % JOURNAL_SEGMENTS_MAX];
+        JournalSlot     *map = atomic_load_explicit(&seg->map, memory_order_acquire);
+
+        if (map == NULL || atomic_load_explicit(&seg->number, memory_order_relaxed) != number) {
+            continue;
+        }
+
+        for (int b = JOURNAL_BLOCKS - 1; b >= 0 && count < limit; b--) {
+            JournalBlock *block = &seg->blocks[b];
+
+            /* Time index skips blocks without matching records */
+            if ((atomic_load_explicit(&block->ctrls, memory_order_relaxed) & ctrls) == 0 ||
+                atomic_load_explicit(&block->max, memory_order_relaxed) < from ||
+                atomic_load_explicit(&block->min, memory_order_relaxed) > to) {
+                continue;
+            }
+
+            for (int i = (b + 1) * JOURNAL_BLOCK_RECORDS - 1; i >= b * JOURNAL_BLOCK_RECORDS && count < limit; i--) {
+                JournalSlot *rec = &map[i];
+
+                if (atomic_load_explicit(&rec->seq, memory_order_acquire) != number * JOURNAL_SEGMENT_RECORDS + i + 1) {
+                    continue;
+                }
+                if (rec->time < from || rec->time > to || rec->ctrl >= JOURNAL_CTRL_MAX ||
+                    rec->event >= JOURNAL_EVENT_MAX || (ctrls & (1U << rec->ctrl)) == 0) {
+                    continue;
+                }
+
+                JournalRecord *r = (JournalRecord *)malloc(sizeof(JournalRecord));
+                if (r == NULL) {
+                    continue;
+                }
+
+                r->time = rec->time;
+                r->ctrl = (JournalCtrl)rec->ctrl;
+                r->event = (JournalEvent)rec->event;
+                r->value = rec->value;
+                memcpy(r->name, rec->name, JOURNAL_NAME_LEN);
+                r->name[JOURNAL_NAME_LEN - 1] = '\0';
+
+                *records = g_list_prepend(*records, r);
+                count++;
+            }
+        }
+    }
+
+    mtx_unlock(&Journal.mtx);
+
+    *records = g_list_reverse(*records);
+    return true;
+}
+
+uint64_t JournalDroppedGet()
+{
+    return atomic_load_explicit(&Journal.dropped, memory_order_relaxed);
+}
+
+bool JournalStart()
+{
+    uint64_t last = 0;
+
+    if (mtx_init(&Journal.mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "JOURNAL", "Failed to init journal mutex");
+        return false;
+    }
+
+    Log(LOG_TYPE_INFO, "JOURNAL", "Starting events journal");
+
+    mtx_lock(&Journal.mtx);
+
+    if (!SegmentsLoad(&last)) {
+        mtx_unlock(&Journal.mtx);
+        return false;
+    }
+
+    uint64_t head = SegmentsHeadGet(last);
+
+    Journal.last = last;
+    Journal.synced = head;
+    atomic_store_explicit(&Journal.head, head, memory_order_relaxed);
+    atomic_store_explicit(&Journal.dropped, 0, memory_order_relaxed);
+
+    mtx_unlock(&Journal.mtx);
+
+    LogF(LOG_TYPE_INFO, "JOURNAL", "Journal opened at record %llu", (unsigned long long)head);
+
+    Journal.timer = TimerBlockingNew(MaintenanceTimerHandler, NULL);
+    if (!TimerPeriodicSet(Journal.timer, JOURNAL_CHECK_SEC * 1000)) {
+        return false;
+    }
+
+    return TimerTrigger(Journal.timer);
+}
@@ -36,6 +36,9 @@ static int TestThread(void *data)
     bool    dev_found = false;
     GList   *devices = NULL;
     bool    state = false;
+    bool    lcd_bench = true;
+    unsigned cps = 0;
+    unsigned writes = 0;
     bool    *input = (bool *)data;
 
    LogPrint(LOG_TYPE_INFO, "FTEST", "Starting FTest");
@@ -133,14 +136,25 @@ static int TestThread(void *data)
         for (GList *l = *lcds; l != NULL; l = l->next) {
             LCD *lcd = (LCD *)l->data;
 
+            if (lcd_bench) {
+                if (LcdBenchmark(lcd, &cps, &writes)) {
+                    LogPrintF(LOG_TYPE_INFO, "FTEST", "\t\tDisplay name: \"%s\" speed: %u chars/sec, %u transactions per frame",
+                        lcd->name, cps, writes);
+                } else {
+                    LogPrintF(LOG_TYPE_INFO, "FTEST", "\t\tDisplay name: \"%s\" failed to benchmark", lcd->name);
+                }
+            }
+
             LcdClear(lcd);
             LcdPosSet(lcd, 0, 0);
             LcdPrint(lcd, lcd_text[0]);
             LcdPosSet(lcd, 1, 0);
             LcdPrint(lcd, lcd_text[1]);
+            LcdFlush(lcd);
 
            LogPrintF(LOG_TYPE_INFO, "FTEST", "\t\tDisplay name: \"%s\" row[0]: \"%s\" row[1]: \"%s\"", lcd->name, lcd_text[0], lcd_text[1]);
         }
+        lcd_bench = false;
 
         /**
          * OneWire test
@@ -15,7 +15,10 @@
 #include <utils/log.h>
 #include <ftest/ftest.h>
 #include <core/gpio.h>
+#include <core/sim.h>
 #include <db/database.h>
+#include <db/journal.h>
+#include <controllers/meteo.h>
 #include <cam/camera.h>
 #include <plc/plc.h>
 
@@ -27,6 +30,8 @@ int main(const int argc, const char **argv)
     char    cam_path[STR_LEN] = "./data/cam/";
     bool    ftest_start = false;
     bool    ftest_input = false;
+    bool    sim_start = false;
+    char    sim_script[STR_LEN] = { 0 };
 
     if (argc > 1) {
         for (unsigned i = 1; i < argc; i++) {
@@ -43,6 +48,11 @@ int main(const int argc, const char **argv)
                 strncpy(cam_path, argv[i + 1], STR_LEN);
             } else if (!strcmp(argv[i], "--log")) {
                 strncpy(log_path, argv[i + 1], STR_LEN);
+            } else if (!strcmp(argv[i], "--sim")) {
+                sim_start = true;
+                if (i + 1 < argc && strncmp(argv[i + 1], "--", 2)) {
+                    strncpy(sim_script, argv[i + 1], STR_LEN);
+                }
             } else if (!strcmp(argv[i], "?")) {
                 printf("Help information:\n");
                 printf("\t--configs [:path]\tPath to Configs directory\n");
@@ -50,6 +60,7 @@ int main(const int argc, const char **argv)
                 printf("\t--log [:path]\t\tPath to Log directory\n");
                 printf("\t--cam [:path]\t\tPath to Camera photos directory\n");
                 printf("\t--ftest\t\t\tStart factory test\n");
+                printf("\t--sim [:script]\t\tUse simulated hardware driven by script\n");
                 return 0;
             }
         }
@@ -57,10 +68,17 @@ int main(const int argc, const char **argv)
 
     LogPathSet(log_path);
     DatabasePathSet(db_path);
+    JournalPathSet(db_path);
+    MeteoPathSet(db_path);
     CameraPathSet(cam_path);
 
     Log(LOG_TYPE_INFO, "MAIN", "Starting application");
 
+    if (sim_start && !SimInit((sim_script[0] != '\0') ? sim_script : NULL)) {
+        Log(LOG_TYPE_ERROR, "MAIN", "Failed to init simulated hardware");
+        return -1;
+    }
+
     if (!GpioInit()) {
         Log(LOG_TYPE_ERROR, "MAIN", "Failed to init GPIO");
         return -1;
@@ -73,6 +91,11 @@ int main(const int argc, const char **argv)
 
     Log(LOG_TYPE_INFO, "MAIN", "Configs was readed");
 
+    if (!SimStart()) {
+        Log(LOG_TYPE_ERROR, "MAIN", "Failed to start simulation script");
+        return -1;
+    }
+
     if (ftest_start) {
         if (!FactoryTestStart(ftest_input)) {
             Log(LOG_TYPE_ERROR, "MAIN", "Failed to start Factory Test");
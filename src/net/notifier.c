@@ -10,11 +10,25 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <threads.h>
 
 #include <net/notifier.h>
 #include <utils/utils.h>
+#include <utils/log.h>
 #include <net/web/webclient.h>
 
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+typedef struct {
+    unsigned    channels;
+    uint64_t    ts;
+    char        msg[STR_LEN];
+} NotifierMsg;
+
 /*********************************************************************/
 /*                                                                   */
 /*                         PRIVATE VARIABLES                         */
@@ -37,6 +51,101 @@ static struct {
     .phone = {0}
 };
 
+static struct _Notifier {
+    NotifierMsg     queue[NOTIFIER_QUEUE_LEN];
+    unsigned        head;
+    NotifierStats   stats;
+    mtx_t           mtx;
+    cnd_t           post;
+} Notifier = {
+    .head = 0
+};
+
+static once_flag notifier_once = ONCE_FLAG_INIT;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static void NotifierInit()
+{
+    if (mtx_init(&Notifier.mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "NOTIFIER", "Failed to init notifier mutex");
+    }
+    if (cnd_init(&Notifier.post) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "NOTIFIER", "Failed to init notifier condition");
+    }
+}
+
+static bool MsgSend(const NotifierMsg *msg)
+{
+    bool ret = true;
+
+    if (msg->channels & NOTIFIER_TELEGRAM) {
+        if (!NotifierTelegramSend(msg->msg)) {
+            Log(LOG_TYPE_ERROR, "NOTIFIER", "Failed to send telegram message");
+            ret = false;
+        }
+    }
+
+    if (msg->channels & NOTIFIER_SMS) {
+        if (!NotifierSmsSend(msg->msg)) {
+            Log(LOG_TYPE_ERROR, "NOTIFIER", "Failed to send sms message");
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+static int NotifierThread(void *data)
+{
+    NotifierMsg msg;
+
+    mtx_lock(&Notifier.mtx);
+
+    for (;;) {
+        while (Notifier.stats.depth == 0) {
+            cnd_wait(&Notifier.post, &Notifier.mtx);
+        }
+
+        /* Message stays queued while sending, so depth counts it */
+        memcpy(&msg, &Notifier.queue[Notifier.head], sizeof(NotifierMsg));
+
+        mtx_unlock(&Notifier.mtx);
+        bool sent = MsgSend(&msg);
+        unsigned latency = (unsigned)(UtilsMonoMsecGet() - msg.ts);
+        mtx_lock(&Notifier.mtx);
+
+        Notifier.head = (Notifier.head + 1) % NOTIFIER_QUEUE_LEN;
+        Notifier.stats.depth--;
+
+        NotifierStats *stats = &Notifier.stats;
+
+        if (sent) {
+            stats->sent++;
+        } else {
+            stats->failed++;
+        }
+
+        /* Average is exponential with 1/8 weight of last message */
+        if (stats->sent + stats->failed == 1) {
+            stats->latency_avg = latency;
+        } else {
+            stats->latency_avg = stats->latency_avg - stats->latency_avg / 8 + latency / 8;
+        }
+        stats->latency_last = latency;
+        if (latency > stats->latency_max) {
+            stats->latency_max = latency;
+        }
+    }
+
+    mtx_unlock(&Notifier.mtx);
+    return 0;
+}
+
 /*********************************************************************/
 /*                                                                   */
 /*                          PUBLIC FUNCTIONS                         */
@@ -76,3 +185,67 @@ bool NotifierSmsSend(const char *msg)
 
     return WebClientRequest(WEB_REQ_GET, url, NULL, buf);
 }
+
+bool NotifierPost(unsigned channels, const char *msg)
+{
+    call_once(&notifier_once, NotifierInit);
+
+    if (channels == 0) {
+        return true;
+    }
+
+    mtx_lock(&Notifier.mtx);
+
+    if (Notifier.stats.depth == NOTIFIER_QUEUE_LEN) {
+        Notifier.stats.dropped++;
+        mtx_unlock(&Notifier.mtx);
+
+        Log(LOG_TYPE_ERROR, "NOTIFIER", "Notifier queue is full, message dropped");
+        return false;
+    }
+
+    NotifierMsg *m = &Notifier.queue[(Notifier.head + Notifier.stats.depth) % NOTIFIER_QUEUE_LEN];
+
+    m->channels = channels;
+    m->ts = UtilsMonoMsecGet();
+    strncpy(m->msg, msg, STR_LEN - 1);
+    m->msg[STR_LEN - 1] = '\0';
+
+    Notifier.stats.depth++;
+    Notifier.stats.queued++;
+    if (Notifier.stats.depth > Notifier.stats.depth_max) {
+        Notifier.stats.depth_max = Notifier.stats.depth;
+    }
+
+    cnd_signal(&Notifier.post);
+    mtx_unlock(&Notifier.mtx);
+
+    return true;
+}
+
+void NotifierStatsGet(NotifierStats *stats)
+{
+    call_once(&notifier_once, NotifierInit);
+
+    mtx_lock(&Notifier.mtx);
+    memcpy(stats, &Notifier.stats, sizeof(NotifierStats));
+    mtx_unlock(&Notifier.mtx);
+}
+
+bool NotifierStart()
+{
+    thrd_t  th;
+
+    call_once(&notifier_once, NotifierInit);
+
+    Log(LOG_TYPE_INFO, "NOTIFIER", "Starting notifier");
+
+    if (thrd_create(&th, &NotifierThread, NULL) != thrd_success) {
+        return false;
+    }
+    if (thrd_detach(th) != thrd_success) {
+        return false;
+    }
+
+    return true;
+}
@@ -30,14 +30,14 @@ void TgMainProcess(const char *token, unsigned from, const char *message)
     const char  *line2[] = { "Розетки", "Термо", "Бак", "Полив" };
 
     if (!strcmp(message, "Я дома")) {
-        if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, false)) {
+        if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, NULL, false)) {
             Log(LOG_TYPE_ERROR, "TGMAIN", "Failed to set security status");
         }
         if (!ScenarioStart(SCENARIO_IN_HOME)) {
             Log(LOG_TYPE_ERROR, "TGMAIN", "Failed to start scenario IN_HOME");
         }
     } else if (!strcmp(message, "Ушёл")) {
-        if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, true)) {
+        if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, NULL, true)) {
             Log(LOG_TYPE_ERROR, "TGMAIN", "Failed to set security status");
         }
         if (!ScenarioStart(SCENARIO_OUT_HOME)) {
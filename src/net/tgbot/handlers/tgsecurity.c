@@ -35,11 +35,11 @@ void TgSecurityProcess(const char *token, unsigned from, const char *message)
     GString     *text = g_string_new("");
 
     if (!strcmp(message, "Включить")) {
-        if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, true)) {
+        if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, NULL, true)) {
             LogF(LOG_TYPE_ERROR, "TGSECURITY", "Failed to enable security status for user \"%d\"", from);
         }
     } else if (!strcmp(message, "Отключить")) {
-        if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, false)) {
+        if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, NULL, false)) {
             LogF(LOG_TYPE_ERROR, "TGSECURITY", "Failed to disable security status for user \"%d\"", from);
         }
     } else if (!strcmp(message, "Сирена Включить")) {
@@ -54,7 +54,7 @@ void TgSecurityProcess(const char *token, unsigned from, const char *message)
 
     text = g_string_append(text, "<b>ОХРАНА</b>\n        Статус: <b>");
 
-    if (RpcSecurityStatusGet(RPC_DEFAULT_UNIT, &status)) {
+    if (RpcSecurityStatusGet(RPC_DEFAULT_UNIT, NULL, &status)) {
         if (status) {
             TgRespButtonAdd(buttons, "Отключить");
             text = g_string_append(text, "Работает</b>\n");
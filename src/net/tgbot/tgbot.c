@@ -8,8 +8,6 @@
 /*                                                                   */
 /*********************************************************************/
 
-#include <threads.h>
-
 #include <jansson.h>
 #include <glib-2.0/glib.h>
 
@@ -19,6 +17,7 @@
 #include <net/web/webclient.h>
 #include <utils/log.h>
 #include <stack/stack.h>
+#include <core/timer.h>
 
 #include <net/tgbot/handlers/tgsocket.h>
 #include <net/tgbot/handlers/tgsecurity.h>
@@ -39,10 +38,12 @@ static struct {
     GList       *users;
     unsigned    message_id;
     bool        enabled;
+    Timer       *timer;
 } TgBot = {
     .users = NULL,
     .message_id = 0,
-    .enabled = true
+    .enabled = true,
+    .timer = NULL
 };
 
 /*********************************************************************/
@@ -215,7 +216,7 @@ static void MessageProcess(unsigned from, const char *message)
     }
 }
 
-static int TelegramThread(void *data)
+static void TelegramTimerHandler(void *data)
 {
     char            buf[BUFFER_LEN_MAX];
     char            url[STR_LEN];
@@ -223,54 +224,47 @@ static int TelegramThread(void *data)
     size_t          index;
     json_t          *value;
 
-    for (;;) {
-        memset(buf, 0x0, BUFFER_LEN_MAX);
-        snprintf(url, STR_LEN, "https://api.telegram.org/bot%s/getUpdates?offset=-1", TgBot.token);
+    memset(buf, 0x0, BUFFER_LEN_MAX);
+    snprintf(url, STR_LEN, "https://api.telegram.org/bot%s/getUpdates?offset=-1", TgBot.token);
 
-        if (WebClientRequest(WEB_REQ_GET, url, NULL, buf)) {
-            json_t *root = json_loads(buf, 0, &error);
+    if (!WebClientRequest(WEB_REQ_GET, url, NULL, buf)) {
+        return;
+    }
 
-            if (root == NULL) {
-                LogF(LOG_TYPE_ERROR, "TGBOT", "Failed to parse telegram request: %s", error.text);
-                UtilsSecSleep(1);
-                continue;
-            }
+    json_t *root = json_loads(buf, 0, &error);
 
-            json_array_foreach(json_object_get(root, "result"), index, value) {
-                json_t *message = json_object_get(value, "message");
-                json_t *from = json_object_get(message, "from");
-                json_t *msg_id = json_object_get(message, "message_id");
+    if (root == NULL) {
+        LogF(LOG_TYPE_ERROR, "TGBOT", "Failed to parse telegram request: %s", error.text);
+        return;
+    }
 
-                if (message == NULL || from == NULL || msg_id == NULL) {
-                    Log(LOG_TYPE_ERROR, "TGBOT", "Failed to parse message & from & msg_id");
-                    UtilsSecSleep(1);
-                    continue;
-                }
+    json_array_foreach(json_object_get(root, "result"), index, value) {
+        json_t *message = json_object_get(value, "message");
+        json_t *from = json_object_get(message, "from");
+        json_t *msg_id = json_object_get(message, "message_id");
 
-                json_t *from_id = json_object_get(from, "id");
-                json_t *text = json_object_get(message, "text");
+        if (message == NULL || from == NULL || msg_id == NULL) {
+            Log(LOG_TYPE_ERROR, "TGBOT", "Failed to parse message & from & msg_id");
+            continue;
+        }
 
-                if (text == NULL || from_id == NULL) {
-                    Log(LOG_TYPE_ERROR, "TGBOT", "Failed to parse text & from_id");
-                    UtilsSecSleep(1);
-                    continue;
-                }
+        json_t *from_id = json_object_get(from, "id");
+        json_t *text = json_object_get(message, "text");
 
-                int id = json_integer_value(msg_id);
+        if (text == NULL || from_id == NULL) {
+            Log(LOG_TYPE_ERROR, "TGBOT", "Failed to parse text & from_id");
+            continue;
+        }
 
-                if (id != TgBot.message_id) {
-                    TgBot.message_id = id;
-                    MessageProcess(json_integer_value(from_id), json_string_value(text));
-                }
-            }
+        int id = json_integer_value(msg_id);
 
-            json_decref(root);
+        if (id != TgBot.message_id) {
+            TgBot.message_id = id;
+            MessageProcess(json_integer_value(from_id), json_string_value(text));
         }
-
-        UtilsSecSleep(1);
     }
 
-    return 0;
+    json_decref(root);
 }
 
 /*********************************************************************/
@@ -306,16 +300,12 @@ void TgBotTokenSet(const char *bot_token)
 
 bool TgBotStart()
 {
-    thrd_t  th;
-
     if (!TgBot.enabled) {
         return true;
     }
 
-    if (thrd_create(&th, &TelegramThread, NULL) != thrd_success) {
-        return false;
-    }
-    if (thrd_detach(th) != thrd_success) {
+    TgBot.timer = TimerBlockingNew(TelegramTimerHandler, NULL);
+    if (!TimerPeriodicSet(TgBot.timer, TG_BOT_POLL_SEC * 1000)) {
         return false;
     }
 
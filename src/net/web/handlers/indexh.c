@@ -10,6 +10,9 @@
 
 #include <net/web/response.h>
 #include <net/web/handlers/indexh.h>
+#include <core/scan.h>
+#include <core/loop.h>
+#include <net/notifier.h>
 
 /*********************************************************************/
 /*                                                                   */
@@ -19,6 +22,53 @@
 
 bool HandlerIndexProcess(FCGX_Request *req, GList **params)
 {
-    json_t  *root = json_object();
+    json_t          *root = json_object();
+    json_t          *jnotifier = json_object();
+    json_t          *jloop = json_object();
+    ScanStats       stats;
+    NotifierStats   nstats;
+    LoopStats       lstats;
+
+    if (ScanStatsGet(&stats)) {
+        json_t *jscan = json_object();
+
+        json_object_set_new(jscan, "period", json_integer(stats.period));
+        json_object_set_new(jscan, "cycles", json_integer(stats.cycles));
+        json_object_set_new(jscan, "overruns", json_integer(stats.overruns));
+        json_object_set_new(jscan, "trips", json_integer(stats.trips));
+        json_object_set_new(jscan, "dropped", json_integer(stats.dropped));
+        json_object_set_new(jscan, "exec_last", json_integer(stats.exec_last));
+        json_object_set_new(jscan, "exec_avg", json_integer(stats.exec_avg));
+        json_object_set_new(jscan, "exec_max", json_integer(stats.exec_max));
+        json_object_set_new(jscan, "jitter_last", json_integer(stats.jitter_last));
+        json_object_set_new(jscan, "jitter_avg", json_integer(stats.jitter_avg));
+        json_object_set_new(jscan, "jitter_max", json_integer(stats.jitter_max));
+
+        json_object_set_new(root, "scan", jscan);
+    }
+
+    LoopStatsGet(&lstats);
+
+    json_object_set_new(jloop, "depth", json_integer(lstats.depth));
+    json_object_set_new(jloop, "depth_max", json_integer(lstats.depth_max));
+    json_object_set_new(jloop, "queued", json_integer(lstats.queued));
+    json_object_set_new(jloop, "dropped", json_integer(lstats.dropped));
+
+    json_object_set_new(root, "loop", jloop);
+
+    NotifierStatsGet(&nstats);
+
+    json_object_set_new(jnotifier, "depth", json_integer(nstats.depth));
+    json_object_set_new(jnotifier, "depth_max", json_integer(nstats.depth_max));
+    json_object_set_new(jnotifier, "queued", json_integer(nstats.queued));
+    json_object_set_new(jnotifier, "sent", json_integer(nstats.sent));
+    json_object_set_new(jnotifier, "failed", json_integer(nstats.failed));
+    json_object_set_new(jnotifier, "dropped", json_integer(nstats.dropped));
+    json_object_set_new(jnotifier, "latency_last", json_integer(nstats.latency_last));
+    json_object_set_new(jnotifier, "latency_avg", json_integer(nstats.latency_avg));
+    json_object_set_new(jnotifier, "latency_max", json_integer(nstats.latency_max));
+
+    json_object_set_new(root, "notifier", jnotifier);
+
     return ResponseOkSend(req, root);
 }
@@ -0,0 +1,132 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib-2.0/glib.h>
+#include <jansson.h>
+#include <fcgiapp.h>
+
+#include <net/web/handlers/journalh.h>
+#include <net/web/response.h>
+#include <utils/utils.h>
+#include <utils/log.h>
+#include <db/journal.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static const char *ctrl_names[JOURNAL_CTRL_MAX] = {
+    [JOURNAL_CTRL_SECURITY] = "security",
+    [JOURNAL_CTRL_SOCKET] = "socket",
+    [JOURNAL_CTRL_TANK] = "tank",
+    [JOURNAL_CTRL_WATERER] = "waterer"
+};
+
+static const char *event_names[JOURNAL_EVENT_MAX] = {
+    [JOURNAL_EVENT_STATUS] = "status",
+    [JOURNAL_EVENT_DETECTED] = "detected",
+    [JOURNAL_EVENT_ALARM] = "alarm",
+    [JOURNAL_EVENT_PUMP] = "pump",
+    [JOURNAL_EVENT_VALVE] = "valve"
+};
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static bool HandlerEventsGet(FCGX_Request *req, GList **params)
+{
+    GList       *records = NULL;
+    uint64_t    from = 0;
+    uint64_t    to = UINT64_MAX;
+    uint32_t    ctrls = JOURNAL_CTRLS_ALL;
+    unsigned    limit = JOURNAL_QUERY_MAX;
+
+    for (GList *p = *params; p != NULL; p = p->next) {
+        UtilsReqParam *param = (UtilsReqParam *)p->data;
+
+        if (!strcmp(param->name, "from")) {
+            from = strtoull(param->value, NULL, 10);
+        } else if (!strcmp(param->name, "to")) {
+            to = strtoull(param->value, NULL, 10);
+        } else if (!strcmp(param->name, "limit")) {
+            limit = strtoul(param->value, NULL, 10);
+            if (limit == 0 || limit > JOURNAL_QUERY_MAX) {
+                limit = JOURNAL_QUERY_MAX;
+            }
+        } else if (!strcmp(param->name, "controller")) {
+            ctrls = 0;
+            for (unsigned i = 0; i < JOURNAL_CTRL_MAX; i++) {
+                if (!strcmp(param->value, ctrl_names[i])) {
+                    ctrls = 1U << i;
+                }
+            }
+            if (ctrls == 0) {
+                return ResponseFailSend(req, "JOURNALH", "Journal controller invalid");
+            }
+        }
+    }
+
+    if (!JournalQuery(from, to, ctrls, limit, &records)) {
+        return ResponseFailSend(req, "JOURNALH", "Failed to query journal");
+    }
+
+    json_t *root = json_object();
+    json_t *jevents = json_array();
+
+    for (GList *r = records; r != NULL; r = r->next) {
+        JournalRecord *rec = (JournalRecord *)r->data;
+
+        json_t *jevent = json_object();
+        json_object_set_new(jevent, "time", json_integer(rec->time));
+        json_object_set_new(jevent, "controller", json_string(ctrl_names[rec->ctrl]));
+        json_object_set_new(jevent, "event", json_string(event_names[rec->event]));
+        json_object_set_new(jevent, "name", json_string(rec->name));
+        json_object_set_new(jevent, "value", json_integer(rec->value));
+        json_array_append_new(jevents, jevent);
+
+        free(rec);
+    }
+
+    json_object_set_new(root, "events", jevents);
+    g_list_free(records);
+
+    return ResponseOkSend(req, root);
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+bool HandlerJournalProcess(FCGX_Request *req, GList **params)
+{
+    for (GList *p = *params; p != NULL; p = p->next) {
+        UtilsReqParam *param = (UtilsReqParam *)p->data;
+
+        if (!strcmp(param->name, "cmd")) {
+            if (!strcmp(param->value, "events_get")) {
+                return HandlerEventsGet(req, params);
+            } else {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
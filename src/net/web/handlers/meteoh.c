@@ -9,6 +9,8 @@
 /*********************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
 
 #include <glib-2.0/glib.h>
 #include <jansson.h>
@@ -19,6 +21,20 @@
 #include <utils/utils.h>
 #include <utils/log.h>
 #include <stack/rpc.h>
+#include <controllers/meteo.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static const char *level_names[METEO_LEVEL_MAX] = {
+    [METEO_LEVEL_RAW] = "raw",
+    [METEO_LEVEL_MINUTE] = "minute",
+    [METEO_LEVEL_HOUR] = "hour",
+    [METEO_LEVEL_DAY] = "day"
+};
 
 /*********************************************************************/
 /*                                                                   */
@@ -62,6 +78,65 @@ static bool HandlerSensorsGet(FCGX_Request *req, GList **params)
     return ResponseOkSend(req, root);
 }
 
+static bool HandlerHistoryGet(FCGX_Request *req, GList **params)
+{
+    json_t      *root = json_object();
+    GList       *points = NULL;
+    MeteoSensor *sensor = NULL;
+    MeteoLevel  level = METEO_LEVEL_HOUR;
+    int64_t     from = 0;
+    int64_t     to = INT64_MAX;
+
+    for (GList *p = *params; p != NULL; p = p->next) {
+        UtilsReqParam *param = (UtilsReqParam *)p->data;
+
+        if (!strcmp(param->name, "name")) {
+            sensor = MeteoSensorGet(param->value);
+        } else if (!strcmp(param->name, "from")) {
+            from = strtoll(param->value, NULL, 10);
+        } else if (!strcmp(param->name, "to")) {
+            to = strtoll(param->value, NULL, 10);
+        } else if (!strcmp(param->name, "level")) {
+            level = METEO_LEVEL_MAX;
+            for (unsigned i = 0; i < METEO_LEVEL_MAX; i++) {
+                if (!strcmp(param->value, level_names[i])) {
+                    level = (MeteoLevel)i;
+                }
+            }
+        }
+    }
+
+    if (sensor == NULL || level == METEO_LEVEL_MAX) {
+        return ResponseFailSend(req, "METEOH", "Meteo history command invalid");
+    }
+
+    if (!MeteoHistoryGet(sensor, level, from, to, &points)) {
+        return ResponseFailSend(req, "METEOH", "Failed to get meteo history");
+    }
+
+    json_t *jpoints = json_array();
+
+    for (GList *p = points; p != NULL; p = p->next) {
+        MeteoPoint *point = (MeteoPoint *)p->data;
+
+        json_t *jpoint = json_object();
+        json_object_set_new(jpoint, "time", json_integer(point->time));
+        json_object_set_new(jpoint, "min", json_real(point->min));
+        json_object_set_new(jpoint, "max", json_real(point->max));
+        json_object_set_new(jpoint, "avg", json_real(point->avg));
+        json_array_append_new(jpoints, jpoint);
+
+        free(point);
+    }
+
+    json_object_set_new(root, "name", json_string(sensor->name));
+    json_object_set_new(root, "level", json_string(level_names[level]));
+    json_object_set_new(root, "points", jpoints);
+    g_list_free(points);
+
+    return ResponseOkSend(req, root);
+}
+
 /*********************************************************************/
 /*                                                                   */
 /*                          PUBLIC FUNCTIONS                         */
@@ -76,6 +151,8 @@ bool HandlerMeteoProcess(FCGX_Request *req, GList **params)
         if (!strcmp(param->name, "cmd")) {
             if (!strcmp(param->value, "sensors_get")) {
                 return HandlerSensorsGet(req, params);
+            } else if (!strcmp(param->value, "history")) {
+                return HandlerHistoryGet(req, params);
             } else {
                 return false;
             }
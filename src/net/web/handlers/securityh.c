@@ -28,14 +28,17 @@
 
 static bool HandlerStatusSet(FCGX_Request *req, GList **params)
 {
-    json_t  *root = json_object();
-    bool    found = false;
-    bool    status = false;
+    json_t      *root = json_object();
+    bool        found = false;
+    bool        status = false;
+    const char  *zone = NULL;
 
     for (GList *p = *params; p != NULL; p = p->next) {
         UtilsReqParam *param = (UtilsReqParam *)p->data;
 
-        if (!strcmp(param->name, "status")) {
+        if (!strcmp(param->name, "zone")) {
+            zone = param->value;
+        } else if (!strcmp(param->name, "status")) {
             if (!strcmp(param->value, "true")) {
                 status = true;
                 found = true;
@@ -50,7 +53,7 @@ static bool HandlerStatusSet(FCGX_Request *req, GList **params)
         return ResponseFailSend(req, "SECURITYH", "Security command ivalid");
     }
 
-    if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, status)) {
+    if (!RpcSecurityStatusSet(RPC_DEFAULT_UNIT, zone, status)) {
         return ResponseFailSend(req, "SECURITYH", "Failed to set security status");
     }
 
@@ -59,10 +62,19 @@ static bool HandlerStatusSet(FCGX_Request *req, GList **params)
 
 static bool HandlerStatusGet(FCGX_Request *req, GList **params)
 {
-    json_t  *root = json_object();
-    bool    status = false;
+    json_t      *root = json_object();
+    bool        status = false;
+    const char  *zone = NULL;
 
-    if (!RpcSecurityStatusGet(RPC_DEFAULT_UNIT, &status)) {
+    for (GList *p = *params; p != NULL; p = p->next) {
+        UtilsReqParam *param = (UtilsReqParam *)p->data;
+
+        if (!strcmp(param->name, "zone")) {
+            zone = param->value;
+        }
+    }
+
+    if (!RpcSecurityStatusGet(RPC_DEFAULT_UNIT, zone, &status)) {
         return ResponseFailSend(req, "SECURITYH", "Failed to get security status");
     }
 
@@ -71,6 +83,34 @@ static bool HandlerStatusGet(FCGX_Request *req, GList **params)
     return ResponseOkSend(req, root);
 }
 
+static bool HandlerZonesGet(FCGX_Request *req, GList **params)
+{
+    json_t  *root = json_object();
+    GList   *zones = NULL;
+
+    if (!RpcSecurityZonesGet(RPC_DEFAULT_UNIT, &zones)) {
+        return ResponseFailSend(req, "SECURITYH", "Failed to get security zones");
+    }
+
+    json_t *jzones = json_array();
+
+    for (GList *z = zones; z != NULL; z = z->next) {
+        RpcSecurityZone *zone = (RpcSecurityZone *)z->data;
+
+        json_t *jzone = json_object();
+        json_object_set_new(jzone, "name", json_string(zone->name));
+        json_object_set_new(jzone, "status", json_boolean(zone->status));
+        json_array_append_new(jzones, jzone);
+
+        free(zone);
+    }
+
+    json_object_set_new(root, "zones", jzones);
+    g_list_free(zones);
+
+    return ResponseOkSend(req, root);
+}
+
 static bool HandlerAlarmSet(FCGX_Request *req, GList **params)
 {
     json_t  *root = json_object();
@@ -161,6 +201,8 @@ bool HandlerSecurityProcess(FCGX_Request *req, GList **params)
                 return HandlerStatusSet(req, params);
             } else if (!strcmp(param->value, "status_get")) {
                 return HandlerStatusGet(req, params);
+            } else if (!strcmp(param->value, "zones_get")) {
+                return HandlerZonesGet(req, params);
             } else if (!strcmp(param->value, "sensors_get")) {
                 return HandlerSensorsGet(req, params);
             } else if (!strcmp(param->value, "alarm_get")) {
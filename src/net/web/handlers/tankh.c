@@ -151,6 +151,7 @@ static bool HandlerTanksGet(FCGX_Request *req, GList **params)
         json_object_set_new(jtank, "pump", json_boolean(tank->pump));
         json_object_set_new(jtank, "valve", json_boolean(tank->valve));
         json_object_set_new(jtank, "level", json_integer(tank->level));
+        json_object_set_new(jtank, "volume", json_real(tank->volume));
         json_array_append_new(jtanks, jtank);
 
         free(tank);
@@ -9,6 +9,7 @@
 /*********************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <glib-2.0/glib.h>
 #include <jansson.h>
@@ -19,6 +20,7 @@
 #include <utils/utils.h>
 #include <utils/log.h>
 #include <stack/rpc.h>
+#include <controllers/waterer.h>
 
 /*********************************************************************/
 /*                                                                   */
@@ -114,6 +116,7 @@ static bool HandlerWaterersGet(FCGX_Request *req, GList **params)
         json_object_set_new(jwaterer, "name", json_string(waterer->name));
         json_object_set_new(jwaterer, "status", json_boolean(waterer->status));
         json_object_set_new(jwaterer, "valve", json_boolean(waterer->valve));
+        json_object_set_new(jwaterer, "volume", json_real(waterer->volume));
 
         json_t *jtimes = json_object();
         for (GList *t = waterer->times; t != NULL; t = t->next) {
@@ -142,6 +145,47 @@ static bool HandlerWaterersGet(FCGX_Request *req, GList **params)
     return ResponseOkSend(req, root);
 }
 
+static bool HandlerUpcomingGet(FCGX_Request *req, GList **params)
+{
+    json_t      *root = json_object();
+    GList       *actions = NULL;
+    unsigned    count = WATERER_UPCOMING_MAX;
+
+    for (GList *p = *params; p != NULL; p = p->next) {
+        UtilsReqParam *param = (UtilsReqParam *)p->data;
+
+        if (!strcmp(param->name, "count")) {
+            count = (unsigned)strtoul(param->value, NULL, 10);
+        }
+    }
+
+    if (!RpcWatererUpcomingGet(RPC_DEFAULT_UNIT, count, &actions)) {
+        return ResponseFailSend(req, "WATERERH", "Failed to get upcoming watering actions");
+    }
+
+    json_t *jactions = json_array();
+
+    for (GList *a = actions; a != NULL; a = a->next) {
+        RpcWatererAction *action = (RpcWatererAction *)a->data;
+
+        json_t *jaction = json_object();
+        json_object_set_new(jaction, "name", json_string(action->name));
+        json_object_set_new(jaction, "delay", json_integer(action->delay));
+        json_object_set_new(jaction, "day", json_integer(action->day));
+        json_object_set_new(jaction, "hour", json_integer(action->hour));
+        json_object_set_new(jaction, "min", json_integer(action->min));
+        json_object_set_new(jaction, "state", json_boolean(action->state));
+        json_array_append_new(jactions, jaction);
+
+        free(action);
+    }
+
+    json_object_set_new(root, "actions", jactions);
+    g_list_free(actions);
+
+    return ResponseOkSend(req, root);
+}
+
 /*********************************************************************/
 /*                                                                   */
 /*                          PUBLIC FUNCTIONS                         */
@@ -160,6 +204,8 @@ bool HandlerWatererProcess(FCGX_Request *req, GList **params)
                 return HandlerWaterersGet(req, params);
             } else if (!strcmp(param->value, "valve_set")) {
                 return HandlerValveSet(req, params);
+            } else if (!strcmp(param->value, "upcoming_get")) {
+                return HandlerUpcomingGet(req, params);
             } else {
                 return false;
             }
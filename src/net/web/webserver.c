@@ -24,6 +24,7 @@
 #include <net/web/handlers/indexh.h>
 #include <net/web/handlers/tankh.h>
 #include <net/web/handlers/watererh.h>
+#include <net/web/handlers/journalh.h>
 
 /*********************************************************************/
 /*                                                                   */
@@ -93,6 +94,10 @@ static bool Process(int socketId)
                 if (!HandlerWatererProcess(&req, &params)) {
                     Log(LOG_TYPE_ERROR, "SERVER", "Failed to process Waterer controller get handler");
                 }
+            } else if (!strcmp(query, "/api/" SERVER_API_VER "/journal")) {
+                if (!HandlerJournalProcess(&req, &params)) {
+                    Log(LOG_TYPE_ERROR, "SERVER", "Failed to process Journal get handler");
+                }
             } else {
                 FCGX_PutS("Content-type: text/html\r\n", req.out);
                 FCGX_PutS("\r\n", req.out);
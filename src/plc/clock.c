@@ -0,0 +1,430 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include <plc/clock.h>
+#include <core/loop.h>
+#include <core/timer.h>
+#include <core/i2c.h>
+#include <core/sim.h>
+#include <utils/utils.h>
+#include <utils/log.h>
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+
+#define CLOCK_NSEC              1000000000ULL
+#define CLOCK_RTC_REG_TIME      0x00
+#define CLOCK_RTC_REGS          7
+#define CLOCK_RTC_EDGE_MSEC     10
+#define CLOCK_RTC_EDGE_MAX_MSEC 1100
+
+/*********************************************************************/
+/*                                                                   */
+/*                           PRIVATE TYPES                           */
+/*                                                                   */
+/*********************************************************************/
+
+typedef struct {
+    ClockHandler    handler;
+    void            *data;
+} ClockSubscriber;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE VARIABLES                         */
+/*                                                                   */
+/*********************************************************************/
+
+static struct _Clock {
+    atomic_uint seq;
+    PlcTime     time;
+    int         fd;
+    PlcTimeType type;
+    unsigned    bus;
+    unsigned    addr;
+    unsigned    sync;
+    I2cDevice   rtc;
+    bool        synced;
+    int64_t     rtc_sec;
+    uint64_t    rtc_mono;
+    Timer       *timer;
+    mtx_t       mtx;
+    ClockSubscriber subscribers[CLOCK_SUBSCRIBERS];
+    atomic_uint subscribers_count;
+} Clock = {
+    .seq = 0,
+    .fd = -1,
+    .type = PLC_TIME_LINUX,
+    .bus = 1,
+    .addr = CLOCK_RTC_ADDR,
+    .sync = CLOCK_RTC_SYNC_SEC,
+    .synced = false,
+    .rtc_sec = 0,
+    .rtc_mono = 0,
+    .timer = NULL,
+    .subscribers_count = 0
+};
+
+static once_flag clock_once = ONCE_FLAG_INIT;
+
+/*********************************************************************/
+/*                                                                   */
+/*                         PRIVATE FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+static void ClockInit()
+{
+    if (mtx_init(&Clock.mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "CLOCK", "Failed to init clock mutex");
+    }
+}
+
+static unsigned BcdParse(uint8_t bcd)
+{
+    return (bcd >> 4) * 10 + (bcd & 0x0F);
+}
+
+static bool RtcRead(int64_t *sec)
+{
+    uint8_t     buf[CLOCK_RTC_REGS];
+    struct tm   tm;
+
+    if (!I2cRegRead(&Clock.rtc, CLOCK_RTC_REG_TIME, buf, CLOCK_RTC_REGS)) {
+        return false;
+    }
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_sec = BcdParse(buf[0] & 0x7F);
+    tm.tm_min = BcdParse(buf[1] & 0x7F);
+
+    /* 12 hour mode has PM flag in bit 5 */
+    if (buf[2] & 0x40) {
+        tm.tm_hour = BcdParse(buf[2] & 0x1F) % 12 + ((buf[2] & 0x20) ? 12 : 0);
+    } else {
+        tm.tm_hour = BcdParse(buf[2] & 0x3F);
+    }
+
+    tm.tm_mday = BcdParse(buf[4] & 0x3F);
+    tm.tm_mon = BcdParse(buf[5] & 0x1F) - 1;
+    tm.tm_year = BcdParse(buf[6]) + 100;
+
+    /* RTC keeps local time, so it is counted as UTC to avoid zone shifts */
+    *sec = (int64_t)timegm(&tm);
+    return true;
+}
+
+static bool RtcSync()
+{
+    int64_t     first, sec;
+    uint64_t    mono, prev;
+
+    if (!RtcRead(&first)) {
+        return false;
+    }
+    sec = first;
+    mono = UtilsMonoNsecGet();
+
+    /* Seconds register has 1 s resolution, wait for its change to get phase */
+    for (unsigned msec = 0; msec < CLOCK_RTC_EDGE_MAX_MSEC; msec += CLOCK_RTC_EDGE_MSEC) {
+        UtilsMsecSleep(CLOCK_RTC_EDGE_MSEC);
+
+        if (!RtcRead(&sec)) {
+            return false;
+        }
+        prev = mono;
+        mono = UtilsMonoNsecGet();
+
+        if (sec != first) {
+            /* Change happened between two reads */
+            mono = prev + (mono - prev) / 2;
+            break;
+        }
+    }
+
+    mtx_lock(&Clock.mtx);
+    Clock.rtc_sec = sec;
+    Clock.rtc_mono = mono;
+    Clock.synced = true;
+    mtx_unlock(&Clock.mtx);
+
+    return true;
+}
+
+static bool TimeFill(PlcTime *time, const struct tm *t)
+{
+    time->sec = t->tm_sec;
+    time->min = t->tm_min;
+    time->hour = t->tm_hour;
+    time->day = t->tm_mday;
+    time->dow = t->tm_wday;
+    time->month = t->tm_mon + 1;
+    time->year = t->tm_year + 1900;
+
+    return true;
+}
+
+static bool TimeRead(PlcTime *time)
+{
+    struct tm t;
+
+    if (Clock.type == PLC_TIME_DS3231 && Clock.synced) {
+        mtx_lock(&Clock.mtx);
+        time_t sec = (time_t)(Clock.rtc_sec + (int64_t)((UtilsMonoNsecGet() - Clock.rtc_mono) / CLOCK_NSEC));
+        mtx_unlock(&Clock.mtx);
+
+        return gmtime_r(&sec, &t) != NULL && TimeFill(time, &t);
+    }
+
+    if (!UtilsLinuxTimeGet(&t)) {
+        return false;
+    }
+    return TimeFill(time, &t);
+}
+
+static bool ClockRefresh()
+{
+    PlcTime time;
+
+    if (!TimeRead(&time)) {
+        return false;
+    }
+
+    /* Writers are serialized, odd sequence marks update in progress */
+    mtx_lock(&Clock.mtx);
+
+    unsigned seq = atomic_load_explicit(&Clock.seq, memory_order_relaxed);
+
+    atomic_store_explicit(&Clock.seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(&Clock.time, &time, sizeof(PlcTime));
+
+    atomic_store_explicit(&Clock.seq, seq + 2, memory_order_release);
+
+    mtx_unlock(&Clock.mtx);
+    return true;
+}
+
+static bool ClockArm()
+{
+    struct timespec     now;
+    struct itimerspec   its;
+    int                 flags = TFD_TIMER_ABSTIME;
+
+    memset(&its, 0, sizeof(its));
+
+    if (Clock.type == PLC_TIME_DS3231) {
+        /* Second boundaries of RTC time in monotonic time */
+        mtx_lock(&Clock.mtx);
+        uint64_t mono = UtilsMonoNsecGet();
+        uint64_t next = Clock.rtc_mono + ((mono - Clock.rtc_mono) / CLOCK_NSEC + 1) * CLOCK_NSEC;
+        mtx_unlock(&Clock.mtx);
+
+        its.it_value.tv_sec = next / CLOCK_NSEC;
+        its.it_value.tv_nsec = next % CLOCK_NSEC;
+    } else {
+        /* Next second boundary, timer is cancelled when clock is set */
+        clock_gettime(CLOCK_REALTIME, &now);
+        its.it_value.tv_sec = now.tv_sec + 1;
+        flags |= TFD_TIMER_CANCEL_ON_SET;
+    }
+
+    return timerfd_settime(Clock.fd, flags, &its, NULL) == 0;
+}
+
+static void ClockStepNotify()
+{
+    unsigned count = atomic_load_explicit(&Clock.subscribers_count, memory_order_acquire);
+
+    for (unsigned i = 0; i < count; i++) {
+        Clock.subscribers[i].handler(Clock.subscribers[i].data);
+    }
+}
+
+static void ClockFdHandler(int fd, uint32_t events, void *data)
+{
+    uint64_t    expirations;
+    bool        step = false;
+
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno == ECANCELED) {
+        Log(LOG_TYPE_INFO, "CLOCK", "System clock was set");
+        step = true;
+    }
+
+    if (!ClockRefresh()) {
+        Log(LOG_TYPE_ERROR, "CLOCK", "Failed to read system time");
+    }
+
+    if (!ClockArm()) {
+        Log(LOG_TYPE_ERROR, "CLOCK", "Failed to arm clock timer");
+    }
+
+    if (step) {
+        ClockStepNotify();
+    }
+}
+
+static void RtcTimerHandler(void *data)
+{
+    if (!RtcSync()) {
+        Log(LOG_TYPE_ERROR, "CLOCK", "Failed to sync time with DS3231, keep running by monotonic clock");
+        return;
+    }
+
+    /* Phase of second boundaries could be moved by sync */
+    if (!ClockRefresh() || !ClockArm()) {
+        Log(LOG_TYPE_ERROR, "CLOCK", "Failed to refresh clock after sync");
+        return;
+    }
+
+    ClockStepNotify();
+}
+
+static bool RtcStart()
+{
+    if (SimEnabled() && !SimDeviceFound(Clock.bus, Clock.addr)) {
+        if (!SimDeviceAdd(SIM_DEV_DS_3231, Clock.bus, Clock.addr, 0)) {
+            return false;
+        }
+    }
+
+    if (!I2cOpen(&Clock.rtc, Clock.bus, Clock.addr)) {
+        LogF(LOG_TYPE_ERROR, "CLOCK", "Failed to open DS3231 on I2C bus %u addr %u", Clock.bus, Clock.addr);
+        return false;
+    }
+
+    if (!RtcSync()) {
+        I2cClose(&Clock.rtc);
+        Log(LOG_TYPE_ERROR, "CLOCK", "Failed to read DS3231 time");
+        return false;
+    }
+
+    Clock.timer = TimerBlockingNew(RtcTimerHandler, NULL);
+    return TimerPeriodicSet(Clock.timer, Clock.sync * 1000);
+}
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+void ClockTypeSet(PlcTimeType type)
+{
+    Clock.type = type;
+}
+
+void ClockRtcSet(unsigned bus, unsigned addr, unsigned sync)
+{
+    Clock.bus = bus;
+    Clock.addr = addr;
+    Clock.sync = (sync != 0) ? sync : CLOCK_RTC_SYNC_SEC;
+}
+
+bool ClockGet(PlcTime *time)
+{
+    call_once(&clock_once, ClockInit);
+
+    for (;;) {
+        unsigned seq = atomic_load_explicit(&Clock.seq, memory_order_acquire);
+
+        if (seq == 0) {
+            return TimeRead(time);
+        }
+        if (seq & 1) {
+            continue;
+        }
+
+        memcpy(time, &Clock.time, sizeof(PlcTime));
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&Clock.seq, memory_order_relaxed) == seq) {
+            return true;
+        }
+    }
+}
+
+int64_t ClockSecondsGet(const PlcTime *time)
+{
+    /* Days from civil date, year starts in March to keep leap day last */
+    int64_t     y = (int64_t)time->year - (time->month <= 2);
+    int64_t     era = (y >= 0 ? y : y - 399) / 400;
+    unsigned    yoe = (unsigned)(y - era * 400);
+    unsigned    doy = (153 * (time->month + (time->month > 2 ? -3 : 9)) + 2) / 5 + time->day - 1;
+    unsigned    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t     days = era * 146097 + (int64_t)doe - 719468;
+
+    return ((days * 24 + time->hour) * 60 + time->min) * 60 + time->sec;
+}
+
+bool ClockSubscribe(ClockHandler handler, void *data)
+{
+    call_once(&clock_once, ClockInit);
+
+    /* Subscribers are never removed, slot is published by count */
+    mtx_lock(&Clock.mtx);
+
+    unsigned count = atomic_load_explicit(&Clock.subscribers_count, memory_order_relaxed);
+
+    if (count >= CLOCK_SUBSCRIBERS) {
+        mtx_unlock(&Clock.mtx);
+        Log(LOG_TYPE_ERROR, "CLOCK", "Too many clock subscribers");
+        return false;
+    }
+
+    Clock.subscribers[count].handler = handler;
+    Clock.subscribers[count].data = data;
+    atomic_store_explicit(&Clock.subscribers_count, count + 1, memory_order_release);
+
+    mtx_unlock(&Clock.mtx);
+    return true;
+}
+
+bool ClockStart()
+{
+    call_once(&clock_once, ClockInit);
+
+    if (Clock.type == PLC_TIME_DS3231) {
+        LogF(LOG_TYPE_INFO, "CLOCK", "Starting wall clock by DS3231 with sync every %u sec", Clock.sync);
+
+        if (!RtcStart()) {
+            Log(LOG_TYPE_ERROR, "CLOCK", "DS3231 is not available, fallback to system time");
+            Clock.type = PLC_TIME_LINUX;
+        }
+    }
+
+    if (Clock.type == PLC_TIME_LINUX) {
+        Log(LOG_TYPE_INFO, "CLOCK", "Starting wall clock by system time");
+    }
+
+    Clock.fd = timerfd_create((Clock.type == PLC_TIME_DS3231) ? CLOCK_MONOTONIC : CLOCK_REALTIME,
+        TFD_CLOEXEC | TFD_NONBLOCK);
+    if (Clock.fd < 0) {
+        Log(LOG_TYPE_ERROR, "CLOCK", "Failed to create clock timer");
+        return false;
+    }
+
+    if (!ClockRefresh() || !ClockArm()) {
+        return false;
+    }
+
+    return LoopFdAdd(Clock.fd, EPOLLIN, ClockFdHandler, NULL);
+}
@@ -10,6 +10,8 @@
 
 #include <plc/menu.h>
 #include <core/lcd.h>
+#include <core/scan.h>
+#include <core/timer.h>
 #include <utils/log.h>
 #include <stack/rpc.h>
 #include <plc/plc.h>
@@ -28,12 +30,12 @@ static struct _Menu {
     GList       *levels;
     LCD         *lcd;
     mtx_t       upd_mtx;
-    bool        pressed;
+    Timer       *timer;
 } Menu = {
     .level = 0,
     .levels = NULL,
     .lcd = NULL,
-    .pressed = false
+    .timer = NULL
 };
 
 /*********************************************************************/
@@ -118,78 +120,51 @@ static void MenuDataPrint(MenuValue *value)
     LcdPrint(Menu.lcd, val);
 }
 
-static int DisplayThread(void *data)
+static void DisplayTimerHandler(void *data)
 {
     unsigned cur_lvl = 0;
-    unsigned counter = 0;
-
-    for (;;) {
-        if (counter == 50 || Menu.pressed) {
-            Menu.pressed = false;
-            counter = 0;
-            cur_lvl = 0;
-
-            for (GList *l = Menu.levels; l != NULL; l = l->next) {
-                MenuLevel *level = (MenuLevel *)l->data;
-                if (cur_lvl == Menu.level) {
-                    LcdClear(Menu.lcd);
-
-                    if (strcmp(level->name, "main")) {
-                        LcdPosSet(Menu.lcd, 0, 0);
-                        LcdPrint(Menu.lcd, level->name);
-                    }
-
-                    for (GList *v = level->values; v != NULL; v = v->next) {
-                        MenuValue *value = (MenuValue *)v->data;
-                        LcdPosSet(Menu.lcd, value->row, value->col);
-                        MenuDataPrint(value);
-                    }
-                }
-                cur_lvl++;
+
+    for (GList *l = Menu.levels; l != NULL; l = l->next) {
+        MenuLevel *level = (MenuLevel *)l->data;
+        if (cur_lvl == Menu.level) {
+            /* Frame is redrawn in buffer, display gets only changed cells */
+            LcdClear(Menu.lcd);
+
+            if (strcmp(level->name, "main")) {
+                LcdPosSet(Menu.lcd, 0, 0);
+                LcdPrint(Menu.lcd, level->name);
             }
+
+            for (GList *v = level->values; v != NULL; v = v->next) {
+                MenuValue *value = (MenuValue *)v->data;
+                LcdPosSet(Menu.lcd, value->row, value->col);
+                MenuDataPrint(value);
+            }
+
+            LcdFlush(Menu.lcd);
         }
-        counter++;
-        UtilsMsecSleep(100);
+        cur_lvl++;
     }
-    return 0;
 }
 
-static int ButtonsThread(void *data)
+static void UpButtonHandler(const GpioEvent *event, void *data)
 {
-    bool state;
-
-    for (;;) {
-        if (!GpioPinRead(Menu.gpio[MENU_GPIO_UP], &state)) {
-            LogF(LOG_TYPE_ERROR, "MENU", "Failed to read GPIO \"%s\"", Menu.gpio[MENU_GPIO_UP]->name);
-        } else { 
-            if (!state) {
-                if (Menu.level < (g_list_length(Menu.levels) - 1)) {
-                    Menu.level++;
-                } else {
-                    Menu.level = 0;
-                }
-                Menu.pressed = true;
-                UtilsMsecSleep(800);
-            }
-        }
-
-        if (!GpioPinRead(Menu.gpio[MENU_GPIO_DOWN], &state)) {
-            LogF(LOG_TYPE_ERROR, "MENU", "Failed to read GPIO \"%s\"", Menu.gpio[MENU_GPIO_UP]->name);
-        } else {
-            if (!state) {
-                if (Menu.level > 0) {
-                    Menu.level--;
-                } else {
-                    Menu.level = g_list_length(Menu.levels) - 1;
-                }
-                Menu.pressed = true;
-                UtilsMsecSleep(800);
-            }
-        }
+    if (Menu.level < (g_list_length(Menu.levels) - 1)) {
+        Menu.level++;
+    } else {
+        Menu.level = 0;
+    }
+    TimerTrigger(Menu.timer);
+}
 
-        UtilsMsecSleep(200);
+static void DownButtonHandler(const GpioEvent *event, void *data)
+{
+    if (Menu.level > 0) {
+        Menu.level--;
+    } else {
+        Menu.level = g_list_length(Menu.levels) - 1;
     }
-    return 0;
+    TimerTrigger(Menu.timer);
 }
 
 /*********************************************************************/
@@ -242,12 +217,18 @@ void MenuValueAdd(MenuLevel *level, MenuValue *value)
 
 bool MenuStart()
 {
-    thrd_t  btn_th, lcd_th;
+    Menu.timer = TimerBlockingNew(DisplayTimerHandler, NULL);
+    if (!TimerPeriodicSet(Menu.timer, MENU_REDRAW_SEC * 1000)) {
+        return false;
+    }
+    TimerTrigger(Menu.timer);
 
-    thrd_create(&btn_th, &ButtonsThread, NULL);
-    thrd_detach(btn_th);
-    thrd_create(&lcd_th, &DisplayThread, NULL);
-    thrd_detach(lcd_th);
+    if (!ScanSubscribe(Menu.gpio[MENU_GPIO_UP], GPIO_EDGE_FALLING, UpButtonHandler, NULL)) {
+        LogF(LOG_TYPE_ERROR, "MENU", "Failed to watch GPIO \"%s\"", Menu.gpio[MENU_GPIO_UP]->name);
+    }
+    if (!ScanSubscribe(Menu.gpio[MENU_GPIO_DOWN], GPIO_EDGE_FALLING, DownButtonHandler, NULL)) {
+        LogF(LOG_TYPE_ERROR, "MENU", "Failed to watch GPIO \"%s\"", Menu.gpio[MENU_GPIO_DOWN]->name);
+    }
 
     return true;
 }
@@ -13,10 +13,20 @@
 #include <utils/log.h>
 #include <net/web/webserver.h>
 #include <net/tgbot/tgbot.h>
+#include <net/notifier.h>
 #include <controllers/controllers.h>
 #include <stack/stack.h>
 #include <db/dbloader.h>
+#include <db/journal.h>
 #include <plc/menu.h>
+#include <plc/clock.h>
+#include <core/gpioevent.h>
+#include <core/scan.h>
+#include <core/onewire.h>
+#include <core/sampler.h>
+#include <core/indicator.h>
+#include <core/loop.h>
+#include <core/timer.h>
 
 #include <threads.h>
 
@@ -29,13 +39,51 @@
 static struct _Plc {
     GpioPin     *gpio[PLC_GPIO_MAX];
     unsigned    alarms;
-    bool        buzzer;
-    PlcTimeType time_type;
+    mtx_t       mtx;
 } Plc = {
     .gpio = {0},
-    .alarms = 0x0,
-    .buzzer = false,
-    .time_type = PLC_TIME_LINUX
+    .alarms = 0x0
+};
+
+static once_flag plc_once = ONCE_FLAG_INIT;
+
+static const IndicatorPattern alarm_pattern = {
+    .count = 2,
+    .repeat = 0,
+    .steps = {
+        { true, 500 }, { false, 500 }
+    }
+};
+
+static const IndicatorPattern buzzer_patterns[] = {
+    [PLC_BUZZER_SECURITY_ENTER] = {
+        .count = 1,
+        .repeat = 1,
+        .steps = {
+            { true, 300 }
+        }
+    },
+    [PLC_BUZZER_SECURITY_EXIT] = {
+        .count = 2,
+        .repeat = 2,
+        .steps = {
+            { true, 100 }, { false, 100 }
+        }
+    },
+    [PLC_BUZZER_LOOP] = {
+        .count = 2,
+        .repeat = 0,
+        .steps = {
+            { true, 500 }, { false, 500 }
+        }
+    },
+    [PLC_BUZZER_TANK_EMPTY] = {
+        .count = 2,
+        .repeat = 4,
+        .steps = {
+            { true, 1000 }, { false, 2000 }
+        }
+    }
 };
 
 /*********************************************************************/
@@ -44,69 +92,11 @@ static struct _Plc {
 /*                                                                   */
 /*********************************************************************/
 
-static int AlarmThread(void *data)
+static void PlcInit()
 {
-    bool    last = true;
-
-    for (;;) {
-        if (Plc.alarms != 0x0) {
-            if (last) {
-                last = false;
-                GpioPinWrite(Plc.gpio[PLC_GPIO_ALARM_LED], true);
-            } else {
-                last = true;
-                GpioPinWrite(Plc.gpio[PLC_GPIO_ALARM_LED], false);
-            }
-        }
-
-        if (Plc.buzzer) {
-            if (last) {
-                GpioPinWrite(Plc.gpio[PLC_GPIO_BUZZER], true);
-            } else {
-                GpioPinWrite(Plc.gpio[PLC_GPIO_BUZZER], false);
-            }
-        }
-
-        UtilsMsecSleep(500);
+    if (mtx_init(&Plc.mtx, mtx_plain) != thrd_success) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to init PLC mutex");
     }
-    return 0;
-}
-
-static int BuzzerThread(void *data)
-{
-    PlcBuzzerType *type = (PlcBuzzerType *)data;
-
-    switch (*type) {
-        case PLC_BUZZER_LOOP:
-            break;
-
-        case PLC_BUZZER_SECURITY_ENTER:
-            GpioPinWrite(Plc.gpio[PLC_GPIO_BUZZER], true);
-            UtilsMsecSleep(300);
-            GpioPinWrite(Plc.gpio[PLC_GPIO_BUZZER], false);
-            break;
-
-        case PLC_BUZZER_SECURITY_EXIT:
-            for (unsigned i = 0; i < 2; i++) {
-                GpioPinWrite(Plc.gpio[PLC_GPIO_BUZZER], true);
-                UtilsMsecSleep(100);
-                GpioPinWrite(Plc.gpio[PLC_GPIO_BUZZER], false);
-                UtilsMsecSleep(100);
-            }
-            break;
-
-        case PLC_BUZZER_TANK_EMPTY:
-            for (unsigned i = 0; i < 4; i++) {
-                GpioPinWrite(Plc.gpio[PLC_GPIO_BUZZER], true);
-                UtilsSecSleep(1);
-                GpioPinWrite(Plc.gpio[PLC_GPIO_BUZZER], false);
-                UtilsSecSleep(2);
-            }
-            break;
-    }
-
-    free(type);
-    return 0;
 }
 
 /*********************************************************************/
@@ -117,25 +107,12 @@ static int BuzzerThread(void *data)
 
 void PlcTimeTypeSet(PlcTimeType type)
 {
-    Plc.time_type = type;
+    ClockTypeSet(type);
 }
 
 bool PlcTimeGet(PlcTime *time)
 {
-    if (Plc.time_type == PLC_TIME_LINUX) {
-        struct tm *t = UtilsLinuxTimeGet();
-
-        time->sec = t->tm_sec;
-        time->min = t->tm_min;
-        time->hour = t->tm_hour;
-        time->day = t->tm_mday;
-        time->dow = t->tm_wday;
-        time->month = t->tm_mon;
-        time->year = t->tm_year;
-
-        return true;
-    }
-    return false;
+    return ClockGet(time);
 }
 
 void PlcGpioSet(PlcGpioType type, GpioPin *gpio)
@@ -145,44 +122,72 @@ void PlcGpioSet(PlcGpioType type, GpioPin *gpio)
 
 void PlcAlarmSet(PlcAlarmType type, bool status)
 {
+    call_once(&plc_once, PlcInit);
+
+    mtx_lock(&Plc.mtx);
+
     if (status) {
         Plc.alarms |= (1 << type);
     } else {
         Plc.alarms &= ~(1 << type);
     }
 
-    if (Plc.alarms == 0x0) {
-        UtilsSecSleep(1);
-        GpioPinWrite(Plc.gpio[PLC_GPIO_ALARM_LED], false);
+    if (Plc.alarms != 0x0) {
+        IndicatorPlay(Plc.gpio[PLC_GPIO_ALARM_LED], &alarm_pattern, INDICATOR_PRIO_ALARM);
+    } else {
+        IndicatorStop(Plc.gpio[PLC_GPIO_ALARM_LED], INDICATOR_PRIO_ALARM);
     }
+
+    mtx_unlock(&Plc.mtx);
 }
 
 void PlcBuzzerRun(PlcBuzzerType type, bool status)
 {
-    thrd_t  bz_th;
+    /* Continuous alarm sound is preempted by short beeps */
+    IndicatorPrio prio = (type == PLC_BUZZER_LOOP) ? INDICATOR_PRIO_ALARM : INDICATOR_PRIO_NOTICE;
 
-    if (type == PLC_BUZZER_LOOP) {
-        Plc.buzzer = status;
-        if (!status) {
-            UtilsSecSleep(1);
-            GpioPinWrite(Plc.gpio[PLC_GPIO_BUZZER], false);
-        }
+    if (status) {
+        IndicatorPlay(Plc.gpio[PLC_GPIO_BUZZER], &buzzer_patterns[type], prio);
     } else {
-        PlcBuzzerType *t = (PlcBuzzerType *)malloc(sizeof(PlcBuzzerType));
-        *t = type;
-        thrd_create(&bz_th, &BuzzerThread, (void *)t);
-        thrd_detach(bz_th);
+        IndicatorStop(Plc.gpio[PLC_GPIO_BUZZER], prio);
     }
 }
 
-bool PlcStart()
+void PlcBuzzerStop()
 {
-    thrd_t  alrm_th;
+    for (IndicatorPrio prio = INDICATOR_PRIO_ALARM; prio < INDICATOR_PRIO_MAX; prio++) {
+        IndicatorStop(Plc.gpio[PLC_GPIO_BUZZER], prio);
+    }
+}
 
+bool PlcStart()
+{
     Log(LOG_TYPE_INFO, "PLC", "Starting Plc");
 
-    thrd_create(&alrm_th, &AlarmThread, NULL);
-    thrd_detach(alrm_th);
+    if (!LoopStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start event loop");
+        return -1;
+    }
+
+    if (!TimerStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start timers");
+        return -1;
+    }
+
+    if (!ClockStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start clock");
+        return -1;
+    }
+
+    if (!JournalStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start journal");
+        return -1;
+    }
+
+    if (!IndicatorStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start indicators");
+        return -1;
+    }
 
     Log(LOG_TYPE_INFO, "PLC", "Switch on ext power");
 
@@ -200,6 +205,39 @@ bool PlcStart()
         return -1;
     }
 
+    Log(LOG_TYPE_INFO, "PLC", "Starting GPIO events");
+
+    if (!GpioEventStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start GPIO events");
+        return -1;
+    }
+
+    Log(LOG_TYPE_INFO, "PLC", "Starting input scan");
+
+    if (!ScanStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start input scan");
+        return -1;
+    }
+
+    Log(LOG_TYPE_INFO, "PLC", "Starting analog sampling");
+
+    if (!SamplerStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start analog sampling");
+        return -1;
+    }
+
+    Log(LOG_TYPE_INFO, "PLC", "Starting 1-Wire scan");
+
+    if (!OneWireStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start 1-Wire scan");
+        return -1;
+    }
+
+    if (!NotifierStart()) {
+        Log(LOG_TYPE_ERROR, "PLC", "Failed to start notifier");
+        return -1;
+    }
+
     Log(LOG_TYPE_INFO, "PLC", "Starting controllers");
 
     if (!ControllersStart()) {
@@ -79,7 +79,7 @@ bool RpcUnitStatusCheck(unsigned unit)
 /*                                                                   */
 /*********************************************************************/
 
-bool RpcSecurityStatusSet(unsigned unit, bool status)
+bool RpcSecurityStatusSet(unsigned unit, const char *zone, bool status)
 {
     char            buf[BUFFER_LEN_MAX];
     char            url[STR_LEN];
@@ -89,7 +89,15 @@ bool RpcSecurityStatusSet(unsigned unit, bool status)
         if (!SecurityEnabledGet()) {
             return true;
         }
-        return SecurityStatusSet(status, true);
+        if (zone == NULL) {
+            return SecurityStatusSet(status, true);
+        }
+
+        SecurityZone *z = SecurityZoneGet(zone);
+        if (z == NULL) {
+            return false;
+        }
+        return SecurityZonesStatusSet(1U << z->id, status, true);
     }
 
     StackUnit *u = StackUnitGet(unit);
@@ -97,8 +105,9 @@ bool RpcSecurityStatusSet(unsigned unit, bool status)
         return false;
     }
 
-    snprintf(url, STR_LEN, "http://%s:%d/api/%s/security?cmd=status_set&status=%s",
-            u->ip, u->port, SERVER_API_VER, (status == true) ? "true" : "false");
+    snprintf(url, STR_LEN, "http://%s:%d/api/%s/security?cmd=status_set&status=%s%s%s",
+            u->ip, u->port, SERVER_API_VER, (status == true) ? "true" : "false",
+            (zone != NULL) ? "&zone=" : "", (zone != NULL) ? zone : "");
     memset(buf, 0x0, BUFFER_LEN_MAX);
 
     if (!WebClientRequest(WEB_REQ_GET, url, NULL, buf)) {
@@ -119,7 +128,7 @@ bool RpcSecurityStatusSet(unsigned unit, bool status)
     return true;
 }
 
-bool RpcSecurityStatusGet(unsigned unit, bool *status)
+bool RpcSecurityStatusGet(unsigned unit, const char *zone, bool *status)
 {
     char            buf[BUFFER_LEN_MAX];
     char            url[STR_LEN];
@@ -135,7 +144,16 @@ bool RpcSecurityStatusGet(unsigned unit, bool *status)
             return true;
         }
 
-        *status = SecurityStatusGet();
+        if (zone == NULL) {
+            *status = SecurityStatusGet();
+            return true;
+        }
+
+        SecurityZone *z = SecurityZoneGet(zone);
+        if (z == NULL) {
+            return false;
+        }
+        *status = (SecurityZonesStatusGet() & (1U << z->id)) != 0;
 
         return true;
     }
@@ -145,7 +163,8 @@ bool RpcSecurityStatusGet(unsigned unit, bool *status)
         return false;
     }
 
-    snprintf(url, STR_LEN, "http://%s:%d/api/%s/security?cmd=status_get", u->ip, u->port, SERVER_API_VER);
+    snprintf(url, STR_LEN, "http://%s:%d/api/%s/security?cmd=status_get%s%s", u->ip, u->port, SERVER_API_VER,
+            (zone != NULL) ? "&zone=" : "", (zone != NULL) ? zone : "");
     memset(buf, 0x0, BUFFER_LEN_MAX);
 
     if (!WebClientRequest(WEB_REQ_GET, url, NULL, buf)) {
@@ -168,6 +187,72 @@ bool RpcSecurityStatusGet(unsigned unit, bool *status)
     return true;
 }
 
+bool RpcSecurityZonesGet(unsigned unit, GList **zones)
+{
+    char            buf[BUFFER_LEN_MAX];
+    char            url[STR_LEN];
+    json_error_t    error;
+    size_t          index;
+    json_t          *value;
+
+    if (zones == NULL) {
+        return false;
+    }
+
+    if (unit == RPC_DEFAULT_UNIT) {
+        if (!SecurityEnabledGet()) {
+            return true;
+        }
+
+        uint32_t armed = SecurityZonesStatusGet();
+
+        for (GList *c = *SecurityZonesGet(); c != NULL; c = c->next) {
+            SecurityZone *zone = (SecurityZone *)c->data;
+
+            RpcSecurityZone *z = (RpcSecurityZone *)malloc(sizeof(RpcSecurityZone));
+            strncpy(z->name, zone->name, SHORT_STR_LEN);
+            z->status = (armed & (1U << zone->id)) != 0;
+
+            *zones = g_list_append(*zones, z);
+        }
+        return true;
+    }
+
+    StackUnit *u = StackUnitGet(unit);
+    if (u == NULL) {
+        return false;
+    }
+
+    snprintf(url, STR_LEN, "http://%s:%d/api/%s/security?cmd=zones_get", u->ip, u->port, SERVER_API_VER);
+    memset(buf, 0x0, BUFFER_LEN_MAX);
+
+    if (!WebClientRequest(WEB_REQ_GET, url, NULL, buf)) {
+        return false;
+    }
+
+    json_t *root = json_loads(buf, 0, &error);
+    if (root == NULL) {
+        return false;
+    }
+
+    if (!json_boolean_value(json_object_get(root, "result"))) {
+        json_decref(root);
+        return false;
+    }
+
+    json_array_foreach(json_object_get(root, "zones"), index, value) {
+        RpcSecurityZone *z = (RpcSecurityZone *)malloc(sizeof(RpcSecurityZone));
+
+        strncpy(z->name, json_string_value(json_object_get(value, "name")), SHORT_STR_LEN);
+        z->status = json_boolean_value(json_object_get(value, "status"));
+
+        *zones = g_list_append(*zones, z);
+    }
+
+    json_decref(root);
+    return true;
+}
+
 bool RpcSecurityAlarmSet(unsigned unit, bool alarm)
 {
     char            buf[BUFFER_LEN_MAX];
@@ -601,6 +686,7 @@ bool RpcTanksGet(unsigned unit, GList **tanks)
             t->level = tank->level;
             t->pump = tank->pump;
             t->valve = tank->valve;
+            t->volume = (tank->flow != NULL) ? tank->flow->volume : 0.0f;
 
             *tanks = g_list_append(*tanks, (void *)t);
         }
@@ -637,6 +723,7 @@ bool RpcTanksGet(unsigned unit, GList **tanks)
         t->level = json_integer_value(json_object_get(value, "level"));
         t->pump = json_boolean_value(json_object_get(value, "pump"));
         t->valve = json_boolean_value(json_object_get(value, "valve"));
+        t->volume = json_real_value(json_object_get(value, "volume"));
 
         *tanks = g_list_append(*tanks, (void *)t);
     }
@@ -837,6 +924,7 @@ bool RpcWaterersGet(unsigned unit, GList **waterers)
             strncpy(t->name, waterer->name, SHORT_STR_LEN);
             t->status = waterer->status;
             t->valve = waterer->valve;
+            t->volume = (waterer->flow != NULL) ? waterer->flow->volume : 0.0f;
             t->times = NULL;
 
             for (GList *ts = waterer->times; ts != NULL; ts = ts->next) {
@@ -883,6 +971,7 @@ bool RpcWaterersGet(unsigned unit, GList **waterers)
         strncpy(t->name, json_string_value(json_object_get(value, "name")), SHORT_STR_LEN);
         t->status = json_boolean_value(json_object_get(value, "status"));
         t->valve = json_boolean_value(json_object_get(value, "valve"));
+        t->volume = json_real_value(json_object_get(value, "volume"));
         t->times = NULL;
 
         json_array_foreach(json_object_get(value, "times"), ext_index, ext_value) {
@@ -903,6 +992,80 @@ bool RpcWaterersGet(unsigned unit, GList **waterers)
     return true;
 }
 
+bool RpcWatererUpcomingGet(unsigned unit, unsigned count, GList **actions)
+{
+    char            buf[BUFFER_LEN_MAX];
+    char            url[STR_LEN];
+    json_error_t    error;
+    size_t          index;
+    json_t          *value;
+
+    if (actions == NULL) {
+        return false;
+    }
+
+    if (count > WATERER_UPCOMING_MAX) {
+        count = WATERER_UPCOMING_MAX;
+    }
+
+    if (unit == RPC_DEFAULT_UNIT) {
+        WateringAction  upcoming[WATERER_UPCOMING_MAX];
+        unsigned        found = WatererUpcomingGet(upcoming, count);
+
+        for (unsigned i = 0; i < found; i++) {
+            RpcWatererAction *a = (RpcWatererAction *)malloc(sizeof(RpcWatererAction));
+
+            strncpy(a->name, upcoming[i].wtr->name, SHORT_STR_LEN);
+            a->delay = upcoming[i].delay;
+            a->day = upcoming[i].dow;
+            a->hour = upcoming[i].hour;
+            a->min = upcoming[i].min;
+            a->state = upcoming[i].state;
+
+            *actions = g_list_append(*actions, (void *)a);
+        }
+        return true;
+    }
+
+    StackUnit *u = StackUnitGet(unit);
+    if (u == NULL) {
+        return false;
+    }
+
+    snprintf(url, STR_LEN, "http://%s:%d/api/%s/waterer?cmd=upcoming_get&count=%u", u->ip, u->port, SERVER_API_VER, count);
+    memset(buf, 0x0, BUFFER_LEN_MAX);
+
+    if (!WebClientRequest(WEB_REQ_GET, url, NULL, buf)) {
+        return false;
+    }
+
+    json_t *root = json_loads(buf, 0, &error);
+    if (root == NULL) {
+        return false;
+    }
+
+    if (!json_boolean_value(json_object_get(root, "result"))) {
+        json_decref(root);
+        return false;
+    }
+
+    json_array_foreach(json_object_get(root, "actions"), index, value) {
+        RpcWatererAction *a = (RpcWatererAction *)malloc(sizeof(RpcWatererAction));
+
+        strncpy(a->name, json_string_value(json_object_get(value, "name")), SHORT_STR_LEN);
+        a->delay = json_integer_value(json_object_get(value, "delay"));
+        a->day = json_integer_value(json_object_get(value, "day"));
+        a->hour = json_integer_value(json_object_get(value, "hour"));
+        a->min = json_integer_value(json_object_get(value, "min"));
+        a->state = json_boolean_value(json_object_get(value, "state"));
+
+        *actions = g_list_append(*actions, (void *)a);
+    }
+
+    json_decref(root);
+    return true;
+}
+
 bool RpcWatererValveSet(unsigned unit, const char *name, bool status)
 {
     char            buf[BUFFER_LEN_MAX];
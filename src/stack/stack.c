@@ -11,8 +11,8 @@
 #include <stack/stack.h>
 #include <utils/log.h>
 #include <stack/rpc.h>
+#include <core/timer.h>
 
-#include <threads.h>
 #include <stdlib.h>
 
 /*********************************************************************/
@@ -23,8 +23,10 @@
 
 static struct {
     GList   *units;
+    Timer   *timer;
 } Stack = {
     .units = NULL,
+    .timer = NULL
 };
 
 /*********************************************************************/
@@ -60,7 +62,7 @@ static void SecurityControllersUpdate()
     bool    slave_status = false;
     bool    slave_alarm = false;
 
-    if (!RpcSecurityStatusGet(RPC_DEFAULT_UNIT, &master_status)) {
+    if (!RpcSecurityStatusGet(RPC_DEFAULT_UNIT, NULL, &master_status)) {
         LogF(LOG_TYPE_ERROR, "STACK", "Failed to get Security status from Unit %d", 0);
         return;
     }
@@ -79,7 +81,7 @@ static void SecurityControllersUpdate()
             continue;
         }
 
-        if (!RpcSecurityStatusGet(unit->id, &slave_status)) {
+        if (!RpcSecurityStatusGet(unit->id, NULL, &slave_status)) {
             if (!unit->error) {
                 unit->error = true;
                 LogF(LOG_TYPE_ERROR, "STACK", "Failed to get Security status from Unit %d", unit->id);
@@ -93,7 +95,7 @@ static void SecurityControllersUpdate()
         }
 
         if (slave_status != master_status) {
-            if (!RpcSecurityStatusSet(unit->id, master_status)) {
+            if (!RpcSecurityStatusSet(unit->id, NULL, master_status)) {
                 if (!unit->error) {
                     unit->error = true;
                     LogF(LOG_TYPE_ERROR, "STACK", "Failed to set Security status from Unit %d", unit->id);
@@ -156,13 +158,10 @@ static void SecurityControllersUpdate()
     units = NULL;
 }
 
-static int StackThread(void *data)
+static void StackTimerHandler(void *data)
 {
-    for (;;) {
-        UnitsStatusCheck();
-        SecurityControllersUpdate();
-        UtilsSecSleep(3);
-    }
+    UnitsStatusCheck();
+    SecurityControllersUpdate();
 }
 
 /*********************************************************************/
@@ -251,14 +250,10 @@ GList **StackUnitsGet()
 
 bool StackStart()
 {
-    thrd_t  stk_th;
-
     Log(LOG_TYPE_INFO, "STACK", "Starting Stack monitoring");
 
-    if (thrd_create(&stk_th, &StackThread, NULL) != thrd_success) {
-        return false;
-    }
-    if (thrd_detach(stk_th) != thrd_success) {
+    Stack.timer = TimerBlockingNew(StackTimerHandler, NULL);
+    if (!TimerPeriodicSet(Stack.timer, STACK_CHECK_SEC * 1000)) {
         return false;
     }
 
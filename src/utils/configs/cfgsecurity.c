@@ -8,6 +8,8 @@
 /*                                                                   */
 /*********************************************************************/
 
+#include <stdlib.h>
+
 #include <utils/log.h>
 #include <controllers/security.h>
 #include <core/gpio.h>
@@ -63,6 +65,69 @@ static bool CfgSecurityGpioLoad(json_t *jsecurity)
     return true;
 }
 
+static bool CfgSecurityZonesLoad(json_t *jsecurity)
+{
+    size_t  ext_index;
+    json_t  *ext_value;
+
+    json_t *jzones = json_object_get(jsecurity, "zones");
+    if (jzones == NULL) {
+        /* Single zone keeps configs without zones working as before */
+        if (!SecurityZoneAdd(SecurityZoneNew(SECURITY_ZONE_DEFAULT))) {
+            return false;
+        }
+        LogF(LOG_TYPE_INFO, "CONFIGS", "Add default Security zone: \"%s\"", SECURITY_ZONE_DEFAULT);
+        return true;
+    }
+
+    json_array_foreach(jzones, ext_index, ext_value) {
+        const char *name = json_string_value(ext_value);
+        if (name == NULL) {
+            Log(LOG_TYPE_ERROR, "CONFIGS", "Security zone name not found");
+            return false;
+        }
+
+        if (SecurityZoneGet(name) != NULL) {
+            LogF(LOG_TYPE_ERROR, "CONFIGS", "Security zone \"%s\" already exists", name);
+            return false;
+        }
+
+        SecurityZone *zone = SecurityZoneNew(name);
+
+        if (!SecurityZoneAdd(zone)) {
+            free(zone);
+            return false;
+        }
+
+        LogF(LOG_TYPE_INFO, "CONFIGS", "Add Security zone: \"%s\"", zone->name);
+    }
+
+    return true;
+}
+
+static bool CfgSecuritySensorZonesLoad(json_t *jzones, uint32_t *zones)
+{
+    size_t  index;
+    json_t  *value;
+
+    *zones = 0;
+
+    json_array_foreach(jzones, index, value) {
+        const char *name = json_string_value(value);
+
+        SecurityZone *zone = (name != NULL) ? SecurityZoneGet(name) : NULL;
+        if (zone == NULL) {
+            LogF(LOG_TYPE_ERROR, "CONFIGS", "Security sensor error: zone \"%s\" not found in list",
+                (name != NULL) ? name : "");
+            return false;
+        }
+
+        *zones |= 1U << zone->id;
+    }
+
+    return true;
+}
+
 static bool CfgSecuritySensorsLoad(json_t *jsecurity)
 {
     size_t  ext_index;
@@ -147,11 +212,35 @@ static bool CfgSecuritySensorsLoad(json_t *jsecurity)
             json_boolean_value(jalarm)
         );
 
-        SecuritySensorAdd(sensor);
+        json_t *jsamples = json_object_get(ext_value, "samples");
+        json_t *jwindow = json_object_get(ext_value, "window");
 
-        LogF(LOG_TYPE_INFO, "CONFIGS", "Add Security sensor name: \"%s\" gpio: \"%s\" type: \"%s\" telegram: \"%d\" sms: \"%d\" alarm: \"%d\"",
+        if (jsamples != NULL || jwindow != NULL) {
+            unsigned samples = (jsamples != NULL) ? json_integer_value(jsamples) : SECURITY_DETECT_SAMPLES;
+            unsigned window = (jwindow != NULL) ? json_integer_value(jwindow) : SECURITY_DETECT_WINDOW;
+
+            if (!SecuritySensorDetectSet(sensor, samples, window)) {
+                LogF(LOG_TYPE_ERROR, "CONFIGS", "Security sensor \"%s\" invalid detection: %u of %u samples",
+                    sensor->name, samples, window);
+                free(sensor);
+                return false;
+            }
+        }
+
+        json_t *jzones = json_object_get(ext_value, "zones");
+        if (jzones != NULL && !CfgSecuritySensorZonesLoad(jzones, &sensor->zones)) {
+            free(sensor);
+            return false;
+        }
+
+        if (!SecuritySensorAdd(sensor)) {
+            free(sensor);
+            return false;
+        }
+
+        LogF(LOG_TYPE_INFO, "CONFIGS", "Add Security sensor name: \"%s\" gpio: \"%s\" type: \"%s\" telegram: \"%d\" sms: \"%d\" alarm: \"%d\" detect: \"%u/%u\"",
             sensor->name, json_string_value(jgpio),
-            type_str, sensor->telegram, sensor->sms, sensor->alarm);
+            type_str, sensor->telegram, sensor->sms, sensor->alarm, sensor->samples, sensor->window);
     }
 
     return true;
@@ -272,6 +361,11 @@ bool CfgSecurityLoad(json_t *data)
         return false;
     }
 
+    if (!CfgSecurityZonesLoad(jsecurity)) {
+        Log(LOG_TYPE_ERROR, "CONFIGS", "Failed to load security zones configs");
+        return false;
+    }
+
     if (!CfgSecuritySensorsLoad(jsecurity)) {
         Log(LOG_TYPE_ERROR, "CONFIGS", "Failed to load security sensors configs");
         return false;
@@ -137,6 +137,25 @@ bool CfgTankLoad(json_t *data)
         TankGpioSet(tank, TANK_GPIO_STATUS_LED, led);
         TankGpioSet(tank, TANK_GPIO_STATUS_BUTTON, button);
 
+        json_t *jflow = json_object_get(ext_value, "flow");
+        if (jflow != NULL) {
+            json_t *jfgpio = json_object_get(jflow, "gpio");
+            json_t *jpulses = json_object_get(jflow, "pulses");
+
+            if (jfgpio == NULL || jpulses == NULL) {
+                Log(LOG_TYPE_ERROR, "CONFIGS", "Tank flow meter GPIO or pulses not found");
+                return false;
+            }
+
+            GpioPin *fgpio = GpioPinGet(json_string_value(jfgpio));
+            if (fgpio == NULL || !fgpio->counter) {
+                Log(LOG_TYPE_ERROR, "CONFIGS", "Tank flow meter GPIO must be a counter");
+                return false;
+            }
+
+            TankFlowSet(tank, TankFlowNew(fgpio, json_integer_value(jpulses)));
+        }
+
         json_t *jlevels = json_object_get(ext_value, "levels");
         if (jlevels == NULL) {
             Log(LOG_TYPE_ERROR, "CONFIGS", "Tank levels not found");
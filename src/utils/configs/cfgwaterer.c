@@ -111,6 +111,25 @@ bool CfgWatererLoad(json_t *data)
         WatererGpioSet(wtr, WATERER_GPIO_STATUS_LED, led);
         WatererGpioSet(wtr, WATERER_GPIO_STATUS_BUTTON, button);
 
+        json_t *jflow = json_object_get(ext_value, "flow");
+        if (jflow != NULL) {
+            json_t *jfgpio = json_object_get(jflow, "gpio");
+            json_t *jpulses = json_object_get(jflow, "pulses");
+
+            if (jfgpio == NULL || jpulses == NULL) {
+                Log(LOG_TYPE_ERROR, "CONFIGS", "Waterer flow meter GPIO or pulses not found");
+                return false;
+            }
+
+            GpioPin *fgpio = GpioPinGet(json_string_value(jfgpio));
+            if (fgpio == NULL || !fgpio->counter) {
+                Log(LOG_TYPE_ERROR, "CONFIGS", "Waterer flow meter GPIO must be a counter");
+                return false;
+            }
+
+            WatererFlowSet(wtr, TankFlowNew(fgpio, json_integer_value(jpulses)));
+        }
+
         json_t *jtimes = json_object_get(ext_value, "times");
         if (jtimes == NULL) {
             Log(LOG_TYPE_ERROR, "CONFIGS", "Waterer times not found");
@@ -24,6 +24,7 @@
 #include <core/gpio.h>
 #include <core/extenders.h>
 #include <core/lcd.h>
+#include <core/scan.h>
 #include <net/notifier.h>
 #include <net/web/webserver.h>
 #include <net/tgbot/tgbot.h>
@@ -34,6 +35,7 @@
 #include <cam/camera.h>
 #include <plc/plc.h>
 #include <plc/menu.h>
+#include <plc/clock.h>
 #include <controllers/meteo.h>
 #include <controllers/socket.h>
 
@@ -176,6 +178,11 @@ static bool BoardRead(const char *path, const ConfigsFactory *factory)
             json_integer_value(jbase)
         );
 
+        json_t *jint = json_object_get(value, "int_pin");
+        if (jint != NULL) {
+            ExtenderIntSet(ext, json_string_value(jint));
+        }
+
         if (!ExtenderAdd(ext, err)) {
             json_decref(data);
             LogF(LOG_TYPE_ERROR, "CONFIGS", "Failed to add Extender \"%s\": %s", ext->name, err);
@@ -194,6 +201,7 @@ static bool BoardRead(const char *path, const ConfigsFactory *factory)
         GpioMode    mode;
         GpioPull    pull;
         GpioType    type;
+        bool        counter = false;
         json_t      *jval;
 
         jval = json_object_get(value, "type");
@@ -226,6 +234,9 @@ static bool BoardRead(const char *path, const ConfigsFactory *factory)
             mode = GPIO_MODE_INPUT;
         } else if (!strcmp(mode_str, "output")) {
             mode = GPIO_MODE_OUTPUT;
+        } else if (!strcmp(mode_str, "counter")) {
+            mode = GPIO_MODE_INPUT;
+            counter = true;
         } else {
             json_decref(data);
             LogF(LOG_TYPE_ERROR, "CONFIGS", "Unknown GPIO pin mode \"%s\"", mode_str);
@@ -274,6 +285,26 @@ static bool BoardRead(const char *path, const ConfigsFactory *factory)
                 pull
             );
 
+        json_t *jline = json_object_get(value, "line");
+        if (jline != NULL) {
+            json_t *jchip = json_object_get(value, "chip");
+            GpioPinLineSet(pin, (jchip != NULL) ? json_integer_value(jchip) : 0, json_integer_value(jline));
+        }
+
+        json_t *jfilter = json_object_get(value, "filter");
+        if (jfilter != NULL) {
+            GpioPinFilterSet(pin, json_integer_value(jfilter));
+        }
+
+        if (counter) {
+            if (type != GPIO_TYPE_DIGITAL) {
+                json_decref(data);
+                LogF(LOG_TYPE_ERROR, "CONFIGS", "GPIO \"%s\" counter must be digital", pin->name);
+                return false;
+            }
+            GpioPinCounterSet(pin, true);
+        }
+
         if (!GpioPinAdd(pin, err)) {
             json_decref(data);
             LogF(LOG_TYPE_ERROR, "CONFIGS", "Failed to add GPIO pin \"%s\": %s", pin->name, err);
@@ -497,6 +528,64 @@ static bool PlcRead(const char *path)
     }
     PlcGpioSet(PLC_GPIO_BUZZER, gpio);
 
+    json_t *jscan = json_object_get(jglobal, "scan");
+    if (jscan != NULL) {
+        json_t *jcycle = json_object_get(jscan, "cycle");
+        if (jcycle == NULL) {
+            json_decref(data);
+            Log(LOG_TYPE_ERROR, "CONFIGS", "PLC scan cycle not found");
+            return false;
+        }
+        ScanCycleSet(json_integer_value(jcycle));
+        LogF(LOG_TYPE_INFO, "CONFIGS", "Set input scan cycle \"%u\" ms", (unsigned)json_integer_value(jcycle));
+
+        json_t *jpriority = json_object_get(jscan, "priority");
+        if (jpriority != NULL) {
+            if (json_integer_value(jpriority) < 0 || json_integer_value(jpriority) > SCAN_PRIORITY_MAX) {
+                json_decref(data);
+                LogF(LOG_TYPE_ERROR, "CONFIGS", "PLC scan priority must be 0..%u", SCAN_PRIORITY_MAX);
+                return false;
+            }
+            ScanPrioritySet(json_integer_value(jpriority));
+        }
+
+        json_t *jwatchdog = json_object_get(jscan, "watchdog");
+        if (jwatchdog != NULL) {
+            ScanWatchdogSet(json_integer_value(jwatchdog));
+        }
+    }
+
+    json_t *jtime = json_object_get(jglobal, "time");
+    if (jtime != NULL) {
+        json_t *jtype = json_object_get(jtime, "type");
+        if (jtype == NULL) {
+            json_decref(data);
+            Log(LOG_TYPE_ERROR, "CONFIGS", "PLC time type not found");
+            return false;
+        }
+
+        const char *type_str = json_string_value(jtype);
+        if (!strcmp(type_str, "linux")) {
+            PlcTimeTypeSet(PLC_TIME_LINUX);
+        } else if (!strcmp(type_str, "ds3231")) {
+            json_t *jbus = json_object_get(jtime, "bus");
+            json_t *jaddr = json_object_get(jtime, "addr");
+            json_t *jsync = json_object_get(jtime, "sync");
+
+            PlcTimeTypeSet(PLC_TIME_DS3231);
+            ClockRtcSet(
+                (jbus != NULL) ? json_integer_value(jbus) : 1,
+                (jaddr != NULL) ? json_integer_value(jaddr) : CLOCK_RTC_ADDR,
+                (jsync != NULL) ? json_integer_value(jsync) : CLOCK_RTC_SYNC_SEC
+            );
+        } else {
+            json_decref(data);
+            LogF(LOG_TYPE_ERROR, "CONFIGS", "Unknown PLC time type \"%s\"", type_str);
+            return false;
+        }
+        LogF(LOG_TYPE_INFO, "CONFIGS", "Set PLC time source \"%s\"", type_str);
+    }
+
     json_t *jserver = json_object_get(data, "server");
     if (jserver == NULL) {
         json_decref(data);
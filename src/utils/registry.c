@@ -0,0 +1,81 @@
+/*********************************************************************/
+/*                                                                   */
+/* Future City Programmable Logic Controller                         */
+/*                                                                   */
+/* Copyright (C) 2023 Denisov Smart Devices Limited                  */
+/* License: GPLv3                                                    */
+/* Written by Sergey Denisov aka LittleBuster (DenisovS21@gmail.com) */
+/*                                                                   */
+/*********************************************************************/
+
+#include <stdlib.h>
+
+#include <utils/registry.h>
+
+/*********************************************************************/
+/*                                                                   */
+/*                          PUBLIC FUNCTIONS                         */
+/*                                                                   */
+/*********************************************************************/
+
+unsigned RegistryAdd(Registry *reg, const char *name, void *obj)
+{
+    if (reg->index == NULL) {
+        reg->index = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    if (reg->count == reg->size) {
+        reg->size = (reg->size == 0) ? REGISTRY_SIZE_DEFAULT : reg->size * 2;
+        reg->objects = (void **)realloc(reg->objects, reg->size * sizeof(void *));
+    }
+
+    unsigned handle = reg->count++;
+    reg->objects[handle] = obj;
+
+    /* Handles are stored shifted by one as NULL means not found */
+    if (!g_hash_table_contains(reg->index, name)) {
+        g_hash_table_insert(reg->index, (gpointer)name, GUINT_TO_POINTER(handle + 1));
+    }
+
+    return handle;
+}
+
+void *RegistryGet(const Registry *reg, const char *name)
+{
+    unsigned handle;
+
+    if (!RegistryHandleGet(reg, name, &handle)) {
+        return NULL;
+    }
+
+    return reg->objects[handle];
+}
+
+bool RegistryHandleGet(const Registry *reg, const char *name, unsigned *handle)
+{
+    if (reg->index == NULL) {
+        return false;
+    }
+
+    unsigned value = GPOINTER_TO_UINT(g_hash_table_lookup(reg->index, name));
+    if (value == 0) {
+        return false;
+    }
+
+    *handle = value - 1;
+    return true;
+}
+
+void *RegistryAt(const Registry *reg, unsigned handle)
+{
+    if (handle >= reg->count) {
+        return NULL;
+    }
+
+    return reg->objects[handle];
+}
+
+unsigned RegistryCount(const Registry *reg)
+{
+    return reg->count;
+}
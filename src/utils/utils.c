@@ -10,6 +10,7 @@
 
 #include <stdlib.h>
 #include <threads.h>
+#include <time.h>
 
 #include <utils/utils.h>
 
@@ -56,18 +57,29 @@ void UtilsSecSleep(unsigned sec)
 
 void UtilsMsecSleep(unsigned msec)
 {
-    thrd_sleep(&(struct timespec){ .tv_nsec = msec * 1000000 }, NULL);
+    thrd_sleep(&(struct timespec){ .tv_sec = msec / 1000, .tv_nsec = (msec % 1000) * 1000000L }, NULL);
 }
 
-struct tm *UtilsLinuxTimeGet()
+uint64_t UtilsMonoNsecGet()
 {
-    long int    s_time;
-    struct tm   *cur_time;
+    struct timespec ts;
 
-    s_time = time(NULL);
-    cur_time = localtime(&s_time);
-    cur_time->tm_year += 1900;
-    cur_time->tm_mon += 1;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    return cur_time;
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t UtilsMonoMsecGet()
+{
+    return UtilsMonoNsecGet() / 1000000ULL;
+}
+
+bool UtilsLinuxTimeGet(struct tm *tm)
+{
+    struct timespec ts;
+
+    /* time() may use coarse clock lagging behind second boundary */
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return localtime_r(&ts.tv_sec, tm) != NULL;
 }